@@ -0,0 +1,161 @@
+import math
+import random
+import subprocess
+import sys
+import time
+from StreamAggregator import StreamAggregator
+
+# Sequential-stopping sweep: every configuration gets min_runs replications, then
+# free job slots go to the configurations whose 95 % confidence half-widths are
+# still above target, until they converge or reach max_runs.
+#
+# python AdaptiveSweep.py <configs file> [jobs] [min runs] [max runs] [success CI] [delay CI] [log level] [crn]
+#   configs file : one "areaLength areaWidth areaHeight numNodes linkQuality" per line
+#   success CI   : target half-width of the success rate, in percentage points
+#   delay CI     : target half-width of the mean delay, relative to the mean
+#   crn          : 1 to use the run index as RngRun (common random numbers across variants)
+
+RESULTS_DIR = "results_cache"
+LAUNCH_DELAY = 0.2    # seconds between job starts, as parallel --delay
+POLL_INTERVAL = 0.2
+STRATEGY = "Single Round Communication"    # label of the default REGKA-Ours run the sweep launches
+
+
+class SweepConfig(object):
+    def __init__(self, area_length, area_width, area_height, num_nodes, link_quality):
+        self.area_length = area_length
+        self.area_width = area_width
+        self.area_height = area_height
+        self.num_nodes = num_nodes
+        self.link_quality = link_quality
+        self.started = 0
+        self.running = 0
+        self.converged = False
+
+    def key(self):
+        return (self.link_quality, float(self.area_length), float(self.area_width),
+                float(self.area_height), self.num_nodes, STRATEGY)
+
+    def command(self, run, log_level, worker, rng_run):
+        return ("../../waf --run 'REGKA-Ours --numNodes=%d --areaLength=%s --areaWidth=%s --areaHeight=%s"
+                " --linkQuality=%s --run=%d --logLevel=%s --worker=%d --RngRun=%d'" % (
+                    self.num_nodes, self.area_length, self.area_width, self.area_height,
+                    self.link_quality, run, log_level, worker, rng_run))
+
+    def __str__(self):
+        return "%s %s*%s*%s n=%d" % (self.link_quality, self.area_length, self.area_width,
+                                     self.area_height, self.num_nodes)
+
+
+def read_configs(path):
+    configs = []
+    with open(path) as fin:
+        for line in fin:
+            fields = line.split()
+            if len(fields) == 5:
+                configs.append(SweepConfig(fields[0], fields[1], fields[2], int(fields[3]), fields[4]))
+    return configs
+
+
+def noise(stats, running, success_target, delay_target):
+    """Largest ratio of projected CI half-width to its target once the running jobs have finished"""
+    if stats is None or stats.runs < 2:
+        return float('inf')
+    shrink = math.sqrt(stats.runs / float(stats.runs + running))
+    ratio = stats.completed.ci95() * shrink / success_target
+    if stats.delay.count < 2:
+        # Too few complete runs to know the delay spread; only a settled zero success rate stops here
+        return max(ratio, float('inf') if stats.completed.mean > 0 else 0.0)
+    delay_shrink = math.sqrt(stats.delay.count / (stats.delay.count + running * stats.completed.mean / 100.0))
+    return max(ratio, stats.delay.ci95() * delay_shrink / (delay_target * stats.delay.mean))
+
+
+def next_config(configs, aggregator, min_runs, max_runs, success_target, delay_target):
+    """Configuration to start the next replication of, None when every one is done or waiting on running jobs"""
+    # Warm-up: every configuration first gets its minimum, fewest started first
+    pending = [c for c in configs if c.started < min_runs]
+    if pending:
+        return min(pending, key=lambda c: c.started)
+    best, best_noise = None, 1.0
+    for c in configs:
+        if c.converged or c.started >= max_runs:
+            continue
+        stats = aggregator.configs.get(c.key())
+        if c.running == 0 and stats is not None and stats.runs >= min_runs:
+            if noise(stats, 0, success_target, delay_target) <= 1.0:
+                c.converged = True
+                continue
+        value = noise(stats, c.running, success_target, delay_target)
+        if value > best_noise:
+            best, best_noise = c, value
+    return best
+
+
+def sweep(configs, jobs=120, min_runs=30, max_runs=200, success_target=2.0, delay_target=0.05,
+          log_level="summary", crn=False, log_file="run.log"):
+    aggregator = StreamAggregator()
+    aggregator.consume_dir(RESULTS_DIR)    # resume on top of records already in the cache
+    for c in configs:
+        stats = aggregator.configs.get(c.key())
+        c.started = stats.runs if stats is not None else 0
+
+    free_slots = list(range(jobs, 0, -1))
+    running = {}    # Popen -> (config, slot)
+    log = open(log_file, "a")
+    last_report = time.time()
+    try:
+        while True:
+            for process in [p for p in running if p.poll() is not None]:
+                config, slot = running.pop(process)
+                config.running -= 1
+                free_slots.append(slot)
+            aggregator.consume_dir(RESULTS_DIR)
+
+            launched = False
+            if free_slots:
+                config = next_config(configs, aggregator, min_runs, max_runs, success_target, delay_target)
+                if config is not None:
+                    slot = free_slots.pop()
+                    config.started += 1
+                    config.running += 1
+                    rng_run = config.started if crn else random.randint(0, 999999)
+                    command = config.command(config.started, log_level, slot, rng_run)
+                    running[subprocess.Popen(command, shell=True, stdout=log, stderr=log)] = (config, slot)
+                    launched = True
+                elif not running:
+                    break
+
+            if time.time() - last_report >= 60:
+                done = sum(1 for c in configs if c.converged or (c.started >= max_runs and c.running == 0))
+                print("%d runs recorded, %d running, %d/%d configurations done" % (
+                    aggregator.records, len(running), done, len(configs)))
+                last_report = time.time()
+            time.sleep(LAUNCH_DELAY if launched else POLL_INTERVAL)
+    finally:
+        for process in running:
+            process.wait()
+        log.close()
+
+    total = 0
+    for c in configs:
+        stats = aggregator.configs.get(c.key())
+        runs = stats.runs if stats is not None else 0
+        total += runs
+        print("%-30s %4d runs  %s" % (c, runs, "converged" if c.converged else "max runs"))
+    print("%d runs in total, %d with fixed %d replications" % (total, len(configs) * max_runs, max_runs))
+    return aggregator
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("usage: python AdaptiveSweep.py <configs file> [jobs] [min runs] [max runs] [success CI] [delay CI] [log level] [crn]")
+        sys.exit(1)
+    args = sys.argv[2:]
+    sweep(read_configs(sys.argv[1]),
+          jobs=int(args[0]) if len(args) > 0 else 120,
+          min_runs=int(args[1]) if len(args) > 1 else 30,
+          max_runs=int(args[2]) if len(args) > 2 else 200,
+          success_target=float(args[3]) if len(args) > 3 else 2.0,
+          delay_target=float(args[4]) if len(args) > 4 else 0.05,
+          log_level=args[5] if len(args) > 5 else "summary",
+          crn=len(args) > 6 and args[6] == "1")
@@ -1,4 +1,6 @@
 #include "AdhocUdpApplication.h"
+#include "RegkaLog.h"
+#include "RegkaProfile.h"
 #include <ostream>
 #include <iostream>
 #include <fstream>
@@ -6,6 +8,8 @@
 #include <iomanip>
 #include <ctime>
 #include <cmath>
+#include <cstdlib>
+#include <algorithm>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
@@ -18,6 +22,36 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("wifi-adhoc-app");
 
+// A message is a MessageSnapshot ("<epoch> <group> <sender slot> " and the KeyMatrix string) and a forwarding
+// string; on the air every unit of it is "<epoch> <group> <sender slot> <forwarding string> <first row>
+// <row count> <rows><padding>", see MessagePacketizer. Returns the field-th field; the last one runs to the end.
+static std::string MessageField(const std::string& msg, uint32_t field) {
+    size_t start = 0;
+    for (uint32_t i = 0; i < field; i++) {
+        start = msg.find(' ', start) + 1;
+    }
+    size_t end = msg.find(' ', start);
+    return msg.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+// Node i has IPv4 address 10.1.1.(i+1) and the (i+1)-th allocated MAC address, see REGKA.cc
+static uint32_t NodeIdOf(Ipv4Address address) {
+    uint8_t ipBytes[4];
+    address.Serialize(ipBytes);
+    return ipBytes[3] - 1;
+}
+
+static uint32_t NodeIdOf(Mac48Address address) {
+    uint8_t macBytes[6];
+    address.CopyTo(macBytes);
+    return ((macBytes[4] << 8) | macBytes[5]) - 1;
+}
+
+// Send delay in ms, to the microsecond; MilliSeconds() of ns-3.25 takes whole milliseconds
+static Time SendDelay(double delay) {
+    return MicroSeconds(static_cast<uint64_t>(delay * 1000 + 0.5));
+}
+
 
 //------------------------------------------------------
 //-- Sending application implementation
@@ -41,10 +75,20 @@ TypeId AppSender::GetTypeId(void) {
 	return tid;
 }
 
+GroupContext::GroupContext(uint32_t groupId, uint32_t groupSize, uint32_t selfSlot, RandomSource* random)
+    : id(groupId), size(groupSize), self(selfSlot), active(true), completed(false), completionTime(0),
+      matrix(groupSize, selfSlot), tree(groupSize, selfSlot), snapshotEpoch(0) {
+    matrix.SetRandomSource(random);
+}
+
 AppSender::AppSender() {
     m_sendCounter = 0;
     m_nodeId = 0;
     m_networkSize = 0;
+    m_maxUnitSize = 0;
+    m_packing = false;
+    m_unitCounter = 0;
+    m_sendRandom.SetVariable(CreateObject<UniformRandomVariable>());
     m_neighborList = new std::vector<Ipv4Address>();
 }
 
@@ -56,10 +100,28 @@ void AppSender::SetNodeId(uint32_t id) {
 
 void AppSender::SetNetworkSize(uint32_t size) {
     m_networkSize = size;
-    // Initialize KeyMatrix
-    m_keyMatrix.InitializeMatrix(size, m_nodeId);
-    // Initialize KeyGenerationTree
-    m_keyTree = KeyGenerationTree(size, m_nodeId);
+}
+
+void AppSender::SetMaxUnitSize(uint32_t bytes) {
+    m_maxUnitSize = bytes;
+}
+
+void AppSender::SetPacking(bool enabled) {
+    m_packing = enabled;
+}
+
+void AppSender::SetSendPolicy(SendPolicy policy, double slot, uint32_t slots) {
+    m_scheduler.SetPolicy(policy, slot, slots);
+}
+
+int64_t AppSender::AssignStreams(int64_t stream) {
+    m_sendRandom.GetVariable()->SetStream(stream);
+    return 1;
+}
+
+uint32_t AppSender::GetSentUnits(uint32_t group) const {
+    std::map<uint32_t, uint32_t>::const_iterator it = m_groupUnits.find(group);
+    return it != m_groupUnits.end() ? it->second : 0;
 }
 
 // Set send counter
@@ -87,20 +149,30 @@ void AppSender::StartApplication() {
 	m_Socket->SetAllowBroadcast(true);
 	m_Socket->Connect(dataRemote);
 
-    // Initialize forwarding string, initialize as all 0s
-    std::string forwardingContributions = std::string(m_networkSize, '0');
-    // Set ID-th bit to 1
-    forwardingContributions[m_nodeId] = '1';    
-    // First send is broadcast, build packet with content: node ID + forwarding string + local KeyMatrix
-    std::ostringstream packetContent;
-    packetContent << m_nodeId << " " << forwardingContributions << " " << m_keyMatrix.MatrixToString();
-    std::string content = packetContent.str();
-
-    // Calculate computation delay
-    double initDelay = (m_networkSize - 1) * 0.467 + (m_networkSize - 2) * 0.0635;
+    // Nodes outside the initial group stay silent until they join
+    Ptr<AppReceiver> receiver = DynamicCast<AppReceiver>(GetNode()->GetApplication(1));
+    if (!receiver->IsMember()) {
+        return;
+    }
+
+    // First send is broadcast, build packet with content: epoch + group + own slot + own contribution + local KeyMatrix
+    std::vector<Ptr<const MessageSnapshot> > snapshots;
+    std::vector<std::string> contributions;
+    double initDelay = 0;
+    for (uint32_t i = 0; i < receiver->GetInitialGroupCount(); i++) {
+        uint32_t members = receiver->GetInitialMemberCount(i);
+        snapshots.push_back(receiver->GetInitialSnapshot(i));
+        contributions.push_back(receiver->GetInitialContributions(i));
+
+        // Calculate computation delay (ms) and charge its CPU energy; the groups are set up one after the other
+        initDelay += ((members - 1) * CryptoEnergyModel::GetOperationTime(CRYPTO_OP_CONTRIBUTION)
+                      + (members - 2) * CryptoEnergyModel::GetOperationTime(CRYPTO_OP_AGGREGATION)) * 1000;
+        m_cryptoEnergy.Charge(CRYPTO_OP_CONTRIBUTION, members - 1);
+        m_cryptoEnergy.Charge(CRYPTO_OP_AGGREGATION, members - 2);
+    }
     // Send packet
-    m_sendEvent = Simulator::Schedule(MilliSeconds(initDelay), &AppSender::SendPacket, this, m_destAddr, content);
-    NS_LOG_INFO("Node " << m_nodeId << " starts sending first packet");
+    m_sendEvent = Simulator::Schedule(SendDelay(initDelay), &AppSender::SendInitialMessages, this, snapshots, contributions);
+    REGKA_LOG_DETAIL("Node " << m_nodeId << " starts sending first packet");
 
 }
 
@@ -109,39 +181,118 @@ void AppSender::StopApplication() {
 }
 
 
-void AppSender::SendPacket(Ipv4Address neighborAddress, std::string packetContent) {
+void AppSender::Broadcast(Ptr<const MessageSnapshot> snapshot, const std::string& forwardingContributions, double delay) {
+    m_sendEvent = Simulator::Schedule(SendDelay(delay), &AppSender::SendPacket, this, m_destAddr, snapshot, forwardingContributions);
+}
+
+// Own contributions of the initial groups, sent together once all of them are set up
+void AppSender::SendInitialMessages(std::vector<Ptr<const MessageSnapshot> > snapshots, std::vector<std::string> contributions) {
+    for (uint32_t i = 0; i < snapshots.size(); i++) {
+        SendPacket(m_destAddr, snapshots[i], contributions[i]);
+    }
+}
+
+void AppSender::SendPacket(Ipv4Address neighborAddress, Ptr<const MessageSnapshot> snapshot, const std::string& forwardingContributions) {
     Time currentTime = Simulator::Now();
-    NS_LOG_INFO("Node " << m_nodeId << " current time: " << currentTime);
-    Simulator::Schedule(MilliSeconds(1), &AppSender::DoSendPacket, this, neighborAddress, packetContent);
+    REGKA_LOG_DETAIL("Node " << m_nodeId << " current time: " << currentTime);
+    // Processing delay plus the backoff of the send policy
+    uint32_t neighbors = 0;
+    if (m_scheduler.GetPolicy() == SEND_POLICY_DENSITY) {
+        neighbors = DynamicCast<AppReceiver>(GetNode()->GetApplication(1))->GetNeighborTable().GetSize();
+    }
+    if (!m_packing) {
+        double delay = m_scheduler.GetDelay(m_nodeId, neighbors, m_sendRandom);
+        Simulator::Schedule(SendDelay(delay), &AppSender::DoSendPacket, this, neighborAddress, snapshot, forwardingContributions);
+        return;
+    }
+    // The first message to a destination schedules the send; the ones queued until then share its datagrams
+    std::vector<PendingMessage>& pending = m_pending[neighborAddress.Get()];
+    if (pending.empty()) {
+        double delay = m_scheduler.GetDelay(m_nodeId, neighbors, m_sendRandom);
+        Simulator::Schedule(SendDelay(delay), &AppSender::SendPending, this, neighborAddress);
+    }
+    PendingMessage message;
+    message.snapshot = snapshot;
+    message.forwardingContributions = forwardingContributions;
+    pending.push_back(message);
 }
 
-void AppSender::DoSendPacket(Ipv4Address neighborAddress, std::string packetContent) {
-    // Perform key aggregation before sending packet
-    std::string forwardingContributions = packetContent.substr(packetContent.find(" ") + 1, packetContent.find(" ", packetContent.find(" ") + 1) - packetContent.find(" ") - 1);
-    m_keyTree.AddMultipleContributions(forwardingContributions);
-    
-    std::ostringstream msg;
-    msg << packetContent;
+void AppSender::DoSendPacket(Ipv4Address neighborAddress, Ptr<const MessageSnapshot> snapshot, const std::string& forwardingContributions) {
+    REGKA_PROFILE_SCOPE(PROBE_SEND);
+    std::vector<std::string> payloads;
+    BuildUnits(*snapshot, forwardingContributions, payloads);
+    SendPayloads(neighborAddress, payloads);
+}
 
-    int numContributions = 0;
-    if (forwardingContributions == std::string(m_networkSize, '1')) {
-        numContributions = 1;
-    } else {
-        numContributions = std::count(forwardingContributions.begin(), forwardingContributions.end(), '1');
+// Units of every message queued for a destination, packed into as few datagrams as
+// the unit size allows: each datagram joins whole units with ';'
+void AppSender::SendPending(Ipv4Address neighborAddress) {
+    REGKA_PROFILE_SCOPE(PROBE_SEND);
+    std::vector<PendingMessage> messages;
+    messages.swap(m_pending[neighborAddress.Get()]);
+    std::vector<std::string> units;
+    for (uint32_t i = 0; i < messages.size(); i++) {
+        BuildUnits(*messages[i].snapshot, messages[i].forwardingContributions, units);
+    }
+    std::vector<std::string> datagrams;
+    for (uint32_t i = 0; i < units.size(); i++) {
+        if (!datagrams.empty() && (m_maxUnitSize == 0 || datagrams.back().size() + 1 + units[i].size() <= m_maxUnitSize)) {
+            datagrams.back().append(1, ';');
+            datagrams.back().append(units[i]);
+        } else {
+            datagrams.push_back(units[i]);
+        }
     }
-    int additionalBytes = 8*(160 + 64 * (std::ceil(log2(numContributions)) + 1));
-    std::string padding(additionalBytes, '0');
-    msg << padding;
+    SendPayloads(neighborAddress, datagrams);
+}
+
+// Split a message into units that fit the MTU, each aggregated and encrypted on its own,
+// and append their payloads
+void AppSender::BuildUnits(const MessageSnapshot& snapshot, const std::string& forwardingContributions, std::vector<std::string>& payloads) {
+    const std::string& header = snapshot.GetHeader();
+    const std::string& matrix = snapshot.GetMatrix();
+    uint32_t size = forwardingContributions.size();
+    std::vector<MessageUnit> units = MessagePacketizer::Split(forwardingContributions, size, header.size(), m_maxUnitSize);
+
+    // Unit payloads are assembled straight from the shared snapshot
+    for (uint32_t i = 0; i < units.size(); i++) {
+        const MessageUnit& unit = units[i];
+        m_cryptoEnergy.Charge(CRYPTO_OP_AGGREGATION, unit.aggregates > 1 ? unit.aggregates - 1 : 0);
+        // Padding-only units carry the rest of the material already encrypted with the others
+        if (unit.aggregates > 0 || unit.rowCount > 0) {
+            m_cryptoEnergy.Charge(CRYPTO_OP_ENCRYPTION);
+        }
 
-    std::string content = msg.str();
-    Ptr<Packet> packet = Create<Packet>((uint8_t*) content.c_str(), content.size());
-    NS_LOG_INFO("Node " << m_nodeId << " sends packet size: " << packet->GetSize());
+        std::ostringstream rowRange;
+        rowRange << " " << unit.firstRow << " " << unit.rowCount << " ";
+        payloads.push_back(std::string());
+        std::string& content = payloads.back();
+        content.reserve(header.size() + size + rowRange.str().size() + unit.rowCount * size
+                        + unit.padding);
+        content.assign(header);
+        content.append(unit.contributions);
+        content.append(rowRange.str());
+        content.append(matrix, unit.firstRow * size, unit.rowCount * size);
+        content.append(unit.padding, '0');
+    }
+    m_unitCounter += units.size();
+    m_groupUnits[snapshot.GetGroup()] += units.size();
+}
+
+void AppSender::SendPayloads(Ipv4Address neighborAddress, const std::vector<std::string>& payloads) {
     InetSocketAddress remote = InetSocketAddress(neighborAddress, m_destPort);
     m_Socket->Connect(remote);
-    m_Socket->Send(packet);
-    m_sendCounter++;
+    if (!neighborAddress.IsBroadcast()) {
+        DynamicCast<AppReceiver>(GetNode()->GetApplication(1))->NotifyUnicast(neighborAddress, payloads.size());
+    }
+    for (uint32_t i = 0; i < payloads.size(); i++) {
+        Ptr<Packet> packet = Create<Packet>((const uint8_t*) payloads[i].data(), payloads[i].size());
+        REGKA_LOG_DETAIL("Node " << m_nodeId << " sends packet size: " << packet->GetSize());
+        m_Socket->Send(packet);
+        m_sendCounter++;
+    }
     Time sendTime = Simulator::Now();
-    NS_LOG_INFO("Node " << m_nodeId << " send time: " << sendTime);
+    REGKA_LOG_DETAIL("Node " << m_nodeId << " send time: " << sendTime);
 }
 
 
@@ -170,7 +321,16 @@ AppReceiver::AppReceiver() {
     m_isCompleted = false;
     m_nodeId = 0;
     m_networkSize = 0;
-    m_neighborList = new std::vector<Ipv4Address>();
+    m_neighborExpiry = 0;
+    m_propagationTrace = 0;
+    m_forwardingRandom.SetVariable(CreateObject<UniformRandomVariable>());
+    m_layout = 0;
+    m_isMember = true;
+    m_epoch = 0;
+    m_overhearing = false;
+    m_forwardingRule = FORWARDING_RANDOM;
+    m_forwardingBudget = 0;
+    m_overheardCounter = 0;
 }
 
 AppReceiver::~AppReceiver() {
@@ -187,13 +347,264 @@ void AppReceiver::SetNodeId(uint32_t id) {
 	m_nodeId = id;
 }
 
-// Set network size
+// Set network size, one flat group over all nodes
 void AppReceiver::SetNetworkSize(uint32_t size) {
     m_networkSize = size;
-    // Initialize KeyMatrix
-    m_keyMatrix.InitializeMatrix(size, m_nodeId);
-    // Initialize KeyGenerationTree
-    m_keyTree = KeyGenerationTree(size, m_nodeId);
+    m_groups.assign(1, GroupContext(0, size, m_nodeId, &m_forwardingRandom));
+}
+
+// Hierarchical agreement: the node only holds its cluster's KeyMatrix and tree and
+// the top-level ones over the clusters, instead of the flat group's N x N state
+void AppReceiver::SetClusterLayout(const ClusterLayout* layout) {
+    m_layout = layout;
+    m_networkSize = layout->GetNodeCount();
+    uint32_t clusters = layout->GetClusterCount();
+    m_groups.clear();
+    m_groups.push_back(GroupContext(layout->GetCluster(m_nodeId), layout->GetClusterSize(), layout->GetSlot(m_nodeId), &m_forwardingRandom));
+    m_groups.push_back(GroupContext(clusters, clusters, layout->GetCluster(m_nodeId), &m_forwardingRandom));
+    ResetClusters();
+}
+
+// Both levels start over: own contribution in the cluster, top level inactive
+void AppReceiver::ResetClusters() {
+    GroupContext& cluster = m_groups[0];
+    GroupContext& top = m_groups[1];
+    std::vector<bool> slots = m_layout->GetSlotMask(cluster.id);
+    cluster.matrix.ResetMembers(slots);
+    cluster.tree.ResetMembers(slots);
+    cluster.completed = cluster.tree.HasCompleteKey();
+    std::vector<bool> clusters(top.size, true);
+    top.matrix.ResetMembers(clusters);
+    top.tree.ResetMembers(clusters);
+    top.active = false;
+    top.completed = false;
+    m_isCompleted = false;
+}
+
+// Set key contribution propagation trace
+void AppReceiver::SetPropagationTrace(PropagationTrace* trace) {
+    m_propagationTrace = trace;
+}
+
+// Takes effect when the application starts
+void AppReceiver::SetOverhearing(bool enabled) {
+    m_overhearing = enabled;
+}
+
+void AppReceiver::SetForwardingRule(ForwardingRule rule, uint32_t budget) {
+    m_forwardingRule = rule;
+    m_forwardingBudget = budget;
+}
+
+// Fix the stream of the forwarding decisions, independent of how many random variables exist
+int64_t AppReceiver::AssignStreams(int64_t stream) {
+    m_forwardingRandom.GetVariable()->SetStream(stream);
+    return 1;
+}
+
+// State part of this node's messages in a group: group epoch, group, own slot and the group's KeyMatrix.
+// Serialised again only after the KeyMatrix or the epoch changed; the messages still queued keep theirs.
+Ptr<const MessageSnapshot> AppReceiver::GetSnapshot(GroupContext& group) {
+    if (group.snapshot == 0 || group.snapshot->GetVersion() != group.matrix.GetVersion() || group.snapshotEpoch != m_epoch) {
+        REGKA_PROFILE_SCOPE(PROBE_BUILD_MESSAGE);
+        std::ostringstream header;
+        header << m_epoch << " " << group.id << " " << group.self << " ";
+        group.snapshot = Ptr<const MessageSnapshot>(new MessageSnapshot(header.str(), group.matrix, group.id));
+        group.snapshotEpoch = m_epoch;
+    }
+    return group.snapshot;
+}
+
+// Forwarding string of the own contribution only
+std::string AppReceiver::GetOwnContribution(const GroupContext& group) const {
+    std::string forwardingContributions(group.size, '0');
+    forwardingContributions[group.self] = '1';
+    return forwardingContributions;
+}
+
+Ptr<const MessageSnapshot> AppReceiver::GetInitialSnapshot(uint32_t index) {
+    return GetSnapshot(m_groups[index]);
+}
+
+std::string AppReceiver::GetInitialContributions(uint32_t index) const {
+    return GetOwnContribution(m_groups[index]);
+}
+
+// Broadcast the own contribution once the crypto work (delay in ms) is done
+void AppReceiver::BroadcastOwnContribution(GroupContext& group, double delay) {
+    Ptr<AppSender> sender = DynamicCast<AppSender>(GetNode()->GetApplication(0));
+    sender->Broadcast(GetSnapshot(group), GetOwnContribution(group), delay);
+}
+
+GroupContext* AppReceiver::FindGroup(uint32_t id) {
+    for (uint32_t i = 0; i < m_groups.size(); i++) {
+        if (m_groups[i].id == id) {
+            return &m_groups[i];
+        }
+    }
+    return 0;
+}
+
+// Slot of a node in a group: its ID in a flat group, its slot in the own cluster or
+// concurrent group (NO_SLOT for non-members) and its cluster at the top level
+uint32_t AppReceiver::SlotOf(const GroupContext& group, uint32_t nodeId) const {
+    if (!group.nodes.empty()) {
+        std::vector<uint32_t>::const_iterator it = std::lower_bound(group.nodes.begin(), group.nodes.end(), nodeId);
+        return it != group.nodes.end() && *it == nodeId ? it - group.nodes.begin() : GroupContext::NO_SLOT;
+    }
+    if (m_layout == 0) {
+        return nodeId;
+    }
+    if (IsTopLevel(group)) {
+        return m_layout->GetCluster(nodeId);
+    }
+    return m_layout->GetCluster(nodeId) == group.id ? m_layout->GetSlot(nodeId) : GroupContext::NO_SLOT;
+}
+
+// Node owning a slot of the flat group, a concurrent group or a cluster
+uint32_t AppReceiver::NodeOf(const GroupContext& group, uint32_t slot) const {
+    if (!group.nodes.empty()) {
+        return group.nodes[slot];
+    }
+    return m_layout == 0 ? slot : m_layout->GetNode(group.id, slot);
+}
+
+// Completion of the held groups; a completed cluster makes the node present its
+// cluster key at the top level, where every member of the cluster acts for it
+void AppReceiver::UpdateCompletion() {
+    if (m_layout != 0 && m_groups[0].completed && !m_groups[1].active) {
+        GroupContext& top = m_groups[1];
+        top.active = true;
+        top.completed = top.tree.HasCompleteKey();
+        REGKA_LOG_DETAIL("Node " << m_nodeId << " holds the key of cluster " << top.self << ", joining the top level");
+        // Blinded cluster key
+        m_cryptoEnergy.Charge(CRYPTO_OP_CONTRIBUTION);
+        BroadcastOwnContribution(top, CryptoEnergyModel::GetOperationTime(CRYPTO_OP_CONTRIBUTION) * 1000);
+    }
+    // Flat groups are independent: the node is done once it holds the key of every one
+    m_isCompleted = m_layout != 0 ? m_groups.back().completed : true;
+    for (uint32_t i = 0; i < m_groups.size(); i++) {
+        GroupContext& group = m_groups[i];
+        if (group.completed && group.completionTime == 0) {
+            group.completionTime = Simulator::Now().GetSeconds();
+        }
+        if (m_layout == 0) {
+            m_isCompleted = m_isCompleted && group.completed;
+        }
+    }
+}
+
+// Initial group; nodes outside it ignore all traffic until they join
+void AppReceiver::SetMembers(const std::vector<bool>& members) {
+    GroupContext& group = m_groups[0];
+    m_isMember = members[m_nodeId];
+    group.matrix.ResetMembers(members);
+    group.tree.ResetMembers(members);
+}
+
+// Flat groups over member subsets, each with one slot per member like a cluster;
+// nodes outside a group ignore its messages, nodes outside every group stay silent
+void AppReceiver::SetGroups(const std::vector<std::vector<bool> >& groups) {
+    m_groups.clear();
+    for (uint32_t i = 0; i < groups.size(); i++) {
+        if (!groups[i][m_nodeId]) {
+            continue;
+        }
+        std::vector<uint32_t> nodes;
+        for (uint32_t node = 0; node < groups[i].size(); node++) {
+            if (groups[i][node]) {
+                nodes.push_back(node);
+            }
+        }
+        uint32_t self = std::lower_bound(nodes.begin(), nodes.end(), m_nodeId) - nodes.begin();
+        m_groups.push_back(GroupContext(i, nodes.size(), self, &m_forwardingRandom));
+        m_groups.back().nodes.swap(nodes);
+    }
+    m_isMember = !m_groups.empty();
+}
+
+double AppReceiver::GetGroupCompletionTime(uint32_t id) const {
+    for (uint32_t i = 0; i < m_groups.size(); i++) {
+        if (m_groups[i].id == id) {
+            return m_groups[i].completionTime;
+        }
+    }
+    return 0;
+}
+
+// Incremental rekey after a leave: the leaving leaf becomes padding and the sponsor
+// refreshes its contribution, so only the sponsor's path to the root changes
+void AppReceiver::MemberLeave(uint32_t memberId, uint32_t sponsorId, uint32_t epoch) {
+    GroupContext& group = m_groups[0];
+    m_epoch = epoch;
+    group.matrix.RemoveMember(memberId);
+    group.tree.RemoveMember(memberId);
+    group.matrix.ResetContribution(sponsorId);
+    group.tree.RefreshContribution(sponsorId);
+    if (memberId == m_nodeId) {
+        m_isMember = false;
+    }
+    if (!m_isMember) {
+        return;
+    }
+    group.completed = group.tree.HasCompleteKey() || group.matrix.SelfIsFull1();
+    UpdateCompletion();
+    if (sponsorId == m_nodeId) {
+        // New contribution, then the aggregates along its path
+        double delay = (CryptoEnergyModel::GetOperationTime(CRYPTO_OP_CONTRIBUTION)
+                        + group.tree.GetDepth() * CryptoEnergyModel::GetOperationTime(CRYPTO_OP_AGGREGATION)) * 1000;
+        m_cryptoEnergy.Charge(CRYPTO_OP_CONTRIBUTION);
+        m_cryptoEnergy.Charge(CRYPTO_OP_AGGREGATION, group.tree.GetDepth());
+        BroadcastOwnContribution(group, delay);
+    }
+}
+
+// Incremental rekey after a join: members only lack the new contribution, the joining
+// node starts from its own contribution and collects the rest from its neighbors
+void AppReceiver::MemberJoin(uint32_t memberId, const std::vector<bool>& members, uint32_t epoch) {
+    GroupContext& group = m_groups[0];
+    m_epoch = epoch;
+    if (memberId != m_nodeId) {
+        group.matrix.AddMember(memberId);
+        group.tree.AddMember(memberId);
+        group.completed = group.tree.HasCompleteKey() || group.matrix.SelfIsFull1();
+        UpdateCompletion();
+        return;
+    }
+    m_isMember = true;
+    group.matrix.ResetMembers(members);
+    group.tree.ResetMembers(members);
+    group.completed = group.tree.HasCompleteKey();
+    UpdateCompletion();
+    m_cryptoEnergy.Charge(CRYPTO_OP_CONTRIBUTION);
+    BroadcastOwnContribution(group, CryptoEnergyModel::GetOperationTime(CRYPTO_OP_CONTRIBUTION) * 1000);
+}
+
+// Full re-agreement: every member starts over from a fresh contribution, as at the start
+void AppReceiver::RestartAgreement(const std::vector<bool>& members, uint32_t epoch) {
+    GroupContext& group = m_groups[0];
+    m_epoch = epoch;
+    m_isMember = members[m_nodeId];
+    if (m_layout != 0) {
+        ResetClusters();
+    } else {
+        group.matrix.ResetMembers(members);
+        group.tree.ResetMembers(members);
+        group.completed = group.tree.HasCompleteKey();
+        UpdateCompletion();
+    }
+    if (!m_isMember) {
+        return;
+    }
+    uint32_t count = group.matrix.GetMemberCount();
+    if (count < 2) {
+        return;
+    }
+    double delay = ((count - 1) * CryptoEnergyModel::GetOperationTime(CRYPTO_OP_CONTRIBUTION)
+                    + (count - 2) * CryptoEnergyModel::GetOperationTime(CRYPTO_OP_AGGREGATION)) * 1000;
+    m_cryptoEnergy.Charge(CRYPTO_OP_CONTRIBUTION, count - 1);
+    m_cryptoEnergy.Charge(CRYPTO_OP_AGGREGATION, count - 2);
+    BroadcastOwnContribution(group, delay);
 }
 
 // Set receive counter
@@ -217,6 +628,47 @@ bool AppReceiver::IsCompleted() const {
     return m_isCompleted;
 }
 
+// Contributions covered by the held keys: own row of the flat KeyMatrix, the own cluster's
+// members held plus the members of every other cluster whose key is held, or the own rows
+// summed over concurrent groups
+uint32_t AppReceiver::GetContributionCount() const {
+    uint32_t count = 0;
+    if (m_layout == 0 && m_groups.size() != 1) {
+        for (uint32_t g = 0; g < m_groups.size(); g++) {
+            const GroupContext& group = m_groups[g];
+            for (uint32_t i = 0; i < group.size; i++) {
+                if (group.matrix.HasKeyContribution(group.self, i)) {
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+    const GroupContext& own = m_groups[0];
+    for (uint32_t i = 0; i < own.size; i++) {
+        if (NodeOf(own, i) != ClusterLayout::NO_NODE && own.matrix.HasKeyContribution(own.self, i)) {
+            count++;
+        }
+    }
+    if (m_layout != 0 && m_groups[1].active) {
+        const GroupContext& top = m_groups[1];
+        for (uint32_t c = 0; c < top.size; c++) {
+            if (c != top.self && top.matrix.HasKeyContribution(top.self, c)) {
+                count += m_layout->GetMemberCount(c);
+            }
+        }
+    }
+    return count;
+}
+
+uint32_t AppReceiver::GetMatrixBits() const {
+    uint32_t bits = 0;
+    for (uint32_t i = 0; i < m_groups.size(); i++) {
+        bits += m_groups[i].size * m_groups[i].size;
+    }
+    return bits;
+}
+
 
 // Used to release resources
 void AppReceiver::DoDispose(void) {
@@ -226,18 +678,37 @@ void AppReceiver::DoDispose(void) {
 
     // Update neighbor list, keep only the latest N/2 neighbors, N is node count
 void AppReceiver::UpdateNeighborList(Ipv4Address neighborAddress) {
-    // If neighbor is in neighbor list, don't add
-    if (std::find(m_neighborList->begin(), m_neighborList->end(), neighborAddress) != m_neighborList->end()) {
-        // Move this neighbor's position in neighbor list to end of list
-        m_neighborList->erase(std::find(m_neighborList->begin(), m_neighborList->end(), neighborAddress));
-        m_neighborList->push_back(neighborAddress);
-    } else {
-        // Otherwise add neighbor, keep only latest N/2 neighbors
-        m_neighborList->push_back(neighborAddress);
-        if (m_neighborList->size() > m_networkSize / 2) {
-            m_neighborList->erase(m_neighborList->begin());
-        }
+    m_neighbors.Heard(NodeIdOf(neighborAddress), neighborAddress.Get(), Simulator::Now().GetSeconds());
+}
+
+// Neighbor table policy, takes effect when the application starts
+void AppReceiver::SetNeighborPolicy(double expiry, double minDelivery, uint32_t maxTargets, bool rank) {
+    m_neighborExpiry = expiry;
+    m_neighbors.SetTargetPolicy(minDelivery, maxTargets, rank);
+}
+
+// Unicast units handed to the MAC by the sender, the base of the delivery estimate
+void AppReceiver::NotifyUnicast(Ipv4Address neighborAddress, uint32_t units) {
+    m_neighbors.RecordSent(NodeIdOf(neighborAddress), units);
+}
+
+// PHY receive trace: signal of every data frame heard, whoever it is addressed to
+void AppReceiver::PhyRx(Ptr<const Packet> packet, uint16_t, uint16_t, uint32_t, WifiPreamble, WifiTxVector,
+                        struct mpduInfo, struct signalNoiseDbm signalNoise) {
+    WifiMacHeader header;
+    if (packet->PeekHeader(header) == 0 || !header.IsData()) {
+        return;
     }
+    m_neighbors.RecordSignal(NodeIdOf(header.GetAddr2()), signalNoise.signal - signalNoise.noise, signalNoise.signal);
+}
+
+// Remote station manager traces: one failed attempt, and a unit given up after the retry limit
+void AppReceiver::MacTxRetry(Mac48Address address) {
+    m_neighbors.RecordRetry(NodeIdOf(address));
+}
+
+void AppReceiver::MacTxDrop(Mac48Address address) {
+    m_neighbors.RecordDrop(NodeIdOf(address));
 }
 
 // Start application
@@ -250,18 +721,36 @@ void AppReceiver::StartApplication() {
     // Bind IP address and port
     InetSocketAddress local = InetSocketAddress(address, m_port);
 	m_socket->Bind(local);
-    NS_LOG_INFO("Node " << m_nodeId << " starts listening: " << address << ":" << m_port);
+    REGKA_LOG_DETAIL("Node " << m_nodeId << " starts listening: " << address << ":" << m_port);
 	    // Set callback (what for?)
     m_socket->SetRecvCallback(MakeCallback(&AppReceiver::Receive, this));
+
+    // Neighbor table fed by the link quality traces of the WiFi device
+    m_neighbors.Initialize(m_networkSize, m_networkSize / 2, m_neighborExpiry);
+    Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice>(GetNode()->GetObject<Ipv4>()->GetNetDevice(1));
+    if (device != 0) {
+        device->GetPhy()->TraceConnectWithoutContext("MonitorSnifferRx", MakeCallback(&AppReceiver::PhyRx, this));
+        device->GetRemoteStationManager()->TraceConnectWithoutContext("MacTxDataFailed", MakeCallback(&AppReceiver::MacTxRetry, this));
+        device->GetRemoteStationManager()->TraceConnectWithoutContext("MacTxFinalDataFailed", MakeCallback(&AppReceiver::MacTxDrop, this));
+    }
+    // Promiscuous IPv4 handler on the WiFi device, which also puts its MAC in promiscuous mode
+    if (m_overhearing) {
+        GetNode()->RegisterProtocolHandler(MakeCallback(&AppReceiver::Overhear, this), Ipv4L3Protocol::PROT_NUMBER,
+                                           GetNode()->GetObject<Ipv4>()->GetNetDevice(1), true);
+    }
 }
 
 void AppReceiver::StopApplication() {
 	if (m_socket != 0) {
 		m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
 	}
+	if (m_overhearing) {
+		GetNode()->UnregisterProtocolHandler(MakeCallback(&AppReceiver::Overhear, this));
+	}
 }
 
 void AppReceiver::Receive(Ptr<Socket> socket) {
+    REGKA_PROFILE_SCOPE(PROBE_RECEIVE);
     Ptr<Packet> packet;
     Address from;
 
@@ -271,7 +760,7 @@ void AppReceiver::Receive(Ptr<Socket> socket) {
         // Add sender address to neighbor list
         UpdateNeighborList(senderAddr);
         // Node received message packet from XX neighbor
-        NS_LOG_INFO("Node " << m_nodeId << " received message packet from " << senderAddr);
+        REGKA_LOG_DETAIL("Node " << m_nodeId << " received message packet from " << senderAddr);
                
         // Extract data from packet
         uint8_t *buffer = new uint8_t[packet->GetSize()];
@@ -279,66 +768,177 @@ void AppReceiver::Receive(Ptr<Socket> socket) {
         std::string msg = std::string((char*)buffer, packet->GetSize());
         delete[] buffer;
 
-        std::istringstream senderIdStream(msg.substr(0, msg.find(" ")));
-        uint32_t senderId;
-        senderIdStream >> senderId;
-
-        std::string ReceivedKeyContributions = msg.substr(msg.find(" ") + 1, msg.find(" ", msg.find(" ") + 1) - msg.find(" ") - 1);
-        NS_LOG_INFO("Node " << m_nodeId << " received key contributions: " << ReceivedKeyContributions);
-
-        std::string ReceivedKeyMatrixString = msg.substr(msg.find(" ", msg.find(" ") + 1) + 1, m_networkSize * m_networkSize);
-        NS_LOG_INFO("Node " << m_nodeId << " received key matrix: " << ReceivedKeyMatrixString);
-
-        // Create received matrix
-        KeyMatrix ReceivedMatrix = m_keyMatrix.StringToMatrix(ReceivedKeyMatrixString);
-        
-        // Use KeyGenerationTree to process received key contributions
-        m_keyTree.AddMultipleContributions(ReceivedKeyContributions);
-        
-        // Iterate through received key contribution ID set, check if local has that key contribution
-        for (uint32_t i = 0; i < ReceivedKeyContributions.size(); i++) {
-            if (m_keyMatrix.HasKeyContribution(m_nodeId, i)) {
-                continue;
-            } else {
-                m_keyMatrix.ReceiveKeyContribution(i);
-                NS_LOG_INFO("Node " << m_nodeId << " does not have key contribution " << i << ", accepting this key contribution");
-            }   
+        HandleDatagram(msg, true);
+    }
+}
+
+// Unicasts to other nodes, overheard through the promiscuous device; fragments of
+// whole messages are not reassembled
+void AppReceiver::Overhear(Ptr<NetDevice>, Ptr<const Packet> packet, uint16_t, const Address&, const Address&,
+                           NetDevice::PacketType packetType) {
+    // Addressed and broadcast packets come through the socket
+    if (packetType != NetDevice::PACKET_OTHERHOST) {
+        return;
+    }
+    Ptr<Packet> copy = packet->Copy();
+    Ipv4Header ipHeader;
+    copy->RemoveHeader(ipHeader);
+    if (ipHeader.GetProtocol() != UdpL4Protocol::PROT_NUMBER || !ipHeader.IsLastFragment() || ipHeader.GetFragmentOffset() != 0) {
+        return;
+    }
+    UdpHeader udpHeader;
+    copy->RemoveHeader(udpHeader);
+    if (udpHeader.GetDestinationPort() != m_port) {
+        return;
+    }
+    m_overheardCounter++;
+    UpdateNeighborList(ipHeader.GetSource());
+    REGKA_LOG_DETAIL("Node " << m_nodeId << " overheard message packet from " << ipHeader.GetSource() << " to " << ipHeader.GetDestination());
+
+    uint8_t *buffer = new uint8_t[copy->GetSize()];
+    copy->CopyData(buffer, copy->GetSize());
+    std::string msg = std::string((char*)buffer, copy->GetSize());
+    delete[] buffer;
+    HandleDatagram(msg, false);
+}
+
+// A datagram carries one message unit, or several joined with ';' by a packing sender
+void AppReceiver::HandleDatagram(const std::string& datagram, bool addressed) {
+    size_t end = datagram.find(';');
+    if (end == std::string::npos) {
+        HandleMessage(datagram, addressed);
+        return;
+    }
+    size_t start = 0;
+    while (end != std::string::npos) {
+        HandleMessage(datagram.substr(start, end - start), addressed);
+        start = end + 1;
+        end = datagram.find(';', start);
+    }
+    HandleMessage(datagram.substr(start), addressed);
+}
+
+// Merge one message unit into the group state; only addressed messages trigger forwarding
+void AppReceiver::HandleMessage(const std::string& msg, bool addressed) {
+    REGKA_PROFILE_SCOPE(PROBE_HANDLE_MESSAGE);
+    // Outside the group, or sent before the latest membership change
+    if (!m_isMember || std::strtoul(MessageField(msg, 0).c_str(), 0, 10) != m_epoch) {
+        REGKA_LOG_DETAIL("Node " << m_nodeId << " ignores packet outside its group epoch");
+        return;
+    }
+
+    // Groups the node does not hold, or the top level before the own cluster key is known
+    GroupContext* group = FindGroup(std::strtoul(MessageField(msg, 1).c_str(), 0, 10));
+    if (group == 0 || !group->active) {
+        REGKA_LOG_DETAIL("Node " << m_nodeId << " ignores packet of a group it does not take part in");
+        return;
+    }
+
+    m_cryptoEnergy.Charge(CRYPTO_OP_DECRYPTION);
+
+    uint32_t senderSlot = std::strtoul(MessageField(msg, 2).c_str(), 0, 10);
+
+    std::string ReceivedKeyContributions = MessageField(msg, 3);
+    REGKA_LOG_DUMP("Node " << m_nodeId << " received key contributions: " << ReceivedKeyContributions);
+
+    // Rows of the sender's KeyMatrix carried by this unit
+    uint32_t firstRow = std::strtoul(MessageField(msg, 4).c_str(), 0, 10);
+    uint32_t rowCount = std::strtoul(MessageField(msg, 5).c_str(), 0, 10);
+    std::string ReceivedKeyMatrixString = MessageField(msg, 6).substr(0, rowCount * group->size);
+    REGKA_LOG_DUMP("Node " << m_nodeId << " received key matrix rows " << firstRow << "+" << rowCount << ": " << ReceivedKeyMatrixString);
+    
+    // Use KeyGenerationTree to process received key contributions
+    group->tree.AddMultipleContributions(ReceivedKeyContributions);
+    
+    // Iterate through received key contribution ID set, check if local has that key contribution
+    std::string accepted(group->size, '0');
+    for (uint32_t i = 0; i < ReceivedKeyContributions.size(); i++) {
+        if (ReceivedKeyContributions[i] != '1') {
+            continue;
+        }
+        // Contributions of single nodes only, cluster keys are not traced
+        if (m_propagationTrace != 0 && !IsTopLevel(*group)) {
+            m_propagationTrace->RecordDelivery(Simulator::Now().GetSeconds(), m_nodeId, NodeOf(*group, i), NodeOf(*group, senderSlot));
+        }
+        if (group->matrix.HasKeyContribution(group->self, i)) {
+            continue;
+        } else {
+            group->matrix.ReceiveKeyContribution(i);
+            accepted[i] = '1';
+            m_cryptoEnergy.Charge(CRYPTO_OP_AGGREGATION);
+            REGKA_LOG_DETAIL("Node " << m_nodeId << " does not have key contribution " << i << " of group " << group->id << ", accepting this key contribution");
         }   
+    }   
+
 
+    // Merge received KeyMatrix rows to local KeyMatrix
+    group->matrix.MergeRows(firstRow, ReceivedKeyMatrixString);
+    REGKA_LOG_DUMP("Node " << m_nodeId << " merged KeyMatrix state: " << group->matrix.MatrixToString());
 
-        // Merge received KeyMatrix to local KeyMatrix
-        m_keyMatrix.MergeMatrix(ReceivedMatrix);	
-        NS_LOG_INFO("Node " << m_nodeId << " merged KeyMatrix state: " << m_keyMatrix.MatrixToString());
+    // Check if KeyGenerationTree already has complete group key
+    if(group->tree.HasCompleteKey()) {
+        REGKA_LOG_DETAIL("Node " << m_nodeId << " has collected all key contributions of group " << group->id << " through KeyGenerationTree");
+        group->completed = true;
+    }
+    
+    // If self has all key contributions, the group is completed
+    if(group->matrix.SelfIsFull1()) {
+        REGKA_LOG_DETAIL("Node " << m_nodeId << " has collected all key contributions of group " << group->id);
+        group->completed = true;
+    }
+    UpdateCompletion();
+
+    // A unit without contributions only updates what the neighbours are known to hold, and
+    // overheard messages only update state: the addressed neighbour does the forwarding
+    if (!addressed || ReceivedKeyContributions.find('1') == std::string::npos) {
+        return;
+    }
+
+    Ptr<AppSender> sender = DynamicCast<AppSender>(GetNode()->GetApplication(0));
 
-        // Check if KeyGenerationTree already has complete group key
-        if(m_keyTree.HasCompleteKey()) {
-            NS_LOG_INFO("Node " << m_nodeId << " has collected all key contributions through KeyGenerationTree");
-            m_isCompleted = true;
+    // Top-level rows are per cluster, so they cannot tell what a neighbour of the
+    // own cluster lacks: newly learned cluster keys are broadcast once instead
+    if (IsTopLevel(*group) && accepted.find('1') != std::string::npos) {
+        sender->SendPacket(m_destAddr, GetSnapshot(*group), accepted);
+    }
+
+    // Forwarding key contributions to neighbors (best expected delivery first when ranked); stale and weak ones are left out
+    std::vector<uint32_t> targets = m_neighbors.GetTargets(Simulator::Now().GetSeconds());
+    // Rarest-first: the contributions whose crypto material fits the budget, and the
+    // neighbours' slots to break ties by need
+    uint32_t maxContributions = 0;
+    std::vector<uint32_t> neighborSlots;
+    if (m_forwardingRule == FORWARDING_RAREST_FIRST) {
+        maxContributions = MessagePacketizer::GetContributionBudget(m_forwardingBudget);
+        for (uint32_t i = 0; i < targets.size(); i++) {
+            uint32_t slot = SlotOf(*group, targets[i]);
+            if (slot != GroupContext::NO_SLOT && slot != group->self) {
+                neighborSlots.push_back(slot);
+            }
+        }
+    }
+    // Every neighbor's message shares one snapshot of the merged state
+    Ptr<const MessageSnapshot> snapshot;
+    for (uint32_t i = 0; i < targets.size(); i++) {     
+        Ipv4Address neighborAddr = Ipv4Address(m_neighbors.GetAddress(targets[i]));
+        uint32_t neighborSlot = SlotOf(*group, targets[i]);
+        // Nodes of other clusters or concurrent groups, or that left the group, get nothing
+        if (neighborSlot == GroupContext::NO_SLOT || !group->matrix.IsMember(neighborSlot)) {
+            continue;
         }
-        
-        // If self has all key contributions, set m_isCompleted to true
-        if(m_keyMatrix.SelfIsFull1()) {
-                         NS_LOG_INFO("Node " << m_nodeId << " has collected all key contributions");
-            m_isCompleted = true;
+        if (IsTopLevel(*group) && neighborSlot == group->self) {
+            continue;
         }
 
-        // Forwarding key contributions to neighbors
-        for (uint32_t i = 0; i < m_neighborList->size(); i++) {     
-            Ipv4Address neighborAddr = m_neighborList->at(i);
-            uint8_t ipBytes[4];
-            neighborAddr.Serialize(ipBytes);
-            uint32_t neighborId = ipBytes[3]-1;
-
-            std::string forwardingContributions = m_keyMatrix.GetForwardingContributions(neighborId);
-            if (forwardingContributions != std::string(m_networkSize, '0')) {               
-                std::ostringstream msg; 
-                msg << m_nodeId << " " << forwardingContributions << " " << m_keyMatrix.MatrixToString();
-                std::string content = msg.str();
-                
-                Ptr<AppSender> sender = DynamicCast<AppSender>(GetNode()->GetApplication(0));
-                sender->SendPacket(neighborAddr, content);
-                NS_LOG_INFO("Node " << m_nodeId << " sent packet to " << neighborAddr);
+        std::string forwardingContributions = m_forwardingRule == FORWARDING_RAREST_FIRST
+            ? group->matrix.GetRarestContributions(neighborSlot, neighborSlots, maxContributions)
+            : group->matrix.GetForwardingContributions(neighborSlot);
+        if (forwardingContributions.find('1') != std::string::npos) {               
+            if (snapshot == 0) {
+                snapshot = GetSnapshot(*group);
             }
+            sender->SendPacket(neighborAddr, snapshot, forwardingContributions);
+            REGKA_LOG_DETAIL("Node " << m_nodeId << " sent packet to " << neighborAddr);
         }
     }
 }
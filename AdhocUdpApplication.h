@@ -3,11 +3,19 @@
 
 #include "KeyMatrix.h"
 #include "KeyGenerationTree.h"
+#include "PropagationTrace.h"
+#include "CryptoEnergyModel.h"
+#include "ClusterLayout.h"
+#include "MessagePacketizer.h"
+#include "MessageSnapshot.h"
+#include "NeighborTable.h"
+#include "SendScheduler.h"
 #include "ns3/core-module.h"
 #include "ns3/application.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/stats-module.h"
+#include "ns3/wifi-module.h"
 #include <map>
 #include <string>
 #include <fstream>
@@ -16,6 +24,44 @@
 
 using namespace ns3;
 
+/**
+ * KeyMatrix random source drawing from an ns-3 random variable stream,
+ * so forwarding decisions follow RngRun and explicit stream assignment
+ */
+class StreamRandomSource: public RandomSource {
+public:
+	void SetVariable(Ptr<RandomVariableStream> variable) { m_variable = variable; }
+	Ptr<RandomVariableStream> GetVariable() const { return m_variable; }
+	virtual double GetUniform() { return m_variable->GetValue(); }
+
+private:
+	Ptr<RandomVariableStream> m_variable;
+};
+
+/**
+ * One agreement a node takes part in. Its slots are the KeyGenerationTree leaves and
+ * the KeyMatrix rows/columns: one per node in a flat group, one per member in a
+ * cluster or a concurrent group, one per cluster at the top level of a hierarchical
+ * agreement.
+ */
+struct GroupContext {
+	static const uint32_t NO_SLOT = 0xffffffff;
+
+	GroupContext(uint32_t groupId, uint32_t groupSize, uint32_t selfSlot, RandomSource* random);
+
+	uint32_t id;				// Group id carried in the group's messages
+	uint32_t size;				// Slot count
+	uint32_t self;				// Own slot
+	bool active;				// Whether the node takes part (the top level once its cluster key is known)
+	bool completed;				// Whether the node holds the group's key
+	double completionTime;		// When the node first held the group's key (s), 0 before
+	KeyMatrix matrix;			// KeyMatrix over the slots
+	KeyGenerationTree tree;		// Key generation tree over the slots
+	Ptr<const MessageSnapshot> snapshot;	// Latest serialised state, see AppReceiver::GetSnapshot
+	uint32_t snapshotEpoch;		// Group epoch in the snapshot's header
+	std::vector<uint32_t> nodes;	// Node of every slot of a concurrent group, ascending; empty otherwise
+};
+
 /**
  * Sending application
  */
@@ -27,26 +73,44 @@ public:
 	void SetSendCounter(Ptr<CounterCalculator<> > sendCounter); // Set send counter
 	void SetNodeId(uint32_t id); // Set node ID
 	void SetNetworkSize(uint32_t size); // Set network size
+	void SetMaxUnitSize(uint32_t bytes); // Largest UDP payload of a message unit, 0 sends whole messages
+	void SetPacking(bool enabled); // Pack the units of all messages to one neighbor within a send delay into shared datagrams
+	void SetSendPolicy(SendPolicy policy, double slot, uint32_t slots); // See SendScheduler, slot in ms
+	int64_t AssignStreams(int64_t stream); // Stream of the send backoff, returns the number of streams used
 	void AddNeighbor(Ipv4Address neighbor); // Add neighbor
 	void UpdateNeighborList(Ipv4Address neighborAddress); // Update neighbor list
-	void SendPacket(Ipv4Address neighborAddress, std::string packetContent); 
-	void DoSendPacket(Ipv4Address neighborAddress, std::string packetContent); // Send packet to specified neighbor
+	// A message is the sender's shared state snapshot plus the forwarding string for this neighbor
+	void SendPacket(Ipv4Address neighborAddress, Ptr<const MessageSnapshot> snapshot, const std::string& forwardingContributions); 
+	void DoSendPacket(Ipv4Address neighborAddress, Ptr<const MessageSnapshot> snapshot, const std::string& forwardingContributions); // Send packet to specified neighbor
+	void Broadcast(Ptr<const MessageSnapshot> snapshot, const std::string& forwardingContributions, double delay); // Broadcast after delay (ms) of crypto work
 	
 	// Get sent packet count
 	uint32_t GetSentPackets() const { return m_sendCounter; }
+	// Message units sent before packing, in total and of one group
+	uint32_t GetSentUnits() const { return m_unitCounter; }
+	uint32_t GetSentUnits(uint32_t group) const;
 	// Get neighbor list
 	std::vector<Ipv4Address>* GetNeighborList() { return m_neighborList; }
 	
-	// Get key generation tree status
-	const KeyGenerationTree& GetKeyTree() const { return m_keyTree; }
-	bool HasCompleteKey() const { return m_keyTree.HasCompleteKey(); }
+	// CPU energy of the crypto work done by the sender
+	CryptoEnergyModel& GetCryptoEnergy() { return m_cryptoEnergy; }
 
 protected:
 	virtual void DoDispose(void);
 
 private:
+	// A message waiting for the packed send to its destination
+	struct PendingMessage {
+		Ptr<const MessageSnapshot> snapshot;
+		std::string forwardingContributions;
+	};
+
 	virtual void StartApplication(void);
 	virtual void StopApplication(void);
+	void SendInitialMessages(std::vector<Ptr<const MessageSnapshot> > snapshots, std::vector<std::string> contributions);
+	void SendPending(Ipv4Address neighborAddress);
+	void BuildUnits(const MessageSnapshot& snapshot, const std::string& forwardingContributions, std::vector<std::string>& payloads);
+	void SendPayloads(Ipv4Address neighborAddress, const std::vector<std::string>& payloads);
 
 	uint32_t m_pktSize;		// Packet size
 	Ipv4Address m_destAddr;	// Destination address
@@ -58,8 +122,14 @@ private:
 	uint32_t m_nodeId;			// Node ID
 	std::vector<Ipv4Address>* m_neighborList;	// Neighbor list
 	uint32_t m_networkSize;		// Network size
-	KeyMatrix m_keyMatrix;		// KeyMatrix
-	KeyGenerationTree m_keyTree;	// Key generation tree
+	uint32_t m_maxUnitSize;		// Largest UDP payload of a message unit, 0 for whole messages
+	CryptoEnergyModel m_cryptoEnergy;	// Crypto CPU energy
+	bool m_packing;				// Whether messages to the same neighbor share datagrams
+	std::map<uint32_t, std::vector<PendingMessage> > m_pending;	// Messages waiting, by destination address
+	uint32_t m_unitCounter;		// Message units sent
+	std::map<uint32_t, uint32_t> m_groupUnits;	// Message units sent, by group id
+	SendScheduler m_scheduler;	// Backoff before every send
+	StreamRandomSource m_sendRandom;	// Randomness of the backoff (own stream per node)
 };
 
 // -------------------------------------------------------------------
@@ -76,12 +146,44 @@ public:
 	void SetNumNodes(uint32_t num);
 	void SetNodeId(uint32_t id);
 	void SetNetworkSize(uint32_t size);
+	void SetPropagationTrace(PropagationTrace* trace); // Optional, owned by the simulation
+	int64_t AssignStreams(int64_t stream); // Stream of the forwarding decisions, returns the number of streams used
+	bool IsMember() const { return m_isMember; }
+	void SetOverhearing(bool enabled); // Also merge overheard unicasts between other nodes
+	void SetForwardingRule(ForwardingRule rule, uint32_t budget); // Budget: crypto material bytes of rarest-first, 0 for none
+	void SetNeighborPolicy(double expiry, double minDelivery, uint32_t maxTargets, bool rank); // See NeighborTable
+	void NotifyUnicast(Ipv4Address neighborAddress, uint32_t units); // Units the sender unicast to a neighbor
+	const NeighborTable& GetNeighborTable() const { return m_neighbors; }
+	// Groups the node starts with: the flat group, the own cluster, or every concurrent group it belongs to.
+	// Member count, and the own contribution as state snapshot and forwarding string
+	uint32_t GetInitialGroupCount() const { return m_layout != 0 ? 1 : m_groups.size(); }
+	uint32_t GetInitialMemberCount(uint32_t index) const { return m_groups[index].matrix.GetMemberCount(); }
+	Ptr<const MessageSnapshot> GetInitialSnapshot(uint32_t index);
+	std::string GetInitialContributions(uint32_t index) const;
+
+	// Hierarchical agreement: the own cluster first, then the top level of cluster keys
+	void SetClusterLayout(const ClusterLayout* layout);
+
+	// Group membership, see REGKA.cc: the initial group, then incremental rekeys or full re-agreements
+	void SetMembers(const std::vector<bool>& members);
+	void MemberLeave(uint32_t memberId, uint32_t sponsorId, uint32_t epoch);
+	void MemberJoin(uint32_t memberId, const std::vector<bool>& members, uint32_t epoch);
+	void RestartAgreement(const std::vector<bool>& members, uint32_t epoch);
+	// Concurrent groups over member subsets of the nodes, group i with id i; the node holds those it belongs to
+	void SetGroups(const std::vector<std::vector<bool> >& groups);
+	double GetGroupCompletionTime(uint32_t id) const; // 0 if the node never held the group's key
 	uint32_t GetReceivedPackets() const; 
-	bool IsCompleted() const; 
+	uint32_t GetOverheardPackets() const { return m_overheardCounter; } // Not part of the received packets
+	bool IsCompleted() const; // Holds the key of the hierarchical agreement, or of every group it belongs to
 	double GetKeyAgreementDelay() const; 
-	const KeyMatrix& GetKeyMatrix() const { return m_keyMatrix; }
-	const KeyGenerationTree& GetKeyTree() const { return m_keyTree; }
-	bool HasCompleteKey() const { return m_keyTree.HasCompleteKey(); }
+	// State of the flat group, or of the own cluster in a hierarchical agreement
+	const KeyMatrix& GetKeyMatrix() const { return m_groups[0].matrix; }
+	const KeyGenerationTree& GetKeyTree() const { return m_groups[0].tree; }
+	bool HasCompleteKey() const { return m_groups.back().tree.HasCompleteKey(); }
+	uint32_t GetContributionCount() const; // Nodes whose contributions the held keys cover
+	uint32_t GetMatrixBits() const; // KeyMatrix state held over all groups
+	// CPU energy of the crypto work done by the receiver
+	CryptoEnergyModel& GetCryptoEnergy() { return m_cryptoEnergy; }
 
 	void UpdateNeighborList(Ipv4Address neighborAddress);
 
@@ -93,6 +195,23 @@ private:
 	virtual void StopApplication(void);
 
 	void Receive(Ptr<Socket> socket);
+	void Overhear(Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+			const Address& from, const Address& to, NetDevice::PacketType packetType);
+	void HandleDatagram(const std::string& datagram, bool addressed);
+	void HandleMessage(const std::string& msg, bool addressed);
+	void PhyRx(Ptr<const Packet> packet, uint16_t channelFreqMhz, uint16_t channelNumber, uint32_t rate,
+			WifiPreamble preamble, WifiTxVector txVector, struct mpduInfo aMpdu, struct signalNoiseDbm signalNoise);
+	void MacTxRetry(Mac48Address address);
+	void MacTxDrop(Mac48Address address);
+	Ptr<const MessageSnapshot> GetSnapshot(GroupContext& group);
+	std::string GetOwnContribution(const GroupContext& group) const;
+	void BroadcastOwnContribution(GroupContext& group, double delay);
+	GroupContext* FindGroup(uint32_t id);
+	uint32_t SlotOf(const GroupContext& group, uint32_t nodeId) const;
+	uint32_t NodeOf(const GroupContext& group, uint32_t slot) const;
+	bool IsTopLevel(const GroupContext& group) const { return m_layout != 0 && group.id == m_layout->GetClusterCount(); }
+	void ResetClusters();
+	void UpdateCompletion();
 
 	Ptr<Socket> m_socket; 
 	Ipv4Address m_destAddr;
@@ -108,18 +227,37 @@ private:
 	bool m_isCompleted;
 	// Network size
 	uint32_t m_networkSize;
-	// KeyMatrix
-	KeyMatrix m_keyMatrix;
-	// Key generation tree
-	KeyGenerationTree m_keyTree;
+	// Groups the node takes part in: the flat group, its cluster and the top level, or its concurrent groups
+	std::vector<GroupContext> m_groups;
+	// Cluster layout of a hierarchical agreement, null for a flat group
+	const ClusterLayout* m_layout;
 	// Receive counter
 	uint32_t m_receivedCounter;
-	// Neighbor list
-	std::vector<Ipv4Address>* m_neighborList;
+	// Neighbors heard recently, with their link quality
+	NeighborTable m_neighbors;
+	// Neighbors not heard for this long are dropped (s), 0 for never
+	double m_neighborExpiry;
 	// Packet buffer
 	std::map<std::string, int>* m_packetBuffer;
 	// Key agreement completion time
 	double m_keyAgreementDelay;
+	// Key contribution propagation trace, null when tracing is off
+	PropagationTrace* m_propagationTrace;
+	// Crypto CPU energy
+	CryptoEnergyModel m_cryptoEnergy;
+	// Forwarding decision randomness of the KeyMatrix (own stream per node)
+	StreamRandomSource m_forwardingRandom;
+	// Whether the node currently belongs to the group
+	bool m_isMember;
+	// Group epoch, bumped by every membership change; messages of other epochs are dropped
+	uint32_t m_epoch;
+	// Whether unicasts between other nodes are overheard and merged
+	bool m_overhearing;
+	// Forwarding rule, and the unit size rarest-first fills (bytes, 0 for no limit)
+	ForwardingRule m_forwardingRule;
+	uint32_t m_forwardingBudget;
+	// Overheard packets, not counted as received
+	uint32_t m_overheardCounter;
 };
 
 
@@ -3,31 +3,13 @@ import os
 import sqlite3
 import pandas as pd
 from datetime import datetime
+from ResultsMerge import merge_results
+from StreamAggregator import StreamAggregator
 
 def merge_csv_files():
-    """Merge CSV files"""
-    input_files = sorted(glob.glob("results_cache/*.csv"))
-    # Filename is timestamp_Result.csv
-    # Get current timestamp
-    timestamp = datetime.now().strftime("%Y%m%d%H%M%S")
-    output_file = timestamp + "_Result.csv"
-
-    with open(output_file, "w") as fout:
-        for fname in input_files:
-            with open(fname, "r") as fin:
-                for line in fin:
-                    line = line.strip()
-                    if not line:
-                        continue  # Skip empty lines
-                    fout.write(line + "\n")
-
-    # Clear results_cache directory after merging
-    for fname in input_files:
-        os.remove(fname)
-
-    print("Merged %d files to %s" % (len(input_files), output_file))
-    
-    return output_file
+    """Merge the per-worker binary results files into CSV views"""
+    csv_file, nodes_file = merge_results("results_cache")
+    return csv_file
 
 def create_database(csv_file=None, db_file=None):
     """Convert CSV file to SQLite database"""
@@ -49,15 +31,10 @@ def create_database(csv_file=None, db_file=None):
         return None
 
     print("Reading CSV file: {}".format(csv_file))
-    # Define column names to match output format based on original code
-    columns = [
-        'timestamp', 'areaLength', 'areaWidth', 'areaHeight', 'numNodes', 'linkQuality', 
-        'runId', 'keyAgreementDelay', 'totalSent', 'totalReceived', 'overheadRatio', 'successRate', 'avgUniqueContributions'
-    ]
     
     try:
-        # Read CSV (no header), use defined column names
-        df = pd.read_csv(csv_file, header=None, names=columns)
+        # Read CSV (header row written by ResultsMerge)
+        df = pd.read_csv(csv_file)
         print("Successfully read {} rows of data".format(len(df)))
         
         # Remove timestamp and runId columns
@@ -88,6 +65,12 @@ def create_database(csv_file=None, db_file=None):
         
         # Insert data
         df.to_sql('experiment_results', conn, if_exists='replace', index=False)
+
+        # Per-node view written next to the run-level CSV
+        nodes_file = csv_file.replace("_Result.csv", "_Nodes.csv")
+        if os.path.exists(nodes_file):
+            pd.read_csv(nodes_file).to_sql('node_results', conn, if_exists='replace', index=False)
+            print("Inserted per-node results from {}".format(nodes_file))
         
         # Verify data insertion
         count = conn.execute("SELECT COUNT(*) FROM experiment_results").fetchone()[0]
@@ -133,6 +116,7 @@ def analyze_database(db_file=None):
     delay_analysis = pd.read_sql_query("""
         SELECT 
             linkQuality AS LinkQuality,
+            strategy AS Strategy,
             areaLength || '*' || areaWidth || '*' || areaHeight AS AreaSize,
             numNodes AS NodeCount,
             COUNT(*) AS TotalCount,
@@ -141,23 +125,8 @@ def analyze_database(db_file=None):
             ROUND(MIN(CASE WHEN keyAgreementDelay > 0 AND successRate = 100 THEN keyAgreementDelay ELSE NULL END), 4) AS MinDelay,
             ROUND(MAX(CASE WHEN keyAgreementDelay > 0 AND successRate = 100 THEN keyAgreementDelay ELSE NULL END), 4) AS MaxDelay
         FROM experiment_results
-        GROUP BY linkQuality, areaLength, areaWidth, areaHeight, numNodes
-        ORDER BY 
-            CASE
-                WHEN linkQuality = 'high' THEN 1
-                WHEN linkQuality = 'medium' THEN 2
-                WHEN linkQuality = 'low' THEN 3
-                WHEN linkQuality = 'very_poor' THEN 4
-                ELSE 5
-            END,
-            CASE
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '300*300*80' THEN 1
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '500*500*150' THEN 2
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '800*800*200' THEN 3
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '1000*1000*300' THEN 4
-                ELSE 5
-            END,
-            numNodes
+        GROUP BY linkQuality, strategy, areaLength, areaWidth, areaHeight, numNodes
+        ORDER BY linkQuality, strategy, areaLength * areaWidth * areaHeight, areaLength, areaWidth, areaHeight, numNodes
     """, conn)
     delay_analysis.to_excel(excel_writer, sheet_name=u'Delay Analysis', index=False)
     
@@ -165,6 +134,7 @@ def analyze_database(db_file=None):
     packet_stats = pd.read_sql_query("""
         SELECT 
             linkQuality AS LinkQuality,
+            strategy AS Strategy,
             areaLength || '*' || areaWidth || '*' || areaHeight AS AreaSize,
             numNodes AS NodeCount,
             COUNT(*) AS TotalCount,
@@ -172,23 +142,8 @@ def analyze_database(db_file=None):
             CAST(ROUND(AVG(totalReceived) + 0.5) AS INTEGER) AS AvgReceivedPackets,
             ROUND(AVG(avgUniqueContributions), 2) AS AvgUniqueContributions
         FROM experiment_results
-        GROUP BY linkQuality, areaLength, areaWidth, areaHeight, numNodes
-        ORDER BY 
-            CASE
-                WHEN linkQuality = 'high' THEN 1
-                WHEN linkQuality = 'medium' THEN 2
-                WHEN linkQuality = 'low' THEN 3
-                WHEN linkQuality = 'very_poor' THEN 4
-                ELSE 5
-            END,
-            CASE
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '300*300*80' THEN 1
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '500*500*150' THEN 2
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '800*800*200' THEN 3
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '1000*1000*300' THEN 4
-                ELSE 5
-            END,
-            numNodes
+        GROUP BY linkQuality, strategy, areaLength, areaWidth, areaHeight, numNodes
+        ORDER BY linkQuality, strategy, areaLength * areaWidth * areaHeight, areaLength, areaWidth, areaHeight, numNodes
     """, conn)
     packet_stats.to_excel(excel_writer, sheet_name=u'Packet Statistics', index=False)
     
@@ -196,41 +151,110 @@ def analyze_database(db_file=None):
     success_analysis = pd.read_sql_query("""
         SELECT 
             linkQuality AS LinkQuality,
+            strategy AS Strategy,
             areaLength || '*' || areaWidth || '*' || areaHeight AS AreaSize,
             numNodes AS NodeCount,
             COUNT(*) AS TotalCount,
             SUM(CASE WHEN keyAgreementDelay > 0 THEN 1 ELSE 0 END) AS SuccessCount,
             ROUND(SUM(CASE WHEN keyAgreementDelay > 0 THEN 1 ELSE 0 END) * 100.0 / COUNT(*), 2) AS SuccessRate
         FROM experiment_results
-        GROUP BY linkQuality, areaLength, areaWidth, areaHeight, numNodes
-        ORDER BY 
-            CASE
-                WHEN linkQuality = 'high' THEN 1
-                WHEN linkQuality = 'medium' THEN 2
-                WHEN linkQuality = 'low' THEN 3
-                WHEN linkQuality = 'very_poor' THEN 4
-                ELSE 5
-            END,
-            CASE
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '300*300*80' THEN 1
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '500*500*150' THEN 2
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '800*800*200' THEN 3
-                WHEN areaLength || '*' || areaWidth || '*' || areaHeight = '1000*1000*300' THEN 4
-                ELSE 5
-            END,
-            numNodes
+        GROUP BY linkQuality, strategy, areaLength, areaWidth, areaHeight, numNodes
+        ORDER BY linkQuality, strategy, areaLength * areaWidth * areaHeight, areaLength, areaWidth, areaHeight, numNodes
     """, conn)
     success_analysis.to_excel(excel_writer, sheet_name=u'Success Rate Analysis', index=False)
 
+    # 5. Energy analysis (runs recorded before energy accounting have NULL energy)
+    energy_analysis = pd.read_sql_query("""
+        SELECT 
+            linkQuality AS LinkQuality,
+            strategy AS Strategy,
+            areaLength || '*' || areaWidth || '*' || areaHeight AS AreaSize,
+            numNodes AS NodeCount,
+            COUNT(totalEnergy) AS TotalCount,
+            ROUND(AVG(totalRadioEnergy), 4) AS AvgRadioEnergyJ,
+            ROUND(AVG(totalCpuEnergy), 6) AS AvgCpuEnergyJ,
+            ROUND(AVG(totalEnergy), 4) AS AvgTotalEnergyJ,
+            ROUND(AVG(totalEnergy) / numNodes, 4) AS AvgEnergyPerNodeJ,
+            ROUND(MAX(totalEnergy), 4) AS MaxTotalEnergyJ
+        FROM experiment_results
+        GROUP BY linkQuality, strategy, areaLength, areaWidth, areaHeight, numNodes
+        ORDER BY linkQuality, strategy, areaLength, areaWidth, areaHeight, numNodes
+    """, conn)
+    energy_analysis.to_excel(excel_writer, sheet_name=u'Energy Analysis', index=False)
+
+    # 6. Efficiency vs oracle: lower bound of the run's topology over the achieved value, 1 is optimal
+    # (runs recorded before the oracle section have NULL efficiencies)
+    oracle_analysis = pd.read_sql_query("""
+        SELECT 
+            linkQuality AS LinkQuality,
+            strategy AS Strategy,
+            areaLength || '*' || areaWidth || '*' || areaHeight AS AreaSize,
+            numNodes AS NodeCount,
+            COUNT(delayEfficiency) AS TotalCount,
+            ROUND(AVG(oracleDelay), 4) AS AvgOracleDelay,
+            ROUND(AVG(delayEfficiency), 4) AS AvgDelayEfficiency,
+            ROUND(AVG(oracleTransmissions), 1) AS AvgOracleTransmissions,
+            ROUND(AVG(txEfficiency), 4) AS AvgTxEfficiency
+        FROM experiment_results
+        GROUP BY linkQuality, strategy, areaLength, areaWidth, areaHeight, numNodes
+        ORDER BY linkQuality, strategy, areaLength, areaWidth, areaHeight, numNodes
+    """, conn)
+    oracle_analysis.to_excel(excel_writer, sheet_name=u'Oracle Efficiency', index=False)
+
+    # 7. Send backoff policies side by side: success, delay and MAC contention per policy and slot
+    # (runs recorded before the send section have a NULL policy)
+    send_analysis = pd.read_sql_query("""
+        SELECT 
+            linkQuality AS LinkQuality,
+            strategy AS Strategy,
+            areaLength || '*' || areaWidth || '*' || areaHeight AS AreaSize,
+            numNodes AS NodeCount,
+            sendPolicy AS SendPolicy,
+            sendSlot AS SlotMs,
+            sendSlots AS Slots,
+            COUNT(*) AS TotalCount,
+            ROUND(AVG(successRate), 2) AS AvgSuccessRate,
+            ROUND(AVG(CASE WHEN keyAgreementDelay > 0 AND successRate = 100 THEN keyAgreementDelay ELSE NULL END), 4) AS AvgDelay,
+            ROUND(AVG(macRetries), 1) AS AvgMacRetries,
+            ROUND(AVG(macDrops), 1) AS AvgMacDrops,
+            CAST(ROUND(AVG(totalSent) + 0.5) AS INTEGER) AS AvgSentPackets
+        FROM experiment_results
+        WHERE sendPolicy IS NOT NULL
+        GROUP BY linkQuality, strategy, areaLength, areaWidth, areaHeight, numNodes, sendPolicy, sendSlot, sendSlots
+        ORDER BY linkQuality, strategy, areaLength * areaWidth * areaHeight, areaLength, areaWidth, areaHeight, numNodes, AvgDelay
+    """, conn)
+    send_analysis.to_excel(excel_writer, sheet_name=u'Send Policy Analysis', index=False)
+
     excel_writer.close()
     conn.close()    
     return True
 
 
 
+def write_summary_report(aggregator, excel_file=None):
+    """Write the streaming aggregator's sheets (with confidence intervals and delay quantiles) to Excel"""
+    if excel_file is None:
+        timestamp = datetime.now().strftime("%Y%m%d%H%M%S")
+        excel_file = timestamp + "_summary_statistics.xlsx"
+    excel_writer = pd.ExcelWriter(excel_file, engine='openpyxl')
+    sheets = aggregator.report_sheets()
+    for name in ('Delay Analysis', 'Packet Statistics', 'Success Rate Analysis', 'Energy Analysis', 'Rekey Analysis'):
+        columns, rows = sheets[name]
+        if name == 'Rekey Analysis' and not rows:
+            continue
+        pd.DataFrame(rows, columns=columns).to_excel(excel_writer, sheet_name=name, index=False)
+    excel_writer.close()
+    print("Summary statistics of {} runs written to {}".format(aggregator.records, excel_file))
+    return excel_file
+
 def do_all_steps():
-    """Execute all steps: merge CSV, convert to database, analyze"""
+    """Execute all steps: aggregate, merge CSV, convert to database, analyze"""
     print("===== Starting full process =====")
+    # Fold the worker files into the streaming statistics before merging removes them
+    aggregator = StreamAggregator()
+    aggregator.consume_dir("results_cache")
+    if aggregator.records:
+        write_summary_report(aggregator)
     csv_file = merge_csv_files()
     if csv_file:
         print("\n===== CSV merge completed, starting database conversion =====")
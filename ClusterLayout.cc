@@ -0,0 +1,96 @@
+#include "ClusterLayout.h"
+#include <algorithm>
+#include <utility>
+
+const uint32_t ClusterLayout::NO_NODE;
+
+ClusterLayout::ClusterLayout(uint32_t numNodes, uint32_t clusterSize)
+  : m_clusterSize(clusterSize), m_clusterCount((numNodes + clusterSize - 1) / clusterSize),
+    m_cluster(numNodes), m_slot(numNodes) {
+  std::vector<uint32_t> order(numNodes);
+  for (uint32_t i = 0; i < numNodes; i++) {
+    order[i] = i;
+  }
+  Assign(order);
+}
+
+// Spread the 10 low bits of v to every third bit
+static uint32_t SpreadBits(uint32_t v) {
+  v &= 0x3ff;
+  v = (v | (v << 16)) & 0x030000ff;
+  v = (v | (v << 8)) & 0x0300f00f;
+  v = (v | (v << 4)) & 0x030c30c3;
+  v = (v | (v << 2)) & 0x09249249;
+  return v;
+}
+
+// Position of v within [lo, hi] on a 10-bit grid
+static uint32_t Quantize(double v, double lo, double hi) {
+  if (hi <= lo) {
+    return 0;
+  }
+  return static_cast<uint32_t>((v - lo) / (hi - lo) * 1023.0);
+}
+
+void ClusterLayout::AssignByPosition(const std::vector<double>& x, const std::vector<double>& y,
+                                     const std::vector<double>& z) {
+  uint32_t n = m_cluster.size();
+  double lo[3] = {x[0], y[0], z[0]};
+  double hi[3] = {x[0], y[0], z[0]};
+  for (uint32_t i = 1; i < n; i++) {
+    lo[0] = std::min(lo[0], x[i]); hi[0] = std::max(hi[0], x[i]);
+    lo[1] = std::min(lo[1], y[i]); hi[1] = std::max(hi[1], y[i]);
+    lo[2] = std::min(lo[2], z[i]); hi[2] = std::max(hi[2], z[i]);
+  }
+  // Nearby nodes get nearby Morton codes, so consecutive runs are spatially compact
+  std::vector<std::pair<uint32_t, uint32_t> > keyed(n);
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t code = SpreadBits(Quantize(x[i], lo[0], hi[0]))
+        | (SpreadBits(Quantize(y[i], lo[1], hi[1])) << 1)
+        | (SpreadBits(Quantize(z[i], lo[2], hi[2])) << 2);
+    keyed[i] = std::make_pair(code, i);
+  }
+  std::sort(keyed.begin(), keyed.end());
+  std::vector<uint32_t> order(n);
+  for (uint32_t i = 0; i < n; i++) {
+    order[i] = keyed[i].second;
+  }
+  Assign(order);
+}
+
+// Cut the ordered nodes into clusters of near-equal size
+void ClusterLayout::Assign(const std::vector<uint32_t>& order) {
+  uint32_t n = order.size();
+  m_nodes.assign(m_clusterCount * m_clusterSize, NO_NODE);
+  for (uint32_t c = 0; c < m_clusterCount; c++) {
+    uint32_t begin = static_cast<uint64_t>(c) * n / m_clusterCount;
+    uint32_t end = static_cast<uint64_t>(c + 1) * n / m_clusterCount;
+    for (uint32_t i = begin; i < end; i++) {
+      m_cluster[order[i]] = c;
+      m_slot[order[i]] = i - begin;
+      m_nodes[c * m_clusterSize + i - begin] = order[i];
+    }
+  }
+}
+
+uint32_t ClusterLayout::GetMemberCount(uint32_t cluster) const {
+  uint32_t count = 0;
+  for (uint32_t s = 0; s < m_clusterSize; s++) {
+    if (m_nodes[cluster * m_clusterSize + s] != NO_NODE) {
+      count++;
+    }
+  }
+  return count;
+}
+
+uint32_t ClusterLayout::GetNode(uint32_t cluster, uint32_t slot) const {
+  return m_nodes[cluster * m_clusterSize + slot];
+}
+
+std::vector<bool> ClusterLayout::GetSlotMask(uint32_t cluster) const {
+  std::vector<bool> mask(m_clusterSize);
+  for (uint32_t s = 0; s < m_clusterSize; s++) {
+    mask[s] = (m_nodes[cluster * m_clusterSize + s] != NO_NODE);
+  }
+  return mask;
+}
@@ -0,0 +1,47 @@
+#ifndef CLUSTER_LAYOUT_H
+#define CLUSTER_LAYOUT_H
+
+#include <vector>
+#include <stdint.h>
+
+/**
+ * Assignment of nodes to the clusters of a hierarchical agreement. Every
+ * cluster has clusterSize slots (a power of two), so cluster c covers leaves
+ * [c * clusterSize, (c + 1) * clusterSize) of the group's KeyGenerationTree and
+ * the clusters' subtree roots are the leaves of the top-level tree. Nodes are
+ * cut into ceil(N / clusterSize) clusters of near-equal size, either by ID
+ * range or along a Z-order curve of their positions; unused slots are padding.
+ * The layout is shared read-only by all nodes of a run.
+ */
+class ClusterLayout
+{
+public:
+  static const uint32_t NO_NODE = 0xffffffff;
+
+  // ID ranges: cluster c holds consecutive node IDs
+  ClusterLayout(uint32_t numNodes, uint32_t clusterSize);
+
+  // Spatial clusters: nodes ordered along the Z-order curve of their positions
+  void AssignByPosition(const std::vector<double>& x, const std::vector<double>& y,
+                        const std::vector<double>& z);
+
+  uint32_t GetNodeCount() const { return m_cluster.size(); }
+  uint32_t GetClusterCount() const { return m_clusterCount; }
+  uint32_t GetClusterSize() const { return m_clusterSize; }
+  uint32_t GetCluster(uint32_t node) const { return m_cluster[node]; }
+  uint32_t GetSlot(uint32_t node) const { return m_slot[node]; }
+  uint32_t GetMemberCount(uint32_t cluster) const;
+  uint32_t GetNode(uint32_t cluster, uint32_t slot) const;   ///< NO_NODE for a padding slot
+  std::vector<bool> GetSlotMask(uint32_t cluster) const;     ///< Used slots of the cluster
+
+private:
+  void Assign(const std::vector<uint32_t>& order);
+
+  uint32_t m_clusterSize;              ///< Slots per cluster
+  uint32_t m_clusterCount;             ///< Clusters
+  std::vector<uint32_t> m_cluster;     ///< Node -> cluster
+  std::vector<uint32_t> m_slot;        ///< Node -> slot within its cluster
+  std::vector<uint32_t> m_nodes;       ///< [cluster * clusterSize + slot] -> node, NO_NODE for padding
+};
+
+#endif /* CLUSTER_LAYOUT_H */
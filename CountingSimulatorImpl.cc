@@ -0,0 +1,57 @@
+#include "CountingSimulatorImpl.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("counting-simulator");
+NS_OBJECT_ENSURE_REGISTERED(CountingSimulatorImpl);
+
+namespace {
+
+// Owns the scheduled event (the reference it was created with) and counts its invocation
+class CountedEvent: public EventImpl {
+public:
+	CountedEvent(EventImpl* event, uint64_t* counter) : m_event(event), m_counter(counter) {}
+	virtual ~CountedEvent() { m_event->Unref(); }
+
+protected:
+	virtual void Notify(void) {
+		(*m_counter)++;
+		m_event->Invoke();
+	}
+
+private:
+	EventImpl* m_event;		// Wrapped event
+	uint64_t* m_counter;	// Executed events of the simulator
+};
+
+}
+
+TypeId CountingSimulatorImpl::GetTypeId(void) {
+	static TypeId tid =
+			TypeId("CountingSimulatorImpl").SetParent<DefaultSimulatorImpl>()
+					.AddConstructor<CountingSimulatorImpl>();
+	return tid;
+}
+
+CountingSimulatorImpl::CountingSimulatorImpl() {
+	m_events = 0;
+}
+
+CountingSimulatorImpl::~CountingSimulatorImpl() {}
+
+EventId CountingSimulatorImpl::Schedule(Time const &delay, EventImpl *event) {
+	return DefaultSimulatorImpl::Schedule(delay, new CountedEvent(event, &m_events));
+}
+
+void CountingSimulatorImpl::ScheduleWithContext(uint32_t context, Time const &delay, EventImpl *event) {
+	DefaultSimulatorImpl::ScheduleWithContext(context, delay, new CountedEvent(event, &m_events));
+}
+
+EventId CountingSimulatorImpl::ScheduleNow(EventImpl *event) {
+	return DefaultSimulatorImpl::ScheduleNow(new CountedEvent(event, &m_events));
+}
+
+uint64_t CountingSimulatorImpl::GetCurrentEventCount() {
+	Ptr<CountingSimulatorImpl> impl = DynamicCast<CountingSimulatorImpl>(Simulator::GetImplementation());
+	return impl != 0 ? impl->GetEventCount() : 0;
+}
@@ -0,0 +1,35 @@
+#ifndef COUNTING_SIMULATOR_IMPL_H
+#define COUNTING_SIMULATOR_IMPL_H
+
+#include "ns3/core-module.h"
+#include "ns3/default-simulator-impl.h"
+
+using namespace ns3;
+
+/**
+ * Default simulator that also counts the events it executes; ns-3.25 has no
+ * Simulator::GetEventCount. Every scheduled event is wrapped in a forwarding
+ * event (one extra allocation per event) that counts itself when invoked, so
+ * cancelled events, events left pending at Stop and destroy events are not
+ * counted. Selected in main through the SimulatorImplementationType global.
+ */
+class CountingSimulatorImpl: public DefaultSimulatorImpl {
+public:
+	static TypeId GetTypeId(void);
+	CountingSimulatorImpl();
+	virtual ~CountingSimulatorImpl();
+
+	virtual EventId Schedule(Time const &delay, EventImpl *event);
+	virtual void ScheduleWithContext(uint32_t context, Time const &delay, EventImpl *event);
+	virtual EventId ScheduleNow(EventImpl *event);
+
+	uint64_t GetEventCount() const { return m_events; }
+
+	// Events executed by the current simulator, 0 if another implementation was selected
+	static uint64_t GetCurrentEventCount();
+
+private:
+	uint64_t m_events;	// Events executed so far
+};
+
+#endif /* COUNTING_SIMULATOR_IMPL_H */
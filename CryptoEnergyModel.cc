@@ -0,0 +1,44 @@
+#include "CryptoEnergyModel.h"
+
+// Per-operation CPU time (s); contribution and aggregation are the figures
+// AppSender has always used for its initial computation delay
+static const double g_operationTime[CRYPTO_OP_COUNT] = {
+  0.467e-3,    // CRYPTO_OP_CONTRIBUTION
+  0.0635e-3,   // CRYPTO_OP_AGGREGATION
+  0.0398e-3,   // CRYPTO_OP_ENCRYPTION
+  0.0398e-3    // CRYPTO_OP_DECRYPTION
+};
+
+CryptoEnergyModel::CryptoEnergyModel() : m_power(3.0) {
+  for (uint32_t i = 0; i < CRYPTO_OP_COUNT; i++) {
+    m_counts[i] = 0;
+  }
+}
+
+void CryptoEnergyModel::SetPower(double watts) {
+  m_power = watts;
+}
+
+void CryptoEnergyModel::Charge(CryptoOperation op, uint32_t count) {
+  m_counts[op] += count;
+}
+
+double CryptoEnergyModel::GetBusyTime() const {
+  double busy = 0;
+  for (uint32_t i = 0; i < CRYPTO_OP_COUNT; i++) {
+    busy += m_counts[i] * g_operationTime[i];
+  }
+  return busy;
+}
+
+double CryptoEnergyModel::GetEnergy() const {
+  return GetBusyTime() * m_power;
+}
+
+uint32_t CryptoEnergyModel::GetCount(CryptoOperation op) const {
+  return m_counts[op];
+}
+
+double CryptoEnergyModel::GetOperationTime(CryptoOperation op) {
+  return g_operationTime[op];
+}
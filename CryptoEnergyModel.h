@@ -0,0 +1,42 @@
+#ifndef CRYPTO_ENERGY_MODEL_H
+#define CRYPTO_ENERGY_MODEL_H
+
+#include <stdint.h>
+
+/**
+ * Crypto operations charged by the applications
+ */
+enum CryptoOperation
+{
+  CRYPTO_OP_CONTRIBUTION = 0,   ///< Key contribution computation towards one other member
+  CRYPTO_OP_AGGREGATION,        ///< Aggregation of two key contributions
+  CRYPTO_OP_ENCRYPTION,         ///< Symmetric encryption of an outgoing message (T_e/s)
+  CRYPTO_OP_DECRYPTION,         ///< Symmetric decryption of a received message (T_e/s)
+  CRYPTO_OP_COUNT
+};
+
+/**
+ * CPU energy of the crypto work of one application: every operation keeps
+ * the CPU busy for its measured time (README, Raspberry Pi 4 figures) at a
+ * configurable active power.
+ */
+class CryptoEnergyModel
+{
+public:
+  CryptoEnergyModel();
+
+  void SetPower(double watts);
+  void Charge(CryptoOperation op, uint32_t count = 1);
+
+  double GetBusyTime() const;   // s
+  double GetEnergy() const;     // J
+  uint32_t GetCount(CryptoOperation op) const;
+
+  static double GetOperationTime(CryptoOperation op);   // s
+
+private:
+  double m_power;                        ///< CPU active power (W)
+  uint32_t m_counts[CRYPTO_OP_COUNT];    ///< Operations charged so far
+};
+
+#endif /* CRYPTO_ENERGY_MODEL_H */
@@ -1,11 +1,19 @@
 #include "KeyGenerationTree.h"
+#include "RegkaProfile.h"
 #include <sstream>
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <set>
 
-KeyGenerationTree::KeyGenerationTree(uint32_t networkSize, uint32_t nodeId) : m_nodeId(nodeId), m_leafCount(networkSize)
+// Empty tree, replaced by the sized one once the network size is known
+KeyGenerationTree::KeyGenerationTree() : m_nodeId(0), m_leafCount(0), m_capacity(0), m_depth(0), m_nodeCount(0),
+    m_merges(0)
+{
+}
+
+KeyGenerationTree::KeyGenerationTree(uint32_t networkSize, uint32_t nodeId) : m_nodeId(nodeId), m_leafCount(networkSize),
+    m_member(networkSize, true), m_merges(0)
 {
     if (networkSize == 0)
         throw std::invalid_argument("networkSize must be > 0");
@@ -69,6 +77,7 @@ void KeyGenerationTree::BubbleUpMerge()
         if (m_owned[idx]) continue;
         if (m_owned[LeftChild(idx)] && m_owned[RightChild(idx)]) {
             m_owned[idx] = true;
+            m_merges++;
             if (idx != 0) {
                 nodesToCheck.insert(Parent(idx));
             }
@@ -76,9 +85,42 @@ void KeyGenerationTree::BubbleUpMerge()
     }
 }
 
+// Add a single key contribution, merging only along its path to the root
+void KeyGenerationTree::AddContribution(uint32_t contributorId)
+{
+    if (contributorId >= m_leafCount)
+        throw std::out_of_range("contributorId >= networkSize");
+
+    uint32_t idx = LeafToNodeIndex(contributorId);
+    if (m_owned[idx])
+        return;
+    m_owned[idx] = true;
+    MergePath(idx);
+}
+
+void KeyGenerationTree::MergePath(uint32_t idx)
+{
+    while (idx != 0) {
+        idx = Parent(idx);
+        if (m_owned[idx] || !m_owned[LeftChild(idx)] || !m_owned[RightChild(idx)])
+            break;
+        m_owned[idx] = true;
+        m_merges++;
+    }
+}
+
+void KeyGenerationTree::InvalidatePath(uint32_t idx)
+{
+    while (idx != 0) {
+        idx = Parent(idx);
+        m_owned[idx] = false;
+    }
+}
+
 // Batch add multiple key contributions
 void KeyGenerationTree::AddMultipleContributions(const std::string& contributionString)
 {
+    REGKA_PROFILE_SCOPE(PROBE_TREE_MERGE);
     if (contributionString.size() != m_leafCount) {
         throw std::invalid_argument("Invalid contribution string size");
     }
@@ -155,6 +197,7 @@ void KeyGenerationTree::StringToTree(const std::string& treeString)
 // Merge contributions from another tree
 void KeyGenerationTree::MergeTree(const KeyGenerationTree& otherTree)
 {
+    REGKA_PROFILE_SCOPE(PROBE_TREE_MERGE);
     if (m_leafCount != otherTree.m_leafCount) {
         throw std::invalid_argument("Trees have different network sizes");
     }
@@ -168,6 +211,7 @@ void KeyGenerationTree::MergeTree(const KeyGenerationTree& otherTree)
 // Generate forwarding contribution flag string
 std::string KeyGenerationTree::GetForwardingContributions(const KeyGenerationTree& neighborTree) const
 {
+    REGKA_PROFILE_SCOPE(PROBE_TREE_FORWARDING);
     std::string forwardingContributions(m_leafCount, '0');
     if (HasCompleteKey()) {
         for (uint32_t i = 0; i < m_leafCount; ++i) {
@@ -181,4 +225,90 @@ std::string KeyGenerationTree::GetForwardingContributions(const KeyGenerationTre
         }
     }
     return forwardingContributions;
-} 
\ No newline at end of file
+}
+
+// Start over with the given group: own leaf and padding only
+void KeyGenerationTree::ResetMembers(const std::vector<bool>& members)
+{
+    if (members.size() != m_leafCount) {
+        throw std::invalid_argument("Invalid member mask size");
+    }
+    m_member = members;
+    std::fill(m_owned.begin(), m_owned.end(), false);
+    for (uint32_t leaf = 0; leaf < m_capacity; ++leaf) {
+        if (leaf >= m_leafCount || !m_member[leaf]) {
+            m_owned[LeafToNodeIndex(leaf)] = true;
+        }
+    }
+    for (int32_t idx = static_cast<int32_t>(m_capacity) - 2; idx >= 0; --idx) {
+        if (m_owned[LeftChild(idx)] && m_owned[RightChild(idx)]) m_owned[idx] = true;
+    }
+    AddContribution(m_nodeId);
+}
+
+// A member left: its leaf becomes padding. Only its leaf-to-root path changes; the
+// values there are recomputed once the sponsor's refreshed contribution arrives.
+void KeyGenerationTree::RemoveMember(uint32_t memberId)
+{
+    if (memberId >= m_leafCount)
+        throw std::out_of_range("memberId >= networkSize");
+
+    uint32_t idx = LeafToNodeIndex(memberId);
+    m_member[memberId] = false;
+    InvalidatePath(idx);
+    m_owned[idx] = true;
+    // Subtrees left with padding only are complete again
+    MergePath(idx);
+}
+
+// A node joined into a padding leaf: everybody else lacks its contribution and the path above it
+void KeyGenerationTree::AddMember(uint32_t memberId)
+{
+    if (memberId >= m_leafCount)
+        throw std::out_of_range("memberId >= networkSize");
+
+    uint32_t idx = LeafToNodeIndex(memberId);
+    m_member[memberId] = true;
+    InvalidatePath(idx);
+    m_owned[idx] = (memberId == m_nodeId);
+    MergePath(idx);
+}
+
+// A member replaced its contribution: others lose its leaf, everybody its path
+void KeyGenerationTree::RefreshContribution(uint32_t contributorId)
+{
+    if (contributorId >= m_leafCount)
+        throw std::out_of_range("contributorId >= networkSize");
+
+    uint32_t idx = LeafToNodeIndex(contributorId);
+    InvalidatePath(idx);
+    m_owned[idx] = (contributorId == m_nodeId);
+    MergePath(idx);
+}
+
+// Member refreshing its contribution after leavingId left: the last member leaf of the
+// nearest subtree next to the leaving leaf, so the refreshed path covers the leaving one
+uint32_t KeyGenerationTree::GetSponsor(uint32_t leavingId) const
+{
+    if (leavingId >= m_leafCount)
+        throw std::out_of_range("leavingId >= networkSize");
+
+    uint32_t idx = LeafToNodeIndex(leavingId);
+    while (idx != 0) {
+        uint32_t sibling = (idx % 2 == 1) ? idx + 1 : idx - 1;
+        uint32_t first = sibling;
+        uint32_t last = sibling;
+        while (first < m_capacity - 1) {
+            first = LeftChild(first);
+            last = RightChild(last);
+        }
+        for (uint32_t node = last + 1; node > first; --node) {
+            uint32_t leaf = NodeToLeafIndex(node - 1);
+            if (leaf < m_leafCount && m_member[leaf] && leaf != leavingId) {
+                return leaf;
+            }
+        }
+        idx = Parent(idx);
+    }
+    return leavingId;
+}
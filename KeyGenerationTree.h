@@ -2,14 +2,16 @@
 #define KEY_GENERATION_TREE_H
 
 #include <vector>
-#include <cstdint>
+#include <stdint.h>
 #include <stdexcept>
 #include <string>
 
 class KeyGenerationTree
 {
 public:
+    KeyGenerationTree();
     explicit KeyGenerationTree(uint32_t networkSize, uint32_t nodeId);
+    void AddContribution(uint32_t contributorId);
     void AddMultipleContributions(const std::string& contributionString);
     bool HasContribution(uint32_t contributorId) const;
     bool HasCompleteKey() const;
@@ -21,6 +23,17 @@ public:
     void MergeTree(const KeyGenerationTree& otherTree);
     std::string GetForwardingContributions(const KeyGenerationTree& neighborTree) const;
 
+    // Dynamic membership. Leaves of non-members are padding like the leaves beyond networkSize.
+    void ResetMembers(const std::vector<bool>& members);
+    void RemoveMember(uint32_t memberId);
+    void AddMember(uint32_t memberId);
+    void RefreshContribution(uint32_t contributorId);
+    uint32_t GetSponsor(uint32_t leavingId) const;
+    bool IsMember(uint32_t nodeId) const { return m_member[nodeId]; }
+    uint32_t GetDepth() const { return m_depth; }
+    // Internal nodes merged from two owned children so far, the key computations of this tree
+    uint32_t GetMergeCount() const { return m_merges; }
+
 private:
     // Complete binary tree index utility functions
     static inline uint32_t CeilLog2(uint32_t n);
@@ -33,6 +46,10 @@ private:
     
     // Bubble up merge
     void BubbleUpMerge();
+    // Merge the ancestors of a tree node while both children are owned
+    void MergePath(uint32_t idx);
+    // Drop the ancestors of a tree node, their values change
+    void InvalidatePath(uint32_t idx);
     
     // Member data
     uint32_t m_nodeId;           // Current node ID
@@ -41,6 +58,8 @@ private:
     uint32_t m_depth;            // Tree depth
     uint32_t m_nodeCount;        // Total node count
     std::vector<bool> m_owned;   // Mark which nodes are owned (bitmap)
+    std::vector<bool> m_member;  // Leaves of current group members
+    uint32_t m_merges;           // See GetMergeCount()
 };
 
 #endif /* KEY_GENERATION_TREE_H */ 
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "KeyMatrix.h"
+#include "RegkaProfile.h"
 #include <algorithm>
 #include <iostream>
 #include <sstream>
@@ -8,14 +9,18 @@
 
 double KeyMatrix::RandomVariable() const
 { 
+    if (m_random != 0) {
+        return m_random->GetUniform();
+    }
     double random = static_cast<double>(rand()) / RAND_MAX ;
     return random;
 }
 
-KeyMatrix::KeyMatrix() : m_networkSize(0), m_nodeId(0) {
+KeyMatrix::KeyMatrix() : m_networkSize(0), m_nodeId(0), m_random(0), m_version(0) {
 }
 
-KeyMatrix::KeyMatrix(uint32_t networkSize, uint32_t nodeId) : m_networkSize(networkSize), m_nodeId(nodeId) {
+KeyMatrix::KeyMatrix(uint32_t networkSize, uint32_t nodeId) : m_networkSize(networkSize), m_nodeId(nodeId), m_random(0),
+    m_members(networkSize, true), m_version(0) {
   m_matrix.resize(m_networkSize);
   for (uint32_t i = 0; i < m_networkSize; i++) {
     m_matrix[i].resize(m_networkSize);
@@ -31,6 +36,8 @@ KeyMatrix::~KeyMatrix() {
 void KeyMatrix::InitializeMatrix(uint32_t networkSize, uint32_t nodeId) {
   m_networkSize = networkSize;
   m_nodeId = nodeId;
+  m_members.assign(m_networkSize, true);
+  m_version++;
   m_matrix.resize(m_networkSize);
   for (uint32_t i = 0; i < m_networkSize; i++) {
     m_matrix[i].resize(m_networkSize);
@@ -49,7 +56,10 @@ bool KeyMatrix::HasKeyContribution(uint32_t AnyNodeId_i, uint32_t AnyNodeId_j) c
 // Receive key contribution
 void KeyMatrix::ReceiveKeyContribution(uint32_t contributorId)
 {
-    m_matrix[m_nodeId][contributorId] = true;
+    if (!m_matrix[m_nodeId][contributorId]) {
+      m_matrix[m_nodeId][contributorId] = true;
+      m_version++;
+    }
 }
 
 // Check if KeyMatrix is all 1
@@ -68,21 +78,28 @@ bool KeyMatrix::IsFull1() const
 // Merge received KeyMatrix to local KeyMatrix
 void KeyMatrix::MergeMatrix(const KeyMatrix& ReceivedMatrix)
 {
+  REGKA_PROFILE_SCOPE(PROBE_MATRIX_MERGE);
   for (uint32_t i = 0; i < m_networkSize; i++) {
     for (uint32_t j = 0; j < m_networkSize; j++) {
       // If received matrix element is true, merge to local matrix
-      m_matrix[i][j] = m_matrix[i][j] || ReceivedMatrix.m_matrix[i][j];
+      if (ReceivedMatrix.m_matrix[i][j] && !m_matrix[i][j]) {
+        m_matrix[i][j] = true;
+        m_version++;
+      }
     }
   }
 }
 
-// Calculate Complement Rate (CR)  
+// Calculate Complement Rate (CR) over the members' contributions; padding columns are all 1
 double KeyMatrix::CalculateCR(uint32_t NeighborId) const
 {
   uint32_t diffCount = 0;  
   uint32_t unionCount = 0; 
 
   for (uint32_t j = 0; j < m_networkSize; j++) {
+    if (!m_members[j]) {
+      continue;
+    }
     if (m_matrix[m_nodeId][j] && !m_matrix[NeighborId][j]) {
       diffCount++;
     }
@@ -94,16 +111,21 @@ double KeyMatrix::CalculateCR(uint32_t NeighborId) const
   return static_cast<double>(diffCount) / unionCount;
 }
 
-// Calculate Forwarding Degree (FD)   
+// Calculate Forwarding Degree (FD): the share of members holding the contribution
 double KeyMatrix::CalculateFD(uint32_t ContributorId) const
 {
   uint32_t receivedCount = 0; 
+  uint32_t memberCount = 0;
   for (uint32_t i = 0; i < m_networkSize; i++) {
+    if (!m_members[i]) {
+      continue;
+    }
+    memberCount++;
     if (m_matrix[i][ContributorId]) {
       receivedCount++;
     }
   }
-  return static_cast<double>(receivedCount) / m_networkSize;
+  return static_cast<double>(receivedCount) / memberCount;
 }
 
 // Check if self has all key contributions
@@ -119,6 +141,7 @@ bool KeyMatrix::SelfIsFull1() const
 
 std::string KeyMatrix::GetForwardingContributions(uint32_t NeighborId) const
 {
+  REGKA_PROFILE_SCOPE(PROBE_MATRIX_FORWARDING);
   std::string forwardingContributions(m_networkSize, '0');
 
   if (SelfIsFull1()) {
@@ -140,16 +163,75 @@ std::string KeyMatrix::GetForwardingContributions(uint32_t NeighborId) const
   return forwardingContributions;
 }
 
+// Rarest-first forwarding: no randomness and no CR gate, the budget bounds what one message carries
+std::string KeyMatrix::GetRarestContributions(uint32_t NeighborId, const std::vector<uint32_t>& neighbors,
+                                              uint32_t maxContributions) const
+{
+  REGKA_PROFILE_SCOPE(PROBE_MATRIX_FORWARDING);
+  std::string forwardingContributions(m_networkSize, '0');
+  if (SelfIsFull1()) {
+    forwardingContributions.assign(m_networkSize, '1');
+    return forwardingContributions;
+  }
+
+  // (holders, -need, id) of every candidate, sorted ascending
+  std::vector<std::pair<std::pair<uint32_t, int32_t>, uint32_t> > candidates;
+  for (uint32_t j = 0; j < m_networkSize; j++) {
+    if (!m_matrix[m_nodeId][j] || m_matrix[NeighborId][j]) {
+      continue;
+    }
+    uint32_t holders = 0;
+    for (uint32_t i = 0; i < m_networkSize; i++) {
+      if (m_matrix[i][j]) {
+        holders++;
+      }
+    }
+    int32_t need = 0;
+    for (uint32_t k = 0; k < neighbors.size(); k++) {
+      if (!m_matrix[neighbors[k]][j]) {
+        need++;
+      }
+    }
+    candidates.push_back(std::make_pair(std::make_pair(holders, -need), j));
+  }
+  std::sort(candidates.begin(), candidates.end());
+  if (maxContributions > 0 && candidates.size() > maxContributions) {
+    candidates.resize(maxContributions);
+  }
+  for (uint32_t k = 0; k < candidates.size(); k++) {
+    forwardingContributions[candidates[k].second] = '1';
+  }
+  return forwardingContributions;
+}
+
+// Merge the rows carried by one message unit
+void KeyMatrix::MergeRows(uint32_t firstRow, const std::string& rows)
+{
+  MergeRows(firstRow, rows.data(), rows.size() / m_networkSize);
+}
+
+void KeyMatrix::MergeRows(uint32_t firstRow, const char* rows, uint32_t rowCount)
+{
+  REGKA_PROFILE_SCOPE(PROBE_MATRIX_MERGE);
+  uint32_t count = std::min<uint32_t>(rowCount, m_networkSize - firstRow);
+  for (uint32_t i = 0; i < count; i++) {
+    for (uint32_t j = 0; j < m_networkSize; j++) {
+      if (rows[i * m_networkSize + j] == '1' && !m_matrix[firstRow + i][j]) {
+        m_matrix[firstRow + i][j] = true;
+        m_version++;
+      }
+    }
+  }
+}
 
 // Convert matrix to string
 std::string KeyMatrix::MatrixToString() const {
+  REGKA_PROFILE_SCOPE(PROBE_MATRIX_TO_STRING);
   std::string matrixString;
+  matrixString.reserve(m_networkSize * m_networkSize);
   for (uint32_t i = 0; i < m_networkSize; i++) {
     for (uint32_t j = 0; j < m_networkSize; j++) {
-      // Use std::ostringstream instead of std::to_string
-      std::ostringstream ss;
-      ss << (m_matrix[i][j] ? 1 : 0);
-      matrixString += ss.str();
+      matrixString.push_back(m_matrix[i][j] ? '1' : '0');
     }
   }
   return matrixString;
@@ -171,3 +253,46 @@ KeyMatrix KeyMatrix::StringToMatrix(const std::string& matrixString) const {
   }
   return result;
 }
+
+// Start over with the given group: every member holds only its own contribution
+void KeyMatrix::ResetMembers(const std::vector<bool>& members) {
+  m_members = members;
+  m_version++;
+  for (uint32_t i = 0; i < m_networkSize; i++) {
+    for (uint32_t j = 0; j < m_networkSize; j++) {
+      m_matrix[i][j] = (i == j) || !m_members[i] || !m_members[j];
+    }
+  }
+}
+
+// A member left: its row and column become padding
+void KeyMatrix::RemoveMember(uint32_t memberId) {
+  m_members[memberId] = false;
+  m_version++;
+  for (uint32_t i = 0; i < m_networkSize; i++) {
+    m_matrix[memberId][i] = true;
+    m_matrix[i][memberId] = true;
+  }
+}
+
+// A node joined: it holds only its own contribution and nobody else has it yet
+void KeyMatrix::AddMember(uint32_t memberId) {
+  m_members[memberId] = true;
+  m_version++;
+  for (uint32_t i = 0; i < m_networkSize; i++) {
+    m_matrix[memberId][i] = (i == memberId) || !m_members[i];
+    m_matrix[i][memberId] = (i == memberId) || !m_members[i];
+  }
+}
+
+// A member replaced its contribution: only the member itself has the new one
+void KeyMatrix::ResetContribution(uint32_t contributorId) {
+  m_version++;
+  for (uint32_t i = 0; i < m_networkSize; i++) {
+    m_matrix[i][contributorId] = (i == contributorId) || !m_members[i];
+  }
+}
+
+uint32_t KeyMatrix::GetMemberCount() const {
+  return std::count(m_members.begin(), m_members.end(), true);
+}
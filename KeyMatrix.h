@@ -5,6 +5,16 @@
 #include <set>
 #include <string>
 #include <stdint.h>
+#include "RandomSource.h"
+
+/**
+ * How a node picks the contributions it forwards to a neighbour
+ */
+enum ForwardingRule
+{
+  FORWARDING_RANDOM = 0,      ///< GetForwardingContributions: CR gate, then each with probability 1 - FD
+  FORWARDING_RAREST_FIRST     ///< GetRarestContributions: deterministic, fewest holders first, under a budget
+};
 
 class KeyMatrix
 {
@@ -18,20 +28,42 @@ public:
   bool HasKeyContribution(uint32_t AnyNodeId_i, uint32_t AnyNodeId_j) const;
   void ReceiveKeyContribution(uint32_t contributorId);
   void MergeMatrix(const KeyMatrix& ReceivedMatrix);
+  // Merge rows firstRow.. of a received MatrixToString(), as carried by one message unit
+  void MergeRows(uint32_t firstRow, const std::string& rows);
+  void MergeRows(uint32_t firstRow, const char* rows, uint32_t rowCount);
   double CalculateCR(uint32_t NeighborId) const;
   double CalculateFD(uint32_t ContributorId) const;
   double RandomVariable() const;
+  // Source of RandomVariable(), not owned; without one the C library rand() is used
+  void SetRandomSource(RandomSource* source) { m_random = source; }
   std::string GetForwardingContributions(uint32_t NeighborId) const;
+  // At most maxContributions (0 for all) of the contributions NeighborId lacks: fewest holders
+  // (column count) first, ties to the one most of neighbors lack, then the lowest id
+  std::string GetRarestContributions(uint32_t NeighborId, const std::vector<uint32_t>& neighbors,
+                                     uint32_t maxContributions) const;
 
   bool IsFull1() const;
   bool SelfIsFull1() const;
   std::string MatrixToString() const;
+  // Bumped by every change of the matrix or the members, so equal versions give the same MatrixToString()
+  uint32_t GetVersion() const { return m_version; }
   KeyMatrix StringToMatrix(const std::string& matrixString) const;
 
+  // Dynamic membership: node IDs stay fixed, rows and columns of non-members are all 1 (padding)
+  void ResetMembers(const std::vector<bool>& members);
+  void RemoveMember(uint32_t memberId);
+  void AddMember(uint32_t memberId);
+  void ResetContribution(uint32_t contributorId);
+  bool IsMember(uint32_t nodeId) const { return m_members[nodeId]; }
+  uint32_t GetMemberCount() const;
+
 private:
   std::vector<std::vector<bool> > m_matrix; ///< Key contribution matrix, a 2D array where m_matrix[i][j] indicates if node i has node j's key contribution
   uint32_t m_networkSize;                  ///< Network node count
   uint32_t m_nodeId;                       ///< Current node ID
+  RandomSource* m_random;                  ///< Forwarding decision randomness, 0 for rand()
+  std::vector<bool> m_members;             ///< Current group members
+  uint32_t m_version;                      ///< Change count, see GetVersion()
 };
 
 #endif /* KEY_MATRIX_H */ 
\ No newline at end of file
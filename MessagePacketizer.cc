@@ -0,0 +1,97 @@
+#include "MessagePacketizer.h"
+#include <algorithm>
+
+static uint32_t Digits(uint32_t value) {
+  uint32_t digits = 1;
+  while (value >= 10) {
+    value /= 10;
+    digits++;
+  }
+  return digits;
+}
+
+uint32_t MessagePacketizer::GetCryptoBytes(uint32_t aggregates) {
+  if (aggregates == 0) {
+    return 8 * 160;
+  }
+  uint32_t levels = 0;
+  while ((1u << levels) < aggregates) {
+    levels++;
+  }
+  return 8 * (160 + 64 * (levels + 1));
+}
+
+uint32_t MessagePacketizer::CountAggregates(const std::string& contributions) {
+  if (contributions.find('0') == std::string::npos) {
+    return 1;
+  }
+  return std::count(contributions.begin(), contributions.end(), '1');
+}
+
+uint32_t MessagePacketizer::GetContributionBudget(uint32_t budget) {
+  if (budget == 0) {
+    return 0;
+  }
+  // The material grows with the levels, so the budget admits a power of two
+  uint32_t contributions = 1;
+  while (contributions < (1u << 31) && GetCryptoBytes(2 * contributions) <= budget) {
+    contributions *= 2;
+  }
+  return contributions;
+}
+
+uint32_t MessagePacketizer::GetUnitBytes(const MessageUnit& unit, uint32_t size, uint32_t headerBytes) {
+  return headerBytes + unit.contributions.size() + 1 + Digits(unit.firstRow) + 1 + Digits(unit.rowCount) + 1
+      + unit.rowCount * size + unit.padding;
+}
+
+std::vector<MessageUnit> MessagePacketizer::Split(const std::string& contributions, uint32_t size,
+                                                  uint32_t headerBytes, uint32_t budget) {
+  std::vector<MessageUnit> units;
+  MessageUnit unit;
+  unit.contributions = contributions;
+  unit.firstRow = 0;
+  unit.rowCount = size;
+  unit.aggregates = CountAggregates(contributions);
+  unit.padding = GetCryptoBytes(unit.aggregates);
+  if (budget == 0) {
+    units.push_back(unit);
+    return units;
+  }
+
+  // The contributions and as many rows as fit, then row-only units
+  uint32_t padding = unit.padding;
+  unit.padding = 0;
+  // Everything but the rows and the padding, with the widest row numbers
+  uint32_t fixed = headerBytes + size + 3 + 2 * Digits(size);
+  uint32_t rowsPerUnit = std::max<uint32_t>(fixed < budget ? (budget - fixed) / size : 0, 1);
+  uint32_t row = 0;
+  do {
+    unit.firstRow = row;
+    unit.rowCount = std::min(rowsPerUnit, size - row);
+    row += unit.rowCount;
+    units.push_back(unit);
+    unit.contributions.assign(size, '0');
+    unit.aggregates = 0;
+  } while (row < size);
+  // Row-only units go first, so the KeyMatrix of a receiver is up to date when the
+  // contributions arrive and trigger its forwarding
+  std::reverse(units.begin(), units.end());
+
+  // The padding fills the spare room of every unit, the rest goes in padding-only units
+  for (uint32_t i = 0; i < units.size() && padding > 0; i++) {
+    uint32_t used = GetUnitBytes(units[i], size, headerBytes);
+    units[i].padding = std::min(used < budget ? budget - used : 0, padding);
+    padding -= units[i].padding;
+  }
+  unit.firstRow = 0;
+  unit.rowCount = 0;
+  while (padding > 0) {
+    uint32_t used = GetUnitBytes(unit, size, headerBytes);
+    unit.padding = std::min(used < budget ? budget - used : 1, padding);
+    padding -= unit.padding;
+    units.push_back(unit);
+    unit.padding = 0;
+  }
+  return units;
+}
@@ -0,0 +1,52 @@
+#ifndef MESSAGE_PACKETIZER_H
+#define MESSAGE_PACKETIZER_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+/**
+ * One datagram of a message: the forwarded contributions or a range of the
+ * sender's KeyMatrix rows, and a share of the message's crypto padding. A unit
+ * is encoded as
+ *   "<header><contributions> <firstRow> <rowCount> <rows><crypto padding>"
+ * and is useful on its own, so receivers merge units in any order and a lost
+ * unit only loses what it carries.
+ */
+struct MessageUnit
+{
+  std::string contributions;   ///< Forwarding string restricted to the unit's contributions
+  uint32_t firstRow;           ///< First KeyMatrix row carried
+  uint32_t rowCount;           ///< KeyMatrix rows carried
+  uint32_t aggregates;         ///< Aggregated values carried
+  uint32_t padding;            ///< Bytes of the message's crypto padding carried
+};
+
+/**
+ * Splits the messages of AppSender::DoSendPacket into units that fit a UDP
+ * payload budget (IP MTU minus IP and UDP headers), so that no message is
+ * IP-fragmented and one lost fragment no longer loses a whole message. The
+ * crypto padding keeps the size of a whole message's; it fills the spare room
+ * of the units, and what is left goes in padding-only units.
+ */
+class MessagePacketizer
+{
+public:
+  // Modelled crypto material of a message: 8 x (160 bytes, plus 64 bytes per level of the aggregated values)
+  static uint32_t GetCryptoBytes(uint32_t aggregates);
+  // Aggregated values sent for a forwarding string, just the group key once it is complete
+  static uint32_t CountAggregates(const std::string& contributions);
+  // Most contributions whose crypto material fits budget bytes, at least 1; 0 for a budget
+  // of 0 (no limit)
+  static uint32_t GetContributionBudget(uint32_t budget);
+
+  // Units of a message over a size x size KeyMatrix; headerBytes precede the forwarding
+  // string, budget is the largest unit (bytes), 0 for a single unit. Row-only units come
+  // first, padding-only units last. A budget too small for one row still yields oversized units.
+  static std::vector<MessageUnit> Split(const std::string& contributions, uint32_t size, uint32_t headerBytes,
+                                        uint32_t budget);
+  // Encoded size of a unit, padding included
+  static uint32_t GetUnitBytes(const MessageUnit& unit, uint32_t size, uint32_t headerBytes);
+};
+
+#endif /* MESSAGE_PACKETIZER_H */
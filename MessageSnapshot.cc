@@ -0,0 +1,11 @@
+#include "MessageSnapshot.h"
+
+MessageSnapshot::MessageSnapshot(const std::string& header, const KeyMatrix& matrix, uint32_t group)
+  : m_header(header), m_matrix(matrix.MatrixToString()), m_version(matrix.GetVersion()), m_group(group), m_refs(0) {
+}
+
+void MessageSnapshot::Unref() const {
+  if (--m_refs == 0) {
+    delete this;
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef MESSAGE_SNAPSHOT_H
+#define MESSAGE_SNAPSHOT_H
+
+#include "KeyMatrix.h"
+#include <string>
+#include <stdint.h>
+
+/**
+ * A node's state in one group, serialised once per KeyMatrix version: the
+ * message header "<epoch> <group> <sender slot> " and MatrixToString().
+ * Immutable and reference counted, so every per-neighbour message and
+ * scheduled send of that version shares one copy; only the forwarding
+ * string differs per neighbour. Ref/Unref fit ns3::Ptr.
+ */
+class MessageSnapshot
+{
+public:
+  MessageSnapshot(const std::string& header, const KeyMatrix& matrix, uint32_t group = 0);
+
+  const std::string& GetHeader() const { return m_header; }
+  const std::string& GetMatrix() const { return m_matrix; }
+  // KeyMatrix::GetVersion() of the serialised matrix
+  uint32_t GetVersion() const { return m_version; }
+  // Group id of the header, for accounting per group
+  uint32_t GetGroup() const { return m_group; }
+
+  // Starts unreferenced; the last Unref deletes the snapshot
+  void Ref() const { m_refs++; }
+  void Unref() const;
+
+private:
+  MessageSnapshot(const MessageSnapshot&);
+  MessageSnapshot& operator=(const MessageSnapshot&);
+
+  std::string m_header;
+  std::string m_matrix;   ///< size x size '0'/'1' characters
+  uint32_t m_version;
+  uint32_t m_group;
+  mutable uint32_t m_refs;
+};
+
+#endif /* MESSAGE_SNAPSHOT_H */
@@ -0,0 +1,132 @@
+#include "MobilityTrace.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MobilityTraceFile::MobilityTraceFile() : m_base(0), m_size(0), m_header(0), m_frames(0) {
+}
+
+MobilityTraceFile::~MobilityTraceFile() {
+  Close();
+}
+
+bool MobilityTraceFile::Open(const std::string& path) {
+  Close();
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(MobilityTraceHeader)) {
+    close(fd);
+    return false;
+  }
+  void* base = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+
+  const MobilityTraceHeader* header = static_cast<const MobilityTraceHeader*>(base);
+  size_t expected = sizeof(MobilityTraceHeader)
+      + static_cast<size_t>(header->numSamples) * header->numNodes * 3 * sizeof(float);
+  if (std::memcmp(header->magic, "RGKM", 4) != 0 || header->version != VERSION
+      || header->numSamples == 0 || static_cast<size_t>(st.st_size) < expected) {
+    munmap(base, st.st_size);
+    return false;
+  }
+
+  m_base = base;
+  m_size = st.st_size;
+  m_header = header;
+  m_frames = reinterpret_cast<const float*>(static_cast<const char*>(base) + sizeof(MobilityTraceHeader));
+  return true;
+}
+
+void MobilityTraceFile::Close() {
+  if (m_base != 0) {
+    munmap(m_base, m_size);
+  }
+  m_base = 0;
+  m_size = 0;
+  m_header = 0;
+  m_frames = 0;
+}
+
+double MobilityTraceFile::GetDuration() const {
+  return (m_header->numSamples - 1) * m_header->timeStep;
+}
+
+// Frame at or before time and the fraction of the way to the next frame
+void MobilityTraceFile::Locate(double time, uint32_t& frame, double& fraction) const {
+  double position = time / m_header->timeStep;
+  if (position <= 0) {
+    frame = 0;
+    fraction = 0;
+  } else if (position >= m_header->numSamples - 1) {
+    frame = m_header->numSamples - 1;
+    fraction = 0;
+  } else {
+    frame = static_cast<uint32_t>(std::floor(position));
+    fraction = position - frame;
+  }
+}
+
+TracePoint MobilityTraceFile::Sample(uint32_t frame, uint32_t node) const {
+  const float* p = m_frames + (static_cast<size_t>(frame) * m_header->numNodes + node) * 3;
+  TracePoint point = { p[0], p[1], p[2] };
+  return point;
+}
+
+TracePoint MobilityTraceFile::GetPosition(uint32_t node, double time) const {
+  uint32_t frame;
+  double fraction;
+  Locate(time, frame, fraction);
+  TracePoint a = Sample(frame, node);
+  if (fraction == 0) {
+    return a;
+  }
+  TracePoint b = Sample(frame + 1, node);
+  TracePoint point = { a.x + (b.x - a.x) * fraction, a.y + (b.y - a.y) * fraction, a.z + (b.z - a.z) * fraction };
+  return point;
+}
+
+TracePoint MobilityTraceFile::GetVelocity(uint32_t node, double time) const {
+  uint32_t frame;
+  double fraction;
+  Locate(time, frame, fraction);
+  TracePoint velocity = { 0, 0, 0 };
+  if (frame + 1 >= m_header->numSamples) {
+    return velocity;
+  }
+  TracePoint a = Sample(frame, node);
+  TracePoint b = Sample(frame + 1, node);
+  velocity.x = (b.x - a.x) / m_header->timeStep;
+  velocity.y = (b.y - a.y) / m_header->timeStep;
+  velocity.z = (b.z - a.z) / m_header->timeStep;
+  return velocity;
+}
+
+bool MobilityTraceFile::Write(const std::string& path, const MobilityTraceHeader& header,
+                              const std::vector<TracePoint>& frames) {
+  if (frames.size() != static_cast<size_t>(header.numSamples) * header.numNodes) {
+    return false;
+  }
+  FILE* out = std::fopen(path.c_str(), "wb");
+  if (out == 0) {
+    return false;
+  }
+  std::vector<float> packed(frames.size() * 3);
+  for (size_t i = 0; i < frames.size(); i++) {
+    packed[3 * i] = static_cast<float>(frames[i].x);
+    packed[3 * i + 1] = static_cast<float>(frames[i].y);
+    packed[3 * i + 2] = static_cast<float>(frames[i].z);
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+      && (packed.empty() || std::fwrite(&packed[0], sizeof(float), packed.size(), out) == packed.size());
+  return std::fclose(out) == 0 && ok;
+}
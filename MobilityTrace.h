@@ -0,0 +1,77 @@
+#ifndef MOBILITY_TRACE_H
+#define MOBILITY_TRACE_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+/**
+ * Position sample of one node
+ */
+struct TracePoint
+{
+  double x;
+  double y;
+  double z;
+};
+
+/**
+ * Header of a mobility trace file. The header is followed by numSamples
+ * frames of numNodes x {f32 x, f32 y, f32 z}; frame k holds the positions at
+ * k * timeStep. Fields are little-endian, so the file is mapped as-is.
+ */
+struct MobilityTraceHeader
+{
+  char magic[4];        ///< "RGKM"
+  uint32_t version;     ///< MobilityTraceFile::VERSION
+  uint32_t numNodes;
+  uint32_t numSamples;
+  double timeStep;      ///< Seconds between frames
+  double areaLength;
+  double areaWidth;
+  double areaHeight;
+  uint64_t seed;        ///< Seed the trace was generated from
+};
+
+/**
+ * Read-only, memory-mapped mobility trace. Positions between frames are
+ * linearly interpolated; before the first and after the last frame the
+ * node stays at the first/last position.
+ */
+class MobilityTraceFile
+{
+public:
+  static const uint32_t VERSION = 1;
+
+  MobilityTraceFile();
+  ~MobilityTraceFile();
+
+  bool Open(const std::string& path);
+  void Close();
+  bool IsOpen() const { return m_base != 0; }
+
+  const MobilityTraceHeader& GetHeader() const { return *m_header; }
+  uint32_t GetNodeCount() const { return m_header->numNodes; }
+  double GetDuration() const;
+
+  TracePoint GetPosition(uint32_t node, double time) const;
+  TracePoint GetVelocity(uint32_t node, double time) const;
+
+  // Write a whole trace; frames holds numSamples * numNodes points
+  static bool Write(const std::string& path, const MobilityTraceHeader& header,
+                    const std::vector<TracePoint>& frames);
+
+private:
+  MobilityTraceFile(const MobilityTraceFile&);
+  MobilityTraceFile& operator=(const MobilityTraceFile&);
+
+  void Locate(double time, uint32_t& frame, double& fraction) const;
+  TracePoint Sample(uint32_t frame, uint32_t node) const;
+
+  void* m_base;                        ///< Mapped file
+  size_t m_size;                       ///< Mapped bytes
+  const MobilityTraceHeader* m_header; ///< Header inside the mapping
+  const float* m_frames;               ///< First frame inside the mapping
+};
+
+#endif /* MOBILITY_TRACE_H */
@@ -0,0 +1,145 @@
+#include "NeighborTable.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Weight of a new signal sample in the moving averages
+const double SIGNAL_ALPHA = 0.25;
+// Delivery prior: logistic in the SNR, 50 % at 10 dB (the OFDM rates Minstrel settles on)
+const double SNR_50 = 10.0;
+const double SNR_WIDTH = 2.0;
+// Units of the prior against the observed history; the history is halved beyond HISTORY units
+const double PRIOR_WEIGHT = 4.0;
+const double HISTORY = 32.0;
+
+struct ByDelivery
+{
+  explicit ByDelivery(const NeighborTable& table) : m_table(table) {}
+  bool operator()(uint32_t a, uint32_t b) const {
+    return m_table.GetExpectedDelivery(a) > m_table.GetExpectedDelivery(b);
+  }
+  const NeighborTable& m_table;
+};
+
+}
+
+NeighborTable::NeighborTable()
+  : m_capacity(0), m_expiry(0), m_minDelivery(0), m_maxTargets(0), m_rank(false), m_retries(0), m_drops(0),
+    m_expired(0) {
+}
+
+void NeighborTable::Initialize(uint32_t numNodes, uint32_t capacity, double expiry) {
+  Link link = { 0, 0, 0, 0, false, 0, 0 };
+  m_links.assign(numNodes, link);
+  m_current.clear();
+  m_capacity = capacity;
+  m_expiry = expiry;
+}
+
+void NeighborTable::SetTargetPolicy(double minDelivery, uint32_t maxTargets, bool rank) {
+  m_minDelivery = minDelivery;
+  m_maxTargets = maxTargets;
+  m_rank = rank;
+}
+
+void NeighborTable::Heard(uint32_t id, uint32_t address, double now) {
+  if (id >= m_links.size()) {
+    return;
+  }
+  m_links[id].address = address;
+  m_links[id].lastHeard = now;
+  // Move to the back, the least recently heard neighbour leaves once the table is full
+  std::vector<uint32_t>::iterator it = std::find(m_current.begin(), m_current.end(), id);
+  if (it != m_current.end()) {
+    m_current.erase(it);
+  }
+  m_current.push_back(id);
+  if (m_current.size() > m_capacity) {
+    m_current.erase(m_current.begin());
+  }
+}
+
+void NeighborTable::RecordSignal(uint32_t id, double snr, double rssi) {
+  if (id >= m_links.size()) {
+    return;
+  }
+  Link& link = m_links[id];
+  if (!link.hasSignal) {
+    link.snr = snr;
+    link.rssi = rssi;
+    link.hasSignal = true;
+  } else {
+    link.snr += SIGNAL_ALPHA * (snr - link.snr);
+    link.rssi += SIGNAL_ALPHA * (rssi - link.rssi);
+  }
+}
+
+void NeighborTable::RecordSent(uint32_t id, uint32_t units) {
+  if (id >= m_links.size()) {
+    return;
+  }
+  Link& link = m_links[id];
+  link.sent += units;
+  if (link.sent > HISTORY) {
+    link.sent /= 2;
+    link.dropped /= 2;
+  }
+}
+
+void NeighborTable::RecordRetry(uint32_t id) {
+  if (id < m_links.size()) {
+    m_retries++;
+  }
+}
+
+void NeighborTable::RecordDrop(uint32_t id) {
+  if (id >= m_links.size()) {
+    return;
+  }
+  m_drops++;
+  m_links[id].dropped = std::min(m_links[id].dropped + 1, m_links[id].sent);
+}
+
+double NeighborTable::GetExpectedDelivery(uint32_t id) const {
+  const Link& link = m_links[id];
+  double prior = link.hasSignal ? 1 / (1 + std::exp(-(link.snr - SNR_50) / SNR_WIDTH)) : 0.5;
+  return (link.sent - link.dropped + PRIOR_WEIGHT * prior) / (link.sent + PRIOR_WEIGHT);
+}
+
+void NeighborTable::Expire(double now) {
+  if (m_expiry <= 0) {
+    return;
+  }
+  // Least recently heard first, so the expired ones are a prefix
+  uint32_t stale = 0;
+  while (stale < m_current.size() && now - m_links[m_current[stale]].lastHeard > m_expiry) {
+    stale++;
+  }
+  m_current.erase(m_current.begin(), m_current.begin() + stale);
+  m_expired += stale;
+}
+
+std::vector<uint32_t> NeighborTable::GetTargets(double now) {
+  Expire(now);
+  std::vector<uint32_t> targets;
+  targets.reserve(m_current.size());
+  for (uint32_t i = 0; i < m_current.size(); i++) {
+    if (GetExpectedDelivery(m_current[i]) >= m_minDelivery) {
+      targets.push_back(m_current[i]);
+    }
+  }
+  if (m_rank) {
+    // Stable: equally good neighbours keep their recency order
+    std::stable_sort(targets.begin(), targets.end(), ByDelivery(*this));
+  }
+  if (m_maxTargets > 0 && targets.size() > m_maxTargets) {
+    // The best ones when ranked, otherwise the most recently heard
+    if (m_rank) {
+      targets.resize(m_maxTargets);
+    } else {
+      targets.erase(targets.begin(), targets.end() - m_maxTargets);
+    }
+  }
+  return targets;
+}
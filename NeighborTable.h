@@ -0,0 +1,75 @@
+#ifndef NEIGHBOR_TABLE_H
+#define NEIGHBOR_TABLE_H
+
+#include <vector>
+#include <stdint.h>
+
+/**
+ * Link quality of the nodes a receiver has heard from, the targets of its
+ * unicast forwarding. Every node keeps a signal estimate from the PHY
+ * receive trace and the outcome of the unicast units sent to it (MAC
+ * retries and drops after the retry limit). A neighbour is any node heard
+ * within the expiry time, at most capacity of them, the least recently heard
+ * leaving first. Forwarding targets may be ranked by expected delivery:
+ * a prior from the SNR, refined by the observed drop rate.
+ */
+class NeighborTable
+{
+public:
+  NeighborTable();
+
+  // numNodes bounds the node ids; expiry 0 keeps neighbours until they are displaced
+  void Initialize(uint32_t numNodes, uint32_t capacity, double expiry);
+  // Targets need at least minDelivery; maxTargets 0 forwards to every neighbour left.
+  // rank orders them by expected delivery, otherwise they stay in recency order.
+  void SetTargetPolicy(double minDelivery, uint32_t maxTargets, bool rank);
+
+  // A packet from the node reached the application; address is how to reach it
+  void Heard(uint32_t id, uint32_t address, double now);
+  // PHY receive trace of a frame the node transmitted (dB, dBm)
+  void RecordSignal(uint32_t id, double snr, double rssi);
+  // Unicast units handed to the MAC, retransmissions and units dropped after the retry limit
+  void RecordSent(uint32_t id, uint32_t units);
+  void RecordRetry(uint32_t id);
+  void RecordDrop(uint32_t id);
+
+  // Current neighbours, best expected delivery first when ranked, else least recently heard first
+  std::vector<uint32_t> GetTargets(double now);
+  double GetExpectedDelivery(uint32_t id) const;
+  uint32_t GetAddress(uint32_t id) const { return m_links[id].address; }
+  double GetSnr(uint32_t id) const { return m_links[id].snr; }
+  double GetRssi(uint32_t id) const { return m_links[id].rssi; }
+  uint32_t GetSize() const { return m_current.size(); }
+
+  // Totals over all neighbours, for the run statistics
+  uint32_t GetRetries() const { return m_retries; }
+  uint32_t GetDrops() const { return m_drops; }
+  uint32_t GetExpired() const { return m_expired; }
+
+private:
+  struct Link
+  {
+    uint32_t address;   ///< Opaque address, 0 until the node is heard
+    double lastHeard;   ///< s
+    double snr;         ///< Moving average (dB)
+    double rssi;        ///< Moving average (dBm)
+    bool hasSignal;     ///< Whether snr/rssi hold a sample
+    double sent;        ///< Unicast units sent, halved as it grows
+    double dropped;     ///< Of those, dropped by the MAC
+  };
+
+  void Expire(double now);
+
+  std::vector<Link> m_links;        ///< Per node id
+  std::vector<uint32_t> m_current;  ///< Neighbour ids, least recently heard first
+  uint32_t m_capacity;
+  double m_expiry;                  ///< s, 0 for none
+  double m_minDelivery;
+  uint32_t m_maxTargets;
+  bool m_rank;
+  uint32_t m_retries;
+  uint32_t m_drops;
+  uint32_t m_expired;               ///< Neighbours aged out
+};
+
+#endif /* NEIGHBOR_TABLE_H */
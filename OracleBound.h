@@ -0,0 +1,64 @@
+#ifndef ORACLE_BOUND_H
+#define ORACLE_BOUND_H
+
+#include "MobilityTrace.h"
+#include "ResultsSink.h"
+#include <vector>
+#include <stdint.h>
+
+/**
+ * Links between the nodes of a run, one snapshot per step. Snapshot k holds
+ * the links during [k * step, (k + 1) * step) after the agreement starts;
+ * the last snapshot stays in force after that.
+ */
+class ConnectivityGraph
+{
+public:
+  ConnectivityGraph();
+
+  void Initialize(uint32_t numNodes, double step);
+  // Link every pair of nodes within range (m) of each other
+  void AddSnapshot(const std::vector<TracePoint>& positions, double range);
+
+  uint32_t GetNodeCount() const { return m_numNodes; }
+  uint32_t GetSnapshotCount() const { return m_numNodes > 0 ? m_links.size() / (m_numNodes * m_numNodes) : 0; }
+  double GetStep() const { return m_step; }
+  bool IsLinked(uint32_t snapshot, uint32_t a, uint32_t b) const {
+    return m_links[(static_cast<size_t>(snapshot) * m_numNodes + a) * m_numNodes + b] != 0;
+  }
+  // Most neighbours of any node in any snapshot
+  uint32_t GetMaxDegree() const { return m_maxDegree; }
+
+private:
+  uint32_t m_numNodes;
+  double m_step;                  ///< s
+  std::vector<uint8_t> m_links;   ///< snapshots x numNodes x numNodes
+  uint32_t m_maxDegree;
+};
+
+/**
+ * Best case of any agreement protocol on a given topology, to tell how far
+ * a run is from what its connectivity allows. Every node starts with its own
+ * contribution once the crypto set-up is done, a transmission carries any
+ * number of contributions to all current neighbours and takes the airtime of
+ * the smallest unit, and nothing is lost.
+ *
+ * The delay bound is the latest earliest arrival of any contribution at any
+ * node over the time-varying graph. The transmission bound holds for every
+ * schedule: the node transmitting first last holds the only copy of its
+ * contribution until then, after the other N - 1 nodes have each transmitted
+ * at least once, and needs ceil((N - 1) / maxDegree) more transmissions to
+ * reach everyone.
+ */
+class OracleBound
+{
+public:
+  static OracleResult Compute(const ConnectivityGraph& graph, double setupDelay, double hopTime);
+
+  // AppSender's first broadcast: the crypto set-up (whole ms) plus the 1 ms of SendPacket (s)
+  static double GetSetupDelay(uint32_t numNodes);
+  // 802.11g airtime of the smallest unit that carries a contribution, DIFS included (s)
+  static double GetHopTime(uint32_t numNodes, double dataRate);
+};
+
+#endif /* ORACLE_BOUND_H */
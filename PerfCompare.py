@@ -0,0 +1,104 @@
+"""Compare the simulator cost of two sweeps and flag performance regressions.
+
+    python PerfCompare.py baseline current [threshold] [file prefix]
+
+baseline and current are each a results directory (the *.bin files of
+ResultsSink, prefix "worker" for REGKA or "fastsim" for FastSim) or a merged
+*_Result.csv. For every configuration (link quality, area, nodes, strategy)
+present in both, compares the mean wall time, event loop time, events/s and
+peak RSS of the runs with a two-sided Welch t-test at 95 %. A change is
+flagged when it is significant and worse by more than threshold (default
+0.05). Exits with status 1 if anything was flagged.
+
+Mean events differ only when the protocol itself changed: the runs then do
+different work and the time comparison is no longer like for like.
+"""
+import csv
+import glob
+import math
+import os
+import sys
+from ResultsMerge import read_records
+from StreamAggregator import Welford, t95
+
+# (column, label, higher is worse)
+METRICS = [
+    ('wallSeconds', 'wall s', True),
+    ('runSeconds', 'run s', True),
+    ('eventsPerSecond', 'events/s', False),
+    ('peakRssKb', 'RSS KiB', True),
+]
+
+
+def config_key(record):
+    return (record['linkQuality'], float(record['areaLength']), float(record['areaWidth']),
+            float(record['areaHeight']), int(record['numNodes']), record['strategy'])
+
+
+def read_sweep(path, prefix="worker"):
+    """{config: {column: Welford}} over the runs of a sweep that recorded their cost"""
+    if os.path.isdir(path):
+        records = []
+        for name in sorted(glob.glob(os.path.join(path, prefix + "_*.bin"))):
+            records.extend(record for record, _ in read_records(name))
+    else:
+        with open(path) as fin:
+            records = list(csv.DictReader(fin))
+    sweep = {}
+    for record in records:
+        if record.get('wallSeconds', '') == '':
+            continue    # written before runs recorded their cost
+        stats = sweep.setdefault(config_key(record), {})
+        for column in [m[0] for m in METRICS] + ['events']:
+            stats.setdefault(column, Welford()).add(float(record[column]))
+    return sweep
+
+
+def welch_significant(a, b):
+    """Whether the means of a and b differ at 95 % (two-sided Welch t-test)"""
+    if a.count < 2 or b.count < 2:
+        return False
+    va, vb = a.variance() / a.count, b.variance() / b.count
+    if va + vb == 0:
+        return a.mean != b.mean
+    t = (b.mean - a.mean) / math.sqrt(va + vb)
+    df = (va + vb) ** 2 / ((va ** 2 / (a.count - 1) if va else 0) + (vb ** 2 / (b.count - 1) if vb else 0))
+    return abs(t) > t95(int(df))
+
+
+def compare(baseline_path, current_path, threshold=0.05, prefix="worker"):
+    baseline = read_sweep(baseline_path, prefix)
+    current = read_sweep(current_path, prefix)
+    regressions = 0
+    print("%-6s %-14s %5s %-44s %-9s %5s %12s %12s %8s" % (
+        "link", "area", "nodes", "strategy", "metric", "runs", "baseline", "current", "ratio"))
+    for key in sorted(set(baseline) & set(current)):
+        base, cur = baseline[key], current[key]
+        area = "%gx%gx%g" % key[1:4]
+        for column, label, higher_worse in METRICS:
+            a, b = base[column], cur[column]
+            ratio = b.mean / a.mean if a.mean > 0 else float('inf')
+            worse = ratio > 1 + threshold if higher_worse else ratio < 1 - threshold
+            flag = ""
+            if welch_significant(a, b):
+                flag = "  REGRESSION" if worse else "  changed"
+                regressions += 1 if worse else 0
+            print("%-6s %-14s %5d %-44s %-9s %5d %12.6g %12.6g %8.3f%s" % (
+                key[0], area, key[4], key[5], label, b.count, a.mean, b.mean, ratio, flag))
+        if base['events'].mean != cur['events'].mean:
+            print("%58s mean events %.6g -> %.6g, the protocol does different work" % (
+                "", base['events'].mean, cur['events'].mean))
+    for name, only in (("baseline", set(baseline) - set(current)), ("current", set(current) - set(baseline))):
+        if only:
+            print("%d configurations only in the %s sweep" % (len(only), name))
+    print("%d regressions" % regressions)
+    return regressions
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        print(__doc__)
+        sys.exit(2)
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 0.05
+    prefix = sys.argv[4] if len(sys.argv) > 4 else "worker"
+    sys.exit(1 if compare(sys.argv[1], sys.argv[2], threshold, prefix) else 0)
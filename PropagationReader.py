@@ -0,0 +1,147 @@
+import glob
+import os
+import struct
+import sys
+from datetime import datetime
+from ResultsMerge import read_records
+
+# Sections written by PropagationTrace::AddToRecord
+SECTION_PROPAGATION_PAIRS = 3
+SECTION_PROPAGATION_EVENTS = 4
+
+PAIR_LAYOUT = struct.Struct("<dHBxI")
+EVENT_LAYOUT = struct.Struct("<dHHHBB")
+UNKNOWN_HOPS = 0xff
+
+# Senders start at 1 s, the same origin keyAgreementDelay is measured from
+AGREEMENT_START = 1.0
+
+
+def _decode_pairs(payload):
+    n = struct.unpack_from("<I", payload)[0]
+    pairs = []
+    for i in range(n * n):
+        first_arrival, sender, hops, redundant = PAIR_LAYOUT.unpack_from(payload, 4 + i * PAIR_LAYOUT.size)
+        pairs.append((first_arrival, sender, hops, redundant))
+    return pairs
+
+
+def _decode_events(payload):
+    total, kept = struct.unpack_from("<QI", payload)
+    events = [EVENT_LAYOUT.unpack_from(payload, 12 + i * EVENT_LAYOUT.size) for i in range(kept)]
+    return {'total': total, 'events': events}
+
+
+PROPAGATION_DECODERS = {
+    SECTION_PROPAGATION_PAIRS: ('pairs', _decode_pairs),
+    SECTION_PROPAGATION_EVENTS: ('events', _decode_events),
+}
+
+
+def read_traces(trace_dir="results_cache"):
+    """Yield every traced run of the propagation_<worker>.bin files"""
+    for fname in sorted(glob.glob(os.path.join(trace_dir, "propagation_*.bin"))):
+        for record, _ in read_records(fname, decoders=PROPAGATION_DECODERS):
+            yield record
+
+
+def run_metrics(record):
+    """Propagation metrics of one run; own contributions are excluded"""
+    n = record['numNodes']
+    pairs = record['pairs']
+    arrivals = []
+    hops = []
+    redundant = 0
+    for index, (first_arrival, sender, hop, extra) in enumerate(pairs):
+        if index // n == index % n:
+            continue
+        redundant += extra
+        if first_arrival >= 0:
+            arrivals.append(first_arrival - AGREEMENT_START)
+            if hop != UNKNOWN_HOPS:
+                hops.append(hop)
+    arrivals.sort()
+    total_pairs = n * (n - 1)
+
+    def time_to_coverage(fraction):
+        needed = int(fraction * total_pairs + 0.999999)
+        if needed == 0 or needed > len(arrivals):
+            return None
+        return arrivals[needed - 1]
+
+    useful = len(arrivals)
+    return {
+        'coverage': float(useful) / total_pairs if total_pairs else 1.0,
+        'usefulDeliveries': useful,
+        'redundantDeliveries': redundant,
+        'efficiency': float(useful) / (useful + redundant) if useful + redundant else 0.0,
+        'meanHops': float(sum(hops)) / len(hops) if hops else 0.0,
+        't50': time_to_coverage(0.5),
+        't90': time_to_coverage(0.9),
+        't100': time_to_coverage(1.0),
+        'arrivals': arrivals,
+        'totalPairs': total_pairs,
+    }
+
+
+def _config_key(record):
+    return (record['linkQuality'], record['areaLength'], record['areaWidth'], record['areaHeight'], record['numNodes'],
+            record['strategy'])
+
+
+def _format(value):
+    if value is None:
+        return ""
+    if isinstance(value, float):
+        return "%.6g" % value
+    return str(value)
+
+
+RUN_COLUMNS = ['linkQuality', 'areaLength', 'areaWidth', 'areaHeight', 'numNodes', 'runId', 'strategy',
+               'coverage', 'usefulDeliveries', 'redundantDeliveries', 'efficiency', 'meanHops', 't50', 't90', 't100']
+
+
+def analyze(trace_dir="results_cache", step=0.01):
+    """Write per-run propagation metrics and per-configuration coverage curves"""
+    timestamp = datetime.now().strftime("%Y%m%d%H%M%S")
+    runs_file = timestamp + "_PropagationRuns.csv"
+    curves_file = timestamp + "_PropagationCurves.csv"
+
+    curves = {}   # config -> list of (sorted arrivals, total pairs)
+    count = 0
+    with open(runs_file, "w") as fout:
+        fout.write(",".join(RUN_COLUMNS) + "\n")
+        for record in read_traces(trace_dir):
+            metrics = run_metrics(record)
+            row = dict(record)
+            row.update(metrics)
+            fout.write(",".join(_format(row[c]) for c in RUN_COLUMNS) + "\n")
+            curves.setdefault(_config_key(record), []).append((metrics['arrivals'], metrics['totalPairs']))
+            count += 1
+
+    # Mean fraction of (node, contributor) pairs delivered by time t over the runs of a configuration
+    with open(curves_file, "w") as fout:
+        fout.write("linkQuality,areaLength,areaWidth,areaHeight,numNodes,strategy,runs,time,coverage\n")
+        for key in sorted(curves):
+            runs = curves[key]
+            horizon = max([a[-1] for a, _ in runs if a] or [0.0])
+            positions = [0] * len(runs)
+            t = 0.0
+            while True:
+                total = 0.0
+                for i, (arrivals, pairs) in enumerate(runs):
+                    while positions[i] < len(arrivals) and arrivals[positions[i]] <= t:
+                        positions[i] += 1
+                    total += float(positions[i]) / pairs if pairs else 1.0
+                fout.write(",".join(_format(v) for v in list(key) + [len(runs), t, total / len(runs)]) + "\n")
+                if t >= horizon:
+                    break
+                t += step
+
+    print("Analyzed %d traced runs: %s, %s" % (count, runs_file, curves_file))
+    return runs_file, curves_file
+
+
+if __name__ == "__main__":
+    analyze(sys.argv[1] if len(sys.argv) > 1 else "results_cache",
+            float(sys.argv[2]) if len(sys.argv) > 2 else 0.01)
@@ -0,0 +1,89 @@
+#include "PropagationTrace.h"
+#include "ResultsSink.h"
+
+const uint8_t PropagationTrace::UNKNOWN_HOPS;
+
+PropagationTrace::PropagationTrace(uint32_t networkSize, uint32_t ringCapacity)
+  : m_networkSize(networkSize),
+    m_firstArrival(networkSize * networkSize, -1.0),
+    m_firstSender(networkSize * networkSize, 0),
+    m_hops(networkSize * networkSize, UNKNOWN_HOPS),
+    m_redundant(networkSize * networkSize, 0),
+    m_ring(ringCapacity > 0 ? ringCapacity : 1),
+    m_totalEvents(0) {
+  // Every node owns its own contribution from the start
+  for (uint32_t i = 0; i < m_networkSize; i++) {
+    m_firstArrival[i * m_networkSize + i] = 0;
+    m_firstSender[i * m_networkSize + i] = i;
+    m_hops[i * m_networkSize + i] = 0;
+  }
+}
+
+// Record that sender delivered contributor's key contribution to node
+void PropagationTrace::RecordDelivery(double time, uint32_t node, uint32_t contributor, uint32_t sender) {
+  uint32_t pair = node * m_networkSize + contributor;
+  uint8_t senderHops = m_hops[sender * m_networkSize + contributor];
+  uint8_t hops = (senderHops == UNKNOWN_HOPS) ? UNKNOWN_HOPS : senderHops + 1;
+  bool first = m_firstArrival[pair] < 0;
+
+  if (first) {
+    m_firstArrival[pair] = time;
+    m_firstSender[pair] = sender;
+    m_hops[pair] = hops;
+  } else {
+    m_redundant[pair]++;
+  }
+
+  PropagationEvent& event = m_ring[m_totalEvents % m_ring.size()];
+  event.time = time;
+  event.node = node;
+  event.contributor = contributor;
+  event.sender = sender;
+  event.hops = hops;
+  event.first = first ? 1 : 0;
+  m_totalEvents++;
+}
+
+bool PropagationTrace::HasArrived(uint32_t node, uint32_t contributor) const {
+  return m_firstArrival[node * m_networkSize + contributor] >= 0;
+}
+
+uint32_t PropagationTrace::GetRedundantDeliveries() const {
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < m_redundant.size(); i++) {
+    total += m_redundant[i];
+  }
+  return total;
+}
+
+void PropagationTrace::AddToRecord(ResultsRecord& record) const {
+  // Pair table: u32 N, then N*N x {f64 first arrival, u16 sender, u8 hops, u8 pad, u32 redundant}
+  record.BeginSection(RESULTS_SECTION_PROPAGATION_PAIRS);
+  record.PutU32(m_networkSize);
+  for (uint32_t i = 0; i < m_firstArrival.size(); i++) {
+    record.PutF64(m_firstArrival[i]);
+    record.PutU16(m_firstSender[i]);
+    record.PutU8(m_hops[i]);
+    record.PutU8(0);
+    record.PutU32(m_redundant[i]);
+  }
+  record.EndSection();
+
+  // Ring contents, oldest first: u64 total events, u32 kept, then kept x
+  // {f64 time, u16 node, u16 contributor, u16 sender, u8 hops, u8 first}
+  uint64_t capacity = m_ring.size();
+  uint32_t kept = m_totalEvents < capacity ? m_totalEvents : capacity;
+  record.BeginSection(RESULTS_SECTION_PROPAGATION_EVENTS);
+  record.PutU64(m_totalEvents);
+  record.PutU32(kept);
+  for (uint64_t i = m_totalEvents - kept; i < m_totalEvents; i++) {
+    const PropagationEvent& event = m_ring[i % capacity];
+    record.PutF64(event.time);
+    record.PutU16(event.node);
+    record.PutU16(event.contributor);
+    record.PutU16(event.sender);
+    record.PutU8(event.hops);
+    record.PutU8(event.first);
+  }
+  record.EndSection();
+}
@@ -0,0 +1,55 @@
+#ifndef PROPAGATION_TRACE_H
+#define PROPAGATION_TRACE_H
+
+#include <vector>
+#include <stdint.h>
+
+class ResultsRecord;
+
+/**
+ * One delivery of a key contribution to a node
+ */
+struct PropagationEvent
+{
+  double time;            ///< Simulation time (s)
+  uint16_t node;          ///< Receiving node
+  uint16_t contributor;   ///< Contribution owner
+  uint16_t sender;        ///< Node that delivered it
+  uint8_t hops;           ///< Hop count of this copy (sender's hops + 1)
+  uint8_t first;          ///< 1 for the first arrival, 0 for a redundant delivery
+};
+
+/**
+ * Key contribution propagation trace of one run. Keeps the first arrival of
+ * every (node, contributor) pair in dense tables and the latest delivery
+ * events in a ring buffer allocated up front, so recording on the receive
+ * path is a few array writes; nothing is formatted or written before the run
+ * ends and the trace is appended to a ResultsRecord.
+ */
+class PropagationTrace
+{
+public:
+  static const uint8_t UNKNOWN_HOPS = 0xff;
+
+  PropagationTrace(uint32_t networkSize, uint32_t ringCapacity);
+
+  void RecordDelivery(double time, uint32_t node, uint32_t contributor, uint32_t sender);
+
+  bool HasArrived(uint32_t node, uint32_t contributor) const;
+  uint32_t GetRedundantDeliveries() const;
+  uint64_t GetTotalEvents() const { return m_totalEvents; }
+
+  // Append the pair table and the ring contents as two record sections
+  void AddToRecord(ResultsRecord& record) const;
+
+private:
+  uint32_t m_networkSize;                 ///< Network node count
+  std::vector<double> m_firstArrival;     ///< [node * N + contributor], -1 if never arrived
+  std::vector<uint16_t> m_firstSender;    ///< Sender of the first arrival
+  std::vector<uint8_t> m_hops;            ///< Hop count of the first arrival
+  std::vector<uint32_t> m_redundant;      ///< Deliveries after the first one
+  std::vector<PropagationEvent> m_ring;   ///< Latest delivery events
+  uint64_t m_totalEvents;                 ///< Events recorded, including overwritten ones
+};
+
+#endif /* PROPAGATION_TRACE_H */
@@ -15,6 +15,7 @@
 #include "ns3/trace-helper.h"
 #include "ns3/wifi-module.h"
 #include "ns3/stats-module.h"
+#include "ns3/energy-module.h"
 #include <string>
 #include <vector>
 #include <sys/stat.h>
@@ -23,8 +24,18 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <sstream>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
 
 #include "AdhocUdpApplication.h"
+#include "ResultsSink.h"
+#include "RegkaLog.h"
+#include "RangeCulledLossModel.h"
+#include "TraceReplayMobilityModel.h"
+#include "OracleBound.h"
+#include "RegkaProfile.h"
+#include "CountingSimulatorImpl.h"
 
 using namespace ns3;
 
@@ -37,6 +48,9 @@ std::string propagationDelayModel("ns3::ConstantSpeedPropagationDelayModel");
 // Node movement speed and mobility model
 std::string mobilitySpeed("ns3::UniformRandomVariable[Min=10|Max=50]");
 std::string mobilityModel("ns3::GaussMarkovMobilityModel");
+double mobilityMaxSpeed = 50;   // Upper bound of mobilitySpeed (m/s)
+// Precomputed mobility trace replayed instead of the Gauss-Markov model (tools/MobilityTraceGen)
+std::string mobilityTrace;
 // Activity area
 double areaLength = 500;   
 double areaWidth = 500;    
@@ -47,6 +61,71 @@ uint32_t numNodes = 5;
 uint32_t simuTime = 60;
 // Completion time
 double CompletionTime = 0;
+// Results directory and worker (parallel job slot) writing into it
+std::string resultsDir("./results_cache");
+uint32_t workerId = 0;
+// Key contribution propagation trace (appended to <resultsDir>/propagation_<worker>.bin)
+bool propagationTrace = false;
+uint32_t propagationTraceCapacity = 65536;
+// Range culling of the loss chain (maxRange 0 derives the range from the link budget)
+bool rangeCulling = false;
+double maxRange = 0;
+double cullingMargin = 10;   // dB
+// Energy: per-UAV source feeding the WiFi radio, and CPU power during crypto work
+double batteryEnergy = 10000;   // J
+double supplyVoltage = 3.7;     // V
+double cpuPower = 3.0;          // W
+// Fixed RNG stream blocks: with the same RngRun every protocol variant draws the same channel,
+// MAC, mobility and forwarding decision streams (common random numbers), however many other
+// random variables it creates. Every block holds STREAMS_PER_NODE streams per node (see StreamBlockStart).
+enum StreamBlock {
+	STREAM_CHANNEL = 0,
+	STREAM_WIFI,
+	STREAM_INTERNET,
+	STREAM_MOBILITY,
+	STREAM_FORWARDING,   // + STREAMS_PER_NODE * node id
+	STREAM_SEND          // + STREAMS_PER_NODE * node id
+};
+const int64_t STREAMS_PER_NODE = 16;
+// Dynamic membership: initial group size (0 = every node) and membership changes
+// "<time>:join|leave:<node>;...", each rekeyed incrementally or by a full re-agreement
+uint32_t initialMembers = 0;
+std::string membershipEvents;
+std::string rekeyMode("incremental");
+// Periodic rekeying: a full re-agreement of the current group every rekeyInterval seconds (0 = off)
+double rekeyInterval = 0;
+// Hierarchical agreement: clusters of clusterSize slots (0 = one flat group), formed
+// from positions at start (spatial) or node ID ranges (id)
+uint32_t clusterSize = 0;
+std::string clusterMode("spatial");
+// Split messages into units that fit the WiFi MTU instead of letting IP fragment them
+bool packetization = true;
+// Merge overheard unicasts between other nodes (promiscuous WiFi device)
+bool overhearing = false;
+// Neighbor table: neighbors not heard for neighborExpiry seconds age out (0 = never); forwarding
+// skips neighbors below minDelivery expected delivery and keeps maxTargets (0 = all), the best
+// ones with rankTargets, else the most recent. The defaults forward like the plain N/2 recent list.
+double neighborExpiry = 0;
+double minDelivery = 0;
+uint32_t maxTargets = 0;
+bool rankTargets = false;
+// Forwarding rule random|rarest; rarest-first sends the contributions whose crypto material fits
+// forwardingBudget bytes (0 = no limit)
+std::string forwarding("random");
+uint32_t forwardingBudget = 0;
+// Link range of the oracle's connectivity graph (m), 0 for the link budget range of the channel
+double oracleRange = 0;
+// Concurrent groups over member subsets "<nodes>;<nodes>;...", nodes as IDs and ranges "0-9,12"
+// (empty = one group); packing sends the messages of all groups to a neighbor in shared datagrams
+std::string groups;
+bool packing = true;
+// Backoff before every send fixed|jitter|slotted|density, in slots of sendSlot ms; jitter and
+// slotted spread over sendSlots slots (see SendScheduler)
+std::string sendPolicy("fixed");
+double sendSlot = 1.5;
+uint32_t sendSlots = 8;
+// Wall clock (monotonic ns) when main started, the run's wall time counts from here
+uint64_t experimentStartNs = 0;
 
 
 // ---------- Experiment data record labels ----------
@@ -60,9 +139,118 @@ std::string input;
 std::string runId;
 // ------------- End -----------------
 
+// ---------- Group membership state ----------
+struct MembershipEvent {
+	double time;
+	bool join;
+	uint32_t node;
+};
+std::vector<MembershipEvent> membershipSchedule;
+// Current members and group epoch (bumped by every change)
+std::vector<bool> groupMembers;
+uint32_t groupEpoch = 0;
+// Members of each concurrent group, empty for a single group
+std::vector<std::vector<bool> > groupSpecs;
+// One entry per applied change; the last one is open until every member completes
+std::vector<RekeyResult> rekeyResults;
+bool rekeyPhaseOpen = false;
+uint32_t rekeyPhaseSent = 0;
+uint32_t rekeyPhaseReceived = 0;
+// Tree merge count of every node when the open rekey phase started
+std::vector<uint32_t> rekeyPhaseMerges;
+// ------------- End -----------------
+
+// First stream of a block. The blocks are sized by numNodes (one spare node for the
+// shared consumers), so they cannot overlap however many nodes a run has.
+int64_t StreamBlockStart(StreamBlock block, uint32_t node = 0) {
+	return block * STREAMS_PER_NODE * (numNodes + 1) + node * STREAMS_PER_NODE;
+}
+
+// Abort when a consumer took more streams than its share of the block
+void CheckStreamBlock(StreamBlock block, int64_t used, bool perNode = false) {
+	int64_t capacity = perNode ? STREAMS_PER_NODE : STREAMS_PER_NODE * (numNodes + 1);
+	if (used > capacity) {
+		NS_FATAL_ERROR("Random stream block " << block << " needs " << used << " streams but holds " << capacity
+				<< "; raise STREAMS_PER_NODE");
+	}
+}
+
+// Parse --membershipEvents and check it against the initial group
+bool ParseMembershipEvents(const std::string& spec, std::vector<bool> members, std::vector<MembershipEvent>& events) {
+	std::istringstream in(spec);
+	std::string item;
+	double lastTime = 0;
+	while (std::getline(in, item, ';')) {
+		if (item.empty()) {
+			continue;
+		}
+		std::istringstream fields(item);
+		std::string time, kind, node;
+		if (!std::getline(fields, time, ':') || !std::getline(fields, kind, ':') || !std::getline(fields, node)) {
+			return false;
+		}
+		MembershipEvent event;
+		event.time = std::atof(time.c_str());
+		event.join = (kind == "join");
+		event.node = std::atoi(node.c_str());
+		// Events start after the initial agreement (1 s), in time order, and keep at least two members
+		if ((kind != "join" && kind != "leave") || event.node >= members.size()
+			|| event.time <= 1 || event.time < lastTime || members[event.node] == event.join) {
+			return false;
+		}
+		members[event.node] = event.join;
+		if (std::count(members.begin(), members.end(), true) < 2) {
+			return false;
+		}
+		lastTime = event.time;
+		events.push_back(event);
+	}
+	return true;
+}
+
+// Parse --groups: every group has at least two members, a node may belong to several
+bool ParseGroups(const std::string& spec, uint32_t numNodes, std::vector<std::vector<bool> >& groupSpecs) {
+	std::istringstream in(spec);
+	std::string item;
+	while (std::getline(in, item, ';')) {
+		std::vector<bool> members(numNodes, false);
+		std::istringstream ranges(item);
+		std::string range;
+		while (std::getline(ranges, range, ',')) {
+			if (range.empty()) {
+				continue;
+			}
+			size_t dash = range.find('-');
+			uint32_t first = std::atoi(range.substr(0, dash).c_str());
+			uint32_t last = dash == std::string::npos ? first : std::atoi(range.substr(dash + 1).c_str());
+			if (first > last || last >= numNodes) {
+				return false;
+			}
+			std::fill(members.begin() + first, members.begin() + last + 1, true);
+		}
+		if (std::count(members.begin(), members.end(), true) < 2) {
+			return false;
+		}
+		groupSpecs.push_back(members);
+	}
+	return true;
+}
+
+void CountPackets(const NodeContainer& nodes, uint32_t& sent, uint32_t& received) {
+	sent = 0;
+	received = 0;
+	for (uint32_t i = 0; i < nodes.GetN(); i++) {
+		sent += DynamicCast<AppSender>(nodes.Get(i)->GetApplication(0))->GetSentPackets();
+		received += DynamicCast<AppReceiver>(nodes.Get(i)->GetApplication(1))->GetReceivedPackets();
+	}
+}
+
 // Check if all nodes have completed key collection
 bool CheckAllNodesCompleted(const NodeContainer& nodes) {
 	for (uint32_t i = 0; i < nodes.GetN(); i++) {
+		if (!groupMembers[i]) {
+			continue;
+		}
 		Ptr<AppReceiver> receiver = DynamicCast<AppReceiver>(nodes.Get(i)->GetApplication(1));
 		if (!receiver->IsCompleted()) {
 			return false;
@@ -72,10 +260,18 @@ bool CheckAllNodesCompleted(const NodeContainer& nodes) {
 }
 
 void CheckCompletionAndStop(const NodeContainer& nodes) {
+	// A membership change came first, its rekey phase takes over
+	if (groupEpoch > 0) {
+		return;
+	}
 	if (CheckAllNodesCompleted(nodes)) {
-		NS_LOG_INFO("All nodes have collected key contributions, ending simulation");
 		CompletionTime = Simulator::Now().GetSeconds()-1;	
-		Simulator::Stop();
+		if (membershipSchedule.empty() && rekeyInterval == 0) {
+			REGKA_LOG_SUMMARY("All nodes have collected key contributions, ending simulation");
+			Simulator::Stop();
+		} else {
+			REGKA_LOG_SUMMARY("All members have collected key contributions, waiting for the next epoch");
+		}
 	} else {
 		double currentTime = Simulator::Now().GetSeconds();
 		if (currentTime < 2.0) {
@@ -87,8 +283,131 @@ void CheckCompletionAndStop(const NodeContainer& nodes) {
 }
 
 
+// Close the open rekey phase; its delay stays 0 if the members never completed
+void CloseRekeyPhase(const NodeContainer& nodes, bool completed) {
+	if (!rekeyPhaseOpen) {
+		return;
+	}
+	RekeyResult& result = rekeyResults.back();
+	uint32_t sent, received;
+	CountPackets(nodes, sent, received);
+	result.delay = completed ? Simulator::Now().GetSeconds() - result.time : 0;
+	result.sent = sent - rekeyPhaseSent;
+	result.received = received - rekeyPhaseReceived;
+	// Most tree nodes a member merged since the change
+	result.recomputed = 0;
+	for (uint32_t i = 0; i < nodes.GetN(); i++) {
+		if (groupMembers[i]) {
+			const KeyGenerationTree& tree = DynamicCast<AppReceiver>(nodes.Get(i)->GetApplication(1))->GetKeyTree();
+			result.recomputed = std::max(result.recomputed, tree.GetMergeCount() - rekeyPhaseMerges[i]);
+		}
+	}
+	rekeyPhaseOpen = false;
+	REGKA_LOG_SUMMARY("Rekey " << rekeyResults.size() << " (epoch " << groupEpoch << "): " << (completed ? "completed" : "not completed") << " after " << result.delay << " s, " 
+		<< result.sent << " packets sent, " << result.received << " received");
+}
 
-void SetupLinkQuality (YansWifiPhyHelper &wifiPhy, const std::string &quality)
+void CheckRekeyCompletion(const NodeContainer& nodes, uint32_t phase) {
+	// Superseded by a later membership change
+	if (!rekeyPhaseOpen || phase + 1 != rekeyResults.size()) {
+		return;
+	}
+	if (CheckAllNodesCompleted(nodes)) {
+		CloseRekeyPhase(nodes, true);
+		// Periodic rekeying runs until the end of the simulation
+		if (rekeyInterval == 0 && rekeyResults.size() == membershipSchedule.size()) {
+			REGKA_LOG_SUMMARY("All members hold the group key after the last membership change, ending simulation");
+			Simulator::Stop();
+		}
+	} else {
+		Simulator::Schedule(Seconds(0.01), &CheckRekeyCompletion, nodes, phase);
+	}
+}
+
+// Open the rekey phase of the epoch just started on every node
+void OpenRekeyPhase(const NodeContainer& nodes, RekeyKind kind, uint32_t node, uint32_t sponsor, bool full) {
+	RekeyResult result;
+	result.time = Simulator::Now().GetSeconds();
+	result.kind = kind;
+	result.node = node;
+	result.sponsor = sponsor;
+	result.members = std::count(groupMembers.begin(), groupMembers.end(), true);
+	result.full = full ? 1 : 0;
+	result.recomputed = 0;
+	result.delay = 0;
+	result.sent = 0;
+	result.received = 0;
+	rekeyResults.push_back(result);
+	CountPackets(nodes, rekeyPhaseSent, rekeyPhaseReceived);
+	rekeyPhaseMerges.resize(nodes.GetN());
+	for (uint32_t i = 0; i < nodes.GetN(); i++) {
+		rekeyPhaseMerges[i] = DynamicCast<AppReceiver>(nodes.Get(i)->GetApplication(1))->GetKeyTree().GetMergeCount();
+	}
+	rekeyPhaseOpen = true;
+	Simulator::Schedule(Seconds(0.01), &CheckRekeyCompletion, nodes, (uint32_t)(rekeyResults.size() - 1));
+}
+
+// Apply one membership change to every node and open its rekey phase. The change is
+// announced to all nodes at once; node IDs stay fixed, so the leaf and the KeyMatrix
+// row/column of a non-member are padding.
+void ApplyMembershipEvent(const NodeContainer& nodes, uint32_t index) {
+	const MembershipEvent& event = membershipSchedule[index];
+	CloseRekeyPhase(nodes, false);
+
+	// Sponsor from the tree before the change; every tree holds the same membership
+	const KeyGenerationTree& tree = DynamicCast<AppReceiver>(nodes.Get(0)->GetApplication(1))->GetKeyTree();
+	uint32_t sponsor = event.join ? event.node : tree.GetSponsor(event.node);
+	bool full = (rekeyMode == "full");
+	groupMembers[event.node] = event.join;
+	groupEpoch++;
+	for (uint32_t i = 0; i < nodes.GetN(); i++) {
+		Ptr<AppReceiver> receiver = DynamicCast<AppReceiver>(nodes.Get(i)->GetApplication(1));
+		if (full) {
+			receiver->RestartAgreement(groupMembers, groupEpoch);
+		} else if (event.join) {
+			receiver->MemberJoin(event.node, groupMembers, groupEpoch);
+		} else {
+			receiver->MemberLeave(event.node, sponsor, groupEpoch);
+		}
+	}
+	REGKA_LOG_SUMMARY("Epoch " << groupEpoch << ": node " << event.node << (event.join ? " joins" : " leaves") 
+		<< ", " << std::count(groupMembers.begin(), groupMembers.end(), true) << " members, " 
+		<< (full ? "full re-agreement" : "incremental rekey") << ", sponsor " << sponsor);
+	OpenRekeyPhase(nodes, event.join ? REKEY_JOIN : REKEY_LEAVE, event.node, sponsor, full);
+}
+
+// Oracle connectivity: one snapshot of the node positions per graph step from the agreement start
+void RecordConnectivity(const NodeContainer& nodes, ConnectivityGraph* graph, double range) {
+	std::vector<TracePoint> positions(nodes.GetN());
+	for (uint32_t i = 0; i < nodes.GetN(); i++) {
+		Vector position = nodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
+		positions[i].x = position.x;
+		positions[i].y = position.y;
+		positions[i].z = position.z;
+	}
+	graph->AddSnapshot(positions, range);
+	if (Simulator::Now().GetSeconds() + graph->GetStep() < simuTime) {
+		Simulator::Schedule(Seconds(graph->GetStep()), &RecordConnectivity, nodes, graph, range);
+	}
+}
+
+// Periodic epoch: the current group reruns the agreement from fresh contributions on the
+// same network, applications and (drifted) positions
+void ApplyPeriodicRekey(const NodeContainer& nodes) {
+	CloseRekeyPhase(nodes, false);
+	groupEpoch++;
+	for (uint32_t i = 0; i < nodes.GetN(); i++) {
+		DynamicCast<AppReceiver>(nodes.Get(i)->GetApplication(1))->RestartAgreement(groupMembers, groupEpoch);
+	}
+	REGKA_LOG_SUMMARY("Epoch " << groupEpoch << ": periodic rekey of " 
+		<< std::count(groupMembers.begin(), groupMembers.end(), true) << " members");
+	OpenRekeyPhase(nodes, REKEY_PERIODIC, 0, 0, true);
+	if (Simulator::Now().GetSeconds() + rekeyInterval < simuTime) {
+		Simulator::Schedule(Seconds(rekeyInterval), &ApplyPeriodicRekey, nodes);
+	}
+}
+
+Ptr<RangeCulledPropagationLossModel> SetupLinkQuality (YansWifiPhyHelper &wifiPhy, const std::string &quality)
 {
   /* Hardware constants (unchanged) */
   wifiPhy.Set ("RxNoiseFigure", DoubleValue (5.5));     // NF ≈ 5.5 dB
@@ -98,9 +417,9 @@ void SetupLinkQuality (YansWifiPhyHelper &wifiPhy, const std::string &quality)
   wifiPhy.Set ("TxPowerEnd",    DoubleValue (21.0));
   wifiPhy.Set ("CcaMode1Threshold", DoubleValue (-84.0));
 
-  /* Channel helper */
-  YansWifiChannelHelper ch;
-  ch.SetPropagationDelay ("ns3::ConstantSpeedPropagationDelayModel");
+  /* Channel */
+  Ptr<YansWifiChannel> channel = CreateObject<YansWifiChannel> ();
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
 
   /* Large‑scale + small‑scale fading parameters */
   double exponent, shadowVar, m0, m1, m2, d1, d2;
@@ -108,30 +427,65 @@ void SetupLinkQuality (YansWifiPhyHelper &wifiPhy, const std::string &quality)
   if (quality == "LOS")            // wide‑open rural / over‑sea LOS
     {
       exponent  = 2.0;                 // from 3GPP RMa LoS
-      shadowVar = 4.0;                 // σ = 2 dB  (variance = σ²)
-      m0 = 6.0;  m1 = 4.0;  m2 = 3.0;  // strong Rice component (K≈8 dB)
-      d1 = 400.0; d2 = 1000.0;         // 0.2·d_max / 0.5·d_max, d_max≈2 km
+      shadowVar = 4.0;                 // σ = 2 dB  (variance = σ²)
+      m0 = 6.0;  m1 = 4.0;  m2 = 3.0;  // strong Rice component (K≈8 dB)
+      d1 = 400.0; d2 = 1000.0;         // 0.2·d_max / 0.5·d_max, d_max≈2 km
     }
 
 
-  /* Attach the three loss models in sequence */
-  ch.AddPropagationLoss ("ns3::LogDistancePropagationLossModel",
-                         "Exponent",          DoubleValue (exponent),
-                         "ReferenceDistance", DoubleValue (1.0),
-                         "ReferenceLoss",     DoubleValue (40.05)); // FSPL @1 m (2.4 GHz)
+  /* Chain the three loss models in sequence */
+  Ptr<LogDistancePropagationLossModel> logDistance = CreateObject<LogDistancePropagationLossModel> ();
+  logDistance->SetAttribute ("Exponent",          DoubleValue (exponent));
+  logDistance->SetAttribute ("ReferenceDistance", DoubleValue (1.0));
+  logDistance->SetAttribute ("ReferenceLoss",     DoubleValue (40.05)); // FSPL @1 m (2.4 GHz)
+
+  std::ostringstream shadowing;
+  shadowing << "ns3::NormalRandomVariable[Mean=0|Variance=" << shadowVar << "]";
+  Ptr<RandomPropagationLossModel> random = CreateObject<RandomPropagationLossModel> ();
+  random->SetAttribute ("Variable", StringValue (shadowing.str ()));
+
+  Ptr<NakagamiPropagationLossModel> nakagami = CreateObject<NakagamiPropagationLossModel> ();
+  nakagami->SetAttribute ("m0", DoubleValue (m0));
+  nakagami->SetAttribute ("m1", DoubleValue (m1));
+  nakagami->SetAttribute ("m2", DoubleValue (m2));
+  nakagami->SetAttribute ("Distance1", DoubleValue (d1));
+  nakagami->SetAttribute ("Distance2", DoubleValue (d2));
+
+  logDistance->SetNext (random);
+  random->SetNext (nakagami);
+  CheckStreamBlock (STREAM_CHANNEL, logDistance->AssignStreams (StreamBlockStart (STREAM_CHANNEL)));
 
-  ch.AddPropagationLoss ("ns3::RandomPropagationLossModel",
-                         "Variable", StringValue ("ns3::NormalRandomVariable[Mean=0|Variance="
-                                                   + std::to_string (shadowVar) + "]"));
+  /* Oracle links: the mean link budget against the CCA threshold, no fading margin */
+  if (oracleRange <= 0)
+    {
+      oracleRange = RangeCulledPropagationLossModel::MaxRangeFromLinkBudget (21.0, 1.0 + 3.0, -84.0,
+                                                                             0, 40.05, exponent);
+    }
 
-  ch.AddPropagationLoss ("ns3::NakagamiPropagationLossModel",
-                         "m0", DoubleValue (m0),
-                         "m1", DoubleValue (m1),
-                         "m2", DoubleValue (m2),
-                         "Distance1", DoubleValue (d1),
-                         "Distance2", DoubleValue (d2));
+  if (!rangeCulling)
+    {
+      channel->SetPropagationLossModel (logDistance);
+      wifiPhy.SetChannel (channel);
+      return 0;
+    }
 
-  wifiPhy.SetChannel (ch.Create ());
+  /* Only evaluate the chain for pairs within the link-budget range:
+     21 dBm + 1 dB TxGain + 3 dBi RxGain against the CCA threshold, with a
+     fading margin for shadowing and Nakagami up-fades */
+  double range = maxRange;
+  if (range <= 0)
+    {
+      range = RangeCulledPropagationLossModel::MaxRangeFromLinkBudget (21.0, 1.0 + 3.0, -84.0,
+                                                                         cullingMargin, 40.05, exponent);
+    }
+  Ptr<RangeCulledPropagationLossModel> culled = CreateObject<RangeCulledPropagationLossModel> ();
+  culled->SetAttribute ("MaxRange", DoubleValue (range));
+  culled->SetAttribute ("MaxSpeed", DoubleValue (mobilityMaxSpeed));
+  culled->SetInnerModel (logDistance);
+  channel->SetPropagationLossModel (culled);
+  wifiPhy.SetChannel (channel);
+  REGKA_LOG_SUMMARY ("Range culling enabled, maximum range " << range << " m");
+  return culled;
 }
 
 
@@ -149,13 +503,28 @@ void startSimulation(const std::string& linkQuality) {
 	WifiHelper wifi;
 	wifi.SetStandard(WIFI_PHY_STANDARD_80211g);  // Use 802.11g standard
 	YansWifiPhyHelper wifiPhy = YansWifiPhyHelper::Default();
-	SetupLinkQuality(wifiPhy, linkQuality);
+	Ptr<RangeCulledPropagationLossModel> culledLoss = SetupLinkQuality(wifiPhy, linkQuality);
 
 	NqosWifiMacHelper wifiMac = NqosWifiMacHelper::Default();
 	wifi.SetRemoteStationManager("ns3::MinstrelWifiManager");		
 	wifiMac.SetType("ns3::AdhocWifiMac");
 
 	NetDeviceContainer devices = wifi.Install(wifiPhy, wifiMac, nodes);
+	CheckStreamBlock(STREAM_WIFI, wifi.AssignStreams(devices, StreamBlockStart(STREAM_WIFI)));
+	// -------------- End ----------------
+
+
+	// ------------------------------------------------------------
+	// ---------- Setup energy model -------------
+	// ------------------------------------------------------------
+	BasicEnergySourceHelper energySourceHelper;
+	energySourceHelper.Set("BasicEnergySourceInitialEnergyJ", DoubleValue(batteryEnergy));
+	energySourceHelper.Set("BasicEnergySupplyVoltageV", DoubleValue(supplyVoltage));
+	EnergySourceContainer energySources = energySourceHelper.Install(nodes);
+
+	// Default WifiRadioEnergyModel currents (802.11g transceiver)
+	WifiRadioEnergyModelHelper radioEnergyHelper;
+	radioEnergyHelper.Install(devices, energySources);
 	// -------------- End ----------------
 
 
@@ -164,6 +533,7 @@ void startSimulation(const std::string& linkQuality) {
 	// ------------------------------------------------------------
 	InternetStackHelper internet;
 	internet.Install(nodes);
+	CheckStreamBlock(STREAM_INTERNET, internet.AssignStreams(nodes, StreamBlockStart(STREAM_INTERNET)));
 	Ipv4AddressHelper ipv4;
 	ipv4.SetBase("10.1.1.0", "255.255.255.0");
 	Ipv4InterfaceContainer ipv4Container = ipv4.Assign(devices);
@@ -181,6 +551,18 @@ void startSimulation(const std::string& linkQuality) {
 	totalRecvPackets->SetKey("Receiver");
 	totalRecvPackets->SetContext("Total received packets");
 
+	// Largest message unit: the device MTU minus the IPv4 and UDP headers
+	uint32_t maxUnitSize = packetization ? devices.Get(0)->GetMtu() - 20 - 8 : 0;
+
+	// Send backoff of every node, checked in main
+	SendPolicy policy = SEND_POLICY_FIXED;
+	SendScheduler::ParsePolicy(sendPolicy, policy);
+
+	PropagationTrace* trace = 0;
+	if (propagationTrace) {
+		trace = new PropagationTrace(numNodes, propagationTraceCapacity);
+	}
+
 			// Setup application layer information
 	for (uint32_t i = 0; i < numNodes; i++) {
 		Ptr<Node> nodeToInstallApp = nodes.Get(i);
@@ -192,10 +574,28 @@ void startSimulation(const std::string& linkQuality) {
 		receiver->SetNumNodes(numNodes);
 		receiver->SetNodeId(i);
         sender->SetNodeId(i);
+		receiver->SetPropagationTrace(trace);
+		CheckStreamBlock(STREAM_FORWARDING, receiver->AssignStreams(StreamBlockStart(STREAM_FORWARDING, i)), true);
         
-        // Initialize KeyMatrix
-        receiver->SetNetworkSize(numNodes);
+        // Initialize KeyMatrix; clustered nodes get theirs once positions are known
+        if (clusterSize == 0) {
+            receiver->SetNetworkSize(numNodes);
+            receiver->SetMembers(groupMembers);
+            if (!groupSpecs.empty()) {
+                receiver->SetGroups(groupSpecs);
+            }
+        }
         sender->SetNetworkSize(numNodes);
+		sender->SetMaxUnitSize(maxUnitSize);
+		sender->SetPacking(packing && !groupSpecs.empty());
+		sender->SetSendPolicy(policy, sendSlot, sendSlots);
+		CheckStreamBlock(STREAM_SEND, sender->AssignStreams(StreamBlockStart(STREAM_SEND, i)), true);
+		receiver->SetOverhearing(overhearing);
+		receiver->SetNeighborPolicy(neighborExpiry, minDelivery, maxTargets, rankTargets);
+		receiver->SetForwardingRule(forwarding == "rarest" ? FORWARDING_RAREST_FIRST : FORWARDING_RANDOM,
+		                            forwardingBudget);
+		receiver->GetCryptoEnergy().SetPower(cpuPower);
+		sender->GetCryptoEnergy().SetPower(cpuPower);
 
 		nodeToInstallApp->AddApplication(sender);
 		nodeToInstallApp->AddApplication(receiver);
@@ -212,54 +612,94 @@ void startSimulation(const std::string& linkQuality) {
 	// ------------------------------------------------------------
 	// ---------- Setup mobility model -------------
 	// ------------------------------------------------------------
-	MobilityHelper mobility;
-
-	// RandomBoxPositionAllocator implements random position selection within a cube
-	Ptr<RandomBoxPositionAllocator> randPosLocator = CreateObject<RandomBoxPositionAllocator>();
-	// Randomly set node positions
-	std::ostringstream playGround;
-	playGround << "ns3::UniformRandomVariable[Min=0.0|" << "Max=" << areaLength << "]";
-	randPosLocator->SetAttribute("X", StringValue(playGround.str()));
-	playGround.str("");
-	playGround << "ns3::UniformRandomVariable[Min=0.0|" << "Max=" << areaWidth << "]";
-	randPosLocator->SetAttribute("Y", StringValue(playGround.str()));
-	playGround.str("");
-	playGround << "ns3::UniformRandomVariable[Min=0.0|" << "Max=" << areaHeight << "]";
-	randPosLocator->SetAttribute("Z", StringValue(playGround.str()));
-	mobility.SetPositionAllocator(randPosLocator);
-
-	// Set mobility model
-	mobility.SetMobilityModel(mobilityModel,									
-			"Bounds", BoxValue(												
-					Box(0, areaLength, 0, areaWidth, 0, areaHeight)),
-			"Alpha", DoubleValue (0.85),										
-			"TimeStep", TimeValue(Seconds(1)),								
-			"MeanVelocity", StringValue(mobilitySpeed),						
-			"MeanDirection", StringValue(										
-					"ns3::UniformRandomVariable[Min=0|Max=6.283185307]"),
-			"MeanPitch", StringValue(											
-					"ns3::UniformRandomVariable[Min=0.05|Max=0.05]"),
-			"NormalVelocity", StringValue(										
-					"ns3::NormalRandomVariable[Mean=0.0|Variance=0.0|Bound=0.0]"),
-			"NormalDirection", StringValue(									
-					"ns3::NormalRandomVariable[Mean=0.0|Variance=0.2|Bound=0.4]"),
-			"NormalPitch", StringValue(										
-					"ns3::NormalRandomVariable[Mean=0.0|Variance=0.02|Bound=0.04]")
-			);
-
-	for (uint32_t i = 0; i < numNodes; ++i) {
-		mobility.Install(nodes.Get(i));
+	MobilityTraceFile traceFile;
+	Time mobilityStep = Seconds(1);
+	if (!mobilityTrace.empty()) {
+		if (!traceFile.Open(mobilityTrace)) {
+			NS_FATAL_ERROR("Unable to open mobility trace " << mobilityTrace);
+		}
+		if (traceFile.GetNodeCount() != numNodes) {
+			NS_FATAL_ERROR("Mobility trace " << mobilityTrace << " has " << traceFile.GetNodeCount() 
+				<< " nodes, expected " << numNodes);
+		}
+		if (traceFile.GetDuration() < simuTime) {
+			NS_LOG_WARN("Mobility trace ends at " << traceFile.GetDuration() << " s, nodes hold their last position");
+		}
+		mobilityStep = Seconds(traceFile.GetHeader().timeStep);
+		for (uint32_t i = 0; i < numNodes; ++i) {
+			Ptr<TraceReplayMobilityModel> replay = CreateObject<TraceReplayMobilityModel>();
+			replay->SetTrace(&traceFile, i);
+			nodes.Get(i)->AggregateObject(replay);
+		}
+	} else {
+		MobilityHelper mobility;
+
+		// RandomBoxPositionAllocator implements random position selection within a cube
+		Ptr<RandomBoxPositionAllocator> randPosLocator = CreateObject<RandomBoxPositionAllocator>();
+		// Randomly set node positions
+		std::ostringstream playGround;
+		playGround << "ns3::UniformRandomVariable[Min=0.0|" << "Max=" << areaLength << "]";
+		randPosLocator->SetAttribute("X", StringValue(playGround.str()));
+		playGround.str("");
+		playGround << "ns3::UniformRandomVariable[Min=0.0|" << "Max=" << areaWidth << "]";
+		randPosLocator->SetAttribute("Y", StringValue(playGround.str()));
+		playGround.str("");
+		playGround << "ns3::UniformRandomVariable[Min=0.0|" << "Max=" << areaHeight << "]";
+		randPosLocator->SetAttribute("Z", StringValue(playGround.str()));
+		// Positions are drawn during Install, so the allocator gets its streams first
+		int64_t mobilityStream = StreamBlockStart(STREAM_MOBILITY) + randPosLocator->AssignStreams(StreamBlockStart(STREAM_MOBILITY));
+		mobility.SetPositionAllocator(randPosLocator);
+
+		// Set mobility model
+		mobility.SetMobilityModel(mobilityModel,									
+				"Bounds", BoxValue(												
+						Box(0, areaLength, 0, areaWidth, 0, areaHeight)),
+				"Alpha", DoubleValue (0.85),										
+				"TimeStep", TimeValue(Seconds(1)),								
+				"MeanVelocity", StringValue(mobilitySpeed),						
+				"MeanDirection", StringValue(										
+						"ns3::UniformRandomVariable[Min=0|Max=6.283185307]"),
+				"MeanPitch", StringValue(											
+						"ns3::UniformRandomVariable[Min=0.05|Max=0.05]"),
+				"NormalVelocity", StringValue(										
+						"ns3::NormalRandomVariable[Mean=0.0|Variance=0.0|Bound=0.0]"),
+				"NormalDirection", StringValue(									
+						"ns3::NormalRandomVariable[Mean=0.0|Variance=0.2|Bound=0.4]"),
+				"NormalPitch", StringValue(										
+						"ns3::NormalRandomVariable[Mean=0.0|Variance=0.02|Bound=0.04]")
+				);
+
+		for (uint32_t i = 0; i < numNodes; ++i) {
+			mobility.Install(nodes.Get(i));
+		}
+		int64_t mobilityStreams = mobilityStream + mobility.AssignStreams(nodes, mobilityStream);
+		CheckStreamBlock(STREAM_MOBILITY, mobilityStreams - StreamBlockStart(STREAM_MOBILITY));
 	}
-	// -------------- End ----------------
 
+	// The culling grid follows the mobility time step
+	if (culledLoss != 0) {
+		culledLoss->Track(nodes, mobilityStep);
+	}
 
-	// ------------------------------------------------------------
-	// ---------- Experiment data collection -------------
-	// ------------------------------------------------------------
-	DataCollector dataCollector;
-	dataCollector.DescribeRun(experiment, strategy, input, runId);
-	dataCollector.AddDataCalculator(totalSentPackets);
-	dataCollector.AddDataCalculator(totalRecvPackets);
+	// Clusters of the hierarchical agreement, from the initial positions
+	ClusterLayout clusterLayout(numNodes, clusterSize == 0 ? numNodes : clusterSize);
+	if (clusterSize > 0) {
+		if (clusterMode == "spatial") {
+			std::vector<double> x(numNodes), y(numNodes), z(numNodes);
+			for (uint32_t i = 0; i < numNodes; i++) {
+				Vector position = nodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
+				x[i] = position.x;
+				y[i] = position.y;
+				z[i] = position.z;
+			}
+			clusterLayout.AssignByPosition(x, y, z);
+		}
+		for (uint32_t i = 0; i < numNodes; i++) {
+			DynamicCast<AppReceiver>(nodes.Get(i)->GetApplication(1))->SetClusterLayout(&clusterLayout);
+		}
+		REGKA_LOG_SUMMARY("Hierarchical agreement: " << clusterLayout.GetClusterCount() << " " << clusterMode
+		                  << " clusters of up to " << clusterSize << " nodes");
+	}
 	// -------------- End ----------------
 
 
@@ -271,18 +711,52 @@ void startSimulation(const std::string& linkQuality) {
 	Simulator::Stop(Seconds(simuTime));
 	// Start periodic check
 	Simulator::Schedule(Seconds(0.001), &CheckCompletionAndStop, nodes);
+	for (uint32_t i = 0; i < membershipSchedule.size(); i++) {
+		Simulator::Schedule(Seconds(membershipSchedule[i].time), &ApplyMembershipEvent, nodes, i);
+	}
+	// Periodic epochs start one interval after the initial agreement (1 s)
+	if (rekeyInterval > 0 && 1 + rekeyInterval < simuTime) {
+		Simulator::Schedule(Seconds(1 + rekeyInterval), &ApplyPeriodicRekey, nodes);
+	}
+	// Connectivity graph of the oracle bounds, for agreements of the whole network
+	ConnectivityGraph connectivity;
+	connectivity.Initialize(numNodes, 1.0);
+	if (initialMembers == numNodes && groupSpecs.empty()) {
+		Simulator::Schedule(Seconds(1), &RecordConnectivity, nodes, &connectivity, oracleRange);
+	}
 	// Start simulation
-	Simulator::Run();
+	RegkaProfile::Reset();
+	uint64_t runStartNs = RegkaProfile::Now();
+	{
+		REGKA_PROFILE_SCOPE(PROBE_SIMULATOR_RUN);
+		Simulator::Run();
+	}
+	PerfResult perf;
+	perf.runSeconds = (RegkaProfile::Now() - runStartNs) / 1e9;
+	perf.events = CountingSimulatorImpl::GetCurrentEventCount();
+	perf.peakRssKb = RegkaProfile::GetPeakRssKb();
+	CloseRekeyPhase(nodes, false);
+	// Rekey workload duration, from the initial agreement to the end of the run
+	double rekeyDuration = Simulator::Now().GetSeconds() - 1;
 
 	// Count packet statistics
 	uint32_t totalSent = 0;
 	uint32_t totalReceived = 0;
 	uint32_t successfulNodes = 0; 
+	// Members at the end of the run (of at least one group with --groups)
+	uint32_t finalMembers = 0;
+	uint32_t totalOverheard = 0;
+	uint32_t totalMacRetries = 0;
+	uint32_t totalMacDrops = 0;
+	uint32_t totalExpired = 0;
 
 	// Used to record sent and received packet count for each node
 	std::vector<uint32_t> sentPackets;
 	std::vector<uint32_t> receivedPackets;
 	std::vector<uint32_t> uniqueContributions; 
+	std::vector<NodeResult> nodeResults(numNodes);
+	std::vector<NodeEnergy> nodeEnergy(numNodes);
+	double totalEnergy = 0;
 	sentPackets.reserve(numNodes);
 	receivedPackets.reserve(numNodes);
 	uniqueContributions.reserve(numNodes);
@@ -292,37 +766,47 @@ void startSimulation(const std::string& linkQuality) {
 		Ptr<AppSender> sender = DynamicCast<AppSender>(nodes.Get(i)->GetApplication(0));
 		// Get receiver and sender packet counts
 		uint32_t packetsReceived = receiver->GetReceivedPackets();
-		NS_LOG_INFO("Node " << i << " received packet count: " << packetsReceived);
+		REGKA_LOG_DETAIL("Node " << i << " received packet count: " << packetsReceived);
 		uint32_t packetsSent = sender->GetSentPackets();
-		NS_LOG_INFO("Node " << i << " sent packet count: " << packetsSent);
+		REGKA_LOG_DETAIL("Node " << i << " sent packet count: " << packetsSent);
+		totalOverheard += receiver->GetOverheardPackets();
+		totalMacRetries += receiver->GetNeighborTable().GetRetries();
+		totalMacDrops += receiver->GetNeighborTable().GetDrops();
+		totalExpired += receiver->GetNeighborTable().GetExpired();
 		
 		sentPackets.push_back(packetsSent);
 		receivedPackets.push_back(packetsReceived);
-		const KeyMatrix& keyMatrix = receiver->GetKeyMatrix();
 		
-		// Count different key contributions received by node i
-		uint32_t contributionCount = 0;
-		for (uint32_t j = 0; j < numNodes; j++) {
-			if (keyMatrix.HasKeyContribution(i, j)) {
-				contributionCount++;
-			}	
-		}
+		// Count different key contributions received by node i (covered by its cluster keys when clustered)
+		uint32_t contributionCount = receiver->GetContributionCount();
 		uniqueContributions.push_back(contributionCount);
-		NS_LOG_INFO("Node " << i << " different key contribution count: " << contributionCount);
+		REGKA_LOG_DETAIL("Node " << i << " different key contribution count: " << contributionCount
+		                 << ", KeyMatrix state " << receiver->GetMatrixBits() << " bits");
 		
-		// Check if node i has received all key contributions
-		bool allContributionsReceived = true;
-		for (uint32_t j = 0; j < numNodes; j++) {
-			if (!keyMatrix.HasKeyContribution(i, j)) {
-				allContributionsReceived = false;
-				break;
-			}	
+		// Check if node i has received all key contributions (of every group it belongs to);
+		// non-members, and nodes outside every group, never complete
+		bool allContributionsReceived = receiver->IsMember()
+				&& (groupSpecs.empty() ? contributionCount == numNodes : receiver->IsCompleted());
+		if (receiver->IsMember()) {
+			finalMembers++;
 		}
 		if (allContributionsReceived) {
 			successfulNodes++;
-			NS_LOG_INFO("Node " << i << " successfully collected all key contributions");
+			REGKA_LOG_DETAIL("Node " << i << " successfully collected all key contributions");
 			
 		}
+		nodeResults[i].sent = packetsSent;
+		nodeResults[i].received = packetsReceived;
+		nodeResults[i].contributions = contributionCount;
+		nodeResults[i].completed = allContributionsReceived ? 1 : 0;
+
+		// Radio energy is what the node's source lost; the radio is its only consumer
+		Ptr<EnergySource> source = energySources.Get(i);
+		nodeEnergy[i].remaining = source->GetRemainingEnergy();
+		nodeEnergy[i].radio = source->GetInitialEnergy() - nodeEnergy[i].remaining;
+		nodeEnergy[i].cpu = sender->GetCryptoEnergy().GetEnergy() + receiver->GetCryptoEnergy().GetEnergy();
+		totalEnergy += nodeEnergy[i].radio + nodeEnergy[i].cpu;
+		REGKA_LOG_DETAIL("Node " << i << " energy: radio " << nodeEnergy[i].radio << " J, crypto CPU " << nodeEnergy[i].cpu << " J");
 		// Count total sent and received packet numbers	
 		totalSent += packetsSent;
 		totalReceived += packetsReceived;
@@ -330,25 +814,30 @@ void startSimulation(const std::string& linkQuality) {
 	}
 	
 	// Output packet information received by each node
-	NS_LOG_INFO("------------ Node Packet Statistics ------------");
-	NS_LOG_INFO("+--------+-------------+-------------+------------------+----------+");
-	NS_LOG_INFO("| Node ID | Sent Packets | Recv Packets | Key Contributions | Completed |");
-	NS_LOG_INFO("+--------+-------------+-------------+------------------+----------+");
+	REGKA_LOG_SUMMARY("------------ Node Packet Statistics ------------");
+	REGKA_LOG_SUMMARY("+--------+-------------+-------------+------------------+----------+");
+	REGKA_LOG_SUMMARY("| Node ID | Sent Packets | Recv Packets | Key Contributions | Completed |");
+	REGKA_LOG_SUMMARY("+--------+-------------+-------------+------------------+----------+");
 
 	for (uint32_t i = 0; i < numNodes; i++) {
 		Ptr<AppReceiver> receiver = DynamicCast<AppReceiver>(nodes.Get(i)->GetApplication(1));
 		Ptr<AppSender> sender = DynamicCast<AppSender>(nodes.Get(i)->GetApplication(0));
-		NS_LOG_INFO("| " << std::setw(6) << i << " | " << std::setw(11) << sender->GetSentPackets() << " | " 
+		REGKA_LOG_SUMMARY("| " << std::setw(6) << i << " | " << std::setw(11) << sender->GetSentPackets() << " | " 
 			<< std::setw(11) << receiver->GetReceivedPackets() << " | " 
 			<< std::setw(16) << uniqueContributions[i] << " | " 
 			<< (receiver->IsCompleted() ? "Yes" : "No") << " |");
 	}
-	NS_LOG_INFO("+--------+-------------+-------------+------------------+----------+");
+	REGKA_LOG_SUMMARY("+--------+-------------+-------------+------------------+----------+");
 
 	// Output summary information
-	NS_LOG_INFO("Summary Statistics:");
-	NS_LOG_INFO("  Total sent packets: " << totalSent);
-	NS_LOG_INFO("  Total received packets: " << totalReceived);
+	REGKA_LOG_SUMMARY("Summary Statistics:");
+	REGKA_LOG_SUMMARY("  Total sent packets: " << totalSent);
+	REGKA_LOG_SUMMARY("  Total received packets: " << totalReceived);
+	if (overhearing) {
+		REGKA_LOG_SUMMARY("  Total overheard packets: " << totalOverheard);
+	}
+	REGKA_LOG_SUMMARY("  MAC retries: " << totalMacRetries << ", MAC drops: " << totalMacDrops
+	                  << ", expired neighbors: " << totalExpired << " (send policy " << sendPolicy << ")");
 	// NS_LOG_INFO("  Duplicate received packets: " << totalDuplicates);
 	
 	// Calculate more statistical metrics
@@ -363,108 +852,373 @@ void startSimulation(const std::string& linkQuality) {
 	}
 	double avgUniqueContributions = (double)totalUniqueContributions / numNodes;
 	
-	NS_LOG_INFO("Analysis Metrics:");
-	NS_LOG_INFO("  Average packets sent per node: " << std::fixed << std::setprecision(2) << avgSent);
-	NS_LOG_INFO("  Average packets received per node: " << std::fixed << std::setprecision(2) << avgReceived);
-	NS_LOG_INFO("  Average different key contributions per node: " << std::fixed << std::setprecision(2) << avgUniqueContributions);
-	NS_LOG_INFO("  Communication overhead ratio (recv/sent): " << std::fixed << std::setprecision(2) << overheadRatio);
+	REGKA_LOG_SUMMARY("Analysis Metrics:");
+	REGKA_LOG_SUMMARY("  Average packets sent per node: " << std::fixed << std::setprecision(2) << avgSent);
+	REGKA_LOG_SUMMARY("  Average packets received per node: " << std::fixed << std::setprecision(2) << avgReceived);
+	REGKA_LOG_SUMMARY("  Average different key contributions per node: " << std::fixed << std::setprecision(2) << avgUniqueContributions);
+	REGKA_LOG_SUMMARY("  Communication overhead ratio (recv/sent): " << std::fixed << std::setprecision(2) << overheadRatio);
 	
-	// Calculate success rate
-	double successRate = (double)successfulNodes / numNodes * 100;
-	NS_LOG_INFO("  Nodes successfully received all packets: " << successfulNodes << "/" << numNodes 
+	// Calculate success rate over the members at the end of the run
+	double successRate = (double)successfulNodes / finalMembers * 100;
+	REGKA_LOG_SUMMARY("  Nodes successfully received all packets: " << successfulNodes << "/" << finalMembers 
 				<< " (" << successRate << "%)");
-	NS_LOG_INFO("----------------------------------------");
+	REGKA_LOG_SUMMARY("----------------------------------------");
     
 	// Key agreement completion delay
 	double keyAgreementDelay = CompletionTime;
-	NS_LOG_INFO("Key agreement completion delay: " << keyAgreementDelay << " seconds");
+	REGKA_LOG_SUMMARY("Key agreement completion delay: " << keyAgreementDelay << " seconds");
+	if (!rekeyResults.empty()) {
+		uint32_t completedRekeys = 0;
+		double rekeyDelay = 0;
+		uint32_t rekeySent = 0;
+		for (uint32_t i = 0; i < rekeyResults.size(); i++) {
+			if (rekeyResults[i].delay > 0) {
+				completedRekeys++;
+				rekeyDelay += rekeyResults[i].delay;
+			}
+			rekeySent += rekeyResults[i].sent;
+		}
+		REGKA_LOG_SUMMARY("Rekeys: " << completedRekeys << "/" << rekeyResults.size() << " completed, average delay " 
+			<< (completedRekeys > 0 ? rekeyDelay / completedRekeys : 0) << " s, " 
+			<< (double)rekeySent / rekeyResults.size() << " packets sent per rekey, " 
+			<< completedRekeys * 60.0 / rekeyDuration << " rekeys per minute");
+	}
+	// Concurrent groups: completion of each, and the message units it needed before packing
+	std::vector<GroupResult> groupResults(groupSpecs.size());
+	for (uint32_t g = 0; g < groupSpecs.size(); g++) {
+		GroupResult& group = groupResults[g];
+		group.id = g;
+		group.members = 0;
+		group.completed = 0;
+		group.units = 0;
+		double lastCompletion = 0;
+		for (uint32_t i = 0; i < numNodes; i++) {
+			group.units += DynamicCast<AppSender>(nodes.Get(i)->GetApplication(0))->GetSentUnits(g);
+			if (!groupSpecs[g][i]) {
+				continue;
+			}
+			double completion = DynamicCast<AppReceiver>(nodes.Get(i)->GetApplication(1))->GetGroupCompletionTime(g);
+			group.members++;
+			group.completed += completion > 0 ? 1 : 0;
+			lastCompletion = std::max(lastCompletion, completion);
+		}
+		group.delay = group.completed == group.members ? lastCompletion - 1 : 0;
+		REGKA_LOG_SUMMARY("Group " << g << ": " << group.completed << "/" << group.members << " members completed, delay " 
+			<< group.delay << " s, " << group.units << " message units");
+	}
+	if (!groupSpecs.empty()) {
+		uint32_t totalUnits = 0;
+		for (uint32_t i = 0; i < numNodes; i++) {
+			totalUnits += DynamicCast<AppSender>(nodes.Get(i)->GetApplication(0))->GetSentUnits();
+		}
+		REGKA_LOG_SUMMARY("Groups: " << totalUnits << " message units in " << totalSent << " packets ("
+			<< (totalUnits > 0 ? 100.0 * (totalUnits - totalSent) / totalUnits : 0) << "% saved by packing)");
+	}
+	REGKA_LOG_SUMMARY("Total energy consumption: " << totalEnergy << " J");
+	OracleResult oracle = OracleBound::Compute(connectivity, OracleBound::GetSetupDelay(numNodes),
+	                                           OracleBound::GetHopTime(numNodes, 12e6));   // phyMode
+	if (oracle.reachable) {
+		REGKA_LOG_SUMMARY("Oracle bounds (links within " << oracleRange << " m): delay >= " << oracle.delay
+			<< " s, transmissions >= " << oracle.transmissions);
+	}
+	// Hot-path timers, only in -DREGKA_PROFILE builds
+	std::vector<ProbeResult> probes = RegkaProfile::GetResults();
+	for (uint32_t i = 0; i < probes.size(); i++) {
+		REGKA_LOG_SUMMARY("Profile " << probes[i].name << ": " << probes[i].calls << " calls, " 
+			<< probes[i].totalNs / 1e6 << " ms, p99 " << probes[i].p99Ns << " ns");
+	}
+	REGKA_LOG_SUMMARY("Simulator: " << perf.events << " events in " << perf.runSeconds << " s, " 
+		<< (perf.runSeconds > 0 ? perf.events / perf.runSeconds : 0) << " events/s, peak RSS " << perf.peakRssKb << " KiB");
+	if (culledLoss != 0) {
+		REGKA_LOG_SUMMARY("Range culling: " << culledLoss->GetCulledCount() << " pairs culled, " 
+			<< culledLoss->GetEvaluatedCount() << " evaluated");
+	}
     
 	// ------------------------------------------------------------
-	// ---------- Output results to local file -------------
+	// ---------- Output results to worker results file -------------
 	// ------------------------------------------------------------
-	Ptr<DataOutputInterface> output = 0;
-	output = CreateObject<SqliteDataOutput>();
-	if (output != 0)
-		output->Output(dataCollector);
-	NS_LOG_INFO("Data successfully written");
-	// ------------- End -----------------
+	RunSummary summary;
+	summary.timestamp = std::time(0);
+	summary.areaLength = areaLength;
+	summary.areaWidth = areaWidth;
+	summary.areaHeight = areaHeight;
+	summary.numNodes = numNodes;
+	summary.linkQuality = linkQuality;
+	summary.strategy = strategy;
+	summary.runId = std::atoi(runId.c_str());
+	summary.rngRun = RngSeedManager::GetRun();
+	summary.keyAgreementDelay = keyAgreementDelay;
+	summary.totalSent = totalSent;
+	summary.totalReceived = totalReceived;
+	summary.overheadRatio = overheadRatio;
+	summary.successRate = successRate;
+	summary.avgUniqueContributions = avgUniqueContributions;
+	summary.successfulNodes = successfulNodes;
 
-	const char* cacheDir = "./results_cache";
-	struct stat st;
-	if (stat(cacheDir, &st) != 0) {
-		mkdir(cacheDir, 0777);
+	ResultsRecord record;
+	record.AddSummary(summary);
+	record.AddNodes(nodeResults);
+	record.AddEnergy(nodeEnergy);
+	if (!rekeyResults.empty()) {
+		record.AddRekeys(rekeyResults, rekeyDuration);
+	}
+	if (connectivity.GetSnapshotCount() > 0) {
+		record.AddOracle(oracle);
+	}
+	if (RegkaProfile::IsEnabled()) {
+		record.AddProfile(probes);
+	}
+	if (!groupResults.empty()) {
+		record.AddGroups(groupResults, totalSent);
+	}
+	SendResult send;
+	send.policy = policy;
+	send.slot = sendSlot;
+	send.slots = sendSlots;
+	send.macRetries = totalMacRetries;
+	send.macDrops = totalMacDrops;
+	record.AddSend(send);
+	VariantResult variant;
+	variant.packetization = packetization ? 1 : 0;
+	variant.packing = packing ? 1 : 0;
+	variant.overhearing = overhearing ? 1 : 0;
+	variant.forwarding = forwarding == "rarest" ? FORWARDING_RAREST_FIRST : FORWARDING_RANDOM;
+	variant.forwardingBudget = forwardingBudget;
+	variant.neighborExpiry = neighborExpiry;
+	variant.minDelivery = minDelivery;
+	variant.maxTargets = maxTargets;
+	variant.rankTargets = rankTargets ? 1 : 0;
+	record.AddVariant(variant);
+	perf.wallSeconds = (RegkaProfile::Now() - experimentStartNs) / 1e9;
+	record.AddPerf(perf);
+	ResultsSink sink(resultsDir, workerId);
+	if (sink.Append(record)) {
+		REGKA_LOG_SUMMARY("Data successfully written to " << sink.GetPath());
+	} else {
+		NS_LOG_ERROR("Unable to write results to " << sink.GetPath());
 	}
-	std::ostringstream cacheFileName;
-	cacheFileName << cacheDir << "/" << areaLength << "*" << areaWidth << "*" << areaHeight << "_" << numNodes << "_" << linkQuality << "_" << runId << ".csv";
-	std::ofstream out(cacheFileName.str(), std::ios::app);
-
-	// Generate timestamp
-	std::time_t now = std::time(nullptr);
-	char buf[32];
-	std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
 
-	// Write one CSV line
-	out << buf << "," << areaLength << "," << areaWidth << "," << areaHeight << "," << numNodes << "," << linkQuality << "," << runId << "," << keyAgreementDelay << "," << totalSent << "," << totalReceived << "," << overheadRatio << "," << successRate << "," << avgUniqueContributions << std::endl;
-	out.close();
+	if (trace != 0) {
+		ResultsRecord traceRecord;
+		traceRecord.AddSummary(summary);
+		trace->AddToRecord(traceRecord);
+		ResultsSink traceSink(resultsDir, workerId, "propagation");
+		if (!traceSink.Append(traceRecord)) {
+			NS_LOG_ERROR("Unable to write propagation trace to " << traceSink.GetPath());
+		}
+		REGKA_LOG_SUMMARY("Propagation trace: " << trace->GetTotalEvents() << " deliveries, " 
+			<< trace->GetRedundantDeliveries() << " redundant");
+		delete trace;
+	}
+	// ------------- End -----------------
 
 	// NS_LOG_INFO("-----------------Simulation ended-------------------");
 	Simulator::Destroy();
 }
 
 int main(int argc, char *argv[]) {
+	experimentStartNs = RegkaProfile::Now();
 	std::string linkQuality = "LOS";  
-	LogComponentEnable("wifi-adhoc-UAV-experiment", LOG_LEVEL_INFO);
-	LogComponentEnable("wifi-adhoc-app", LOG_LEVEL_INFO);
-	
-	const char* logDir = "./Log";
-	struct stat st;
-	if (stat(logDir, &st) != 0) {
-		mkdir(logDir, 0777);
-					NS_LOG_INFO("Created log directory: " << logDir);
+	std::string logLevel = "summary";
+	// Count the executed events; --SimulatorImplementationType still overrides it (no event count then)
+	GlobalValue::Bind("SimulatorImplementationType", StringValue("CountingSimulatorImpl"));
+
+	// Default worker id is the GNU parallel job slot, so every slot appends to its own results file
+	const char* jobSlot = getenv("PARALLEL_JOBSLOT");
+	if (jobSlot != 0) {
+		workerId = std::atoi(jobSlot);
 	}
-	
-	std::ostringstream logFileNameStream;
-	logFileNameStream << logDir << "/simulation_nodes" << numNodes 
-		<< "_area" << (int)areaLength << "*" << (int)areaWidth << "*" << (int)areaHeight
-		<< "_linkQuality" << linkQuality
-		<< "_run" << runId << ".txt";
-	std::string logFileName = logFileNameStream.str();
-	
-			// Redirect log output to file
-	std::ofstream logFile(logFileName.c_str());
-	if (logFile.is_open()) {
-		chmod(logFileName.c_str(), 0666);
-		
-		std::streambuf* originalBuffer = std::clog.rdbuf();
-		std::clog.rdbuf(logFile.rdbuf());
-		std::clog.setf(std::ios::unitbuf);
-		
-		NS_LOG_INFO("=====================================");
-		NS_LOG_INFO("Experiment started: numNodes=" << numNodes << ", areaLength=" << areaLength << ", areaWidth=" << areaWidth << ", areaHeight=" << areaHeight << ", runId=" << runId);
-		NS_LOG_INFO("=====================================");
-		
-		input = numNodes;
-		std::ostringstream ss;
-		ss << "numNodes:" << numNodes << ";areaLength:" << areaLength << ";areaWidth:" << areaWidth << ";areaHeight:" << areaHeight;
-		experiment = ss.str();
+
+	CommandLine cmd;
+	cmd.AddValue("numNodes", "Number of UAVs", numNodes);
+	cmd.AddValue("areaLength", "Length of the activity area (m)", areaLength);
+	cmd.AddValue("areaWidth", "Width of the activity area (m)", areaWidth);
+	cmd.AddValue("areaHeight", "Height of the activity area (m)", areaHeight);
+	cmd.AddValue("linkQuality", "Link quality level (LOS)", linkQuality);
+	cmd.AddValue("run", "Experiment ID", runId);
+	cmd.AddValue("resultsDir", "Directory of the per-worker results files", resultsDir);
+	cmd.AddValue("worker", "Worker id selecting the results file (default: $PARALLEL_JOBSLOT)", workerId);
+	cmd.AddValue("rangeCulling", "Only evaluate the loss chain for node pairs within the maximum range", rangeCulling);
+	cmd.AddValue("maxRange", "Maximum range for range culling (m), 0 derives it from the link budget", maxRange);
+	cmd.AddValue("cullingMargin", "Fading margin added to the link budget of the derived range (dB)", cullingMargin);
+	cmd.AddValue("batteryEnergy", "Initial energy of each UAV's energy source (J)", batteryEnergy);
+	cmd.AddValue("supplyVoltage", "Supply voltage of each UAV's energy source (V)", supplyVoltage);
+	cmd.AddValue("cpuPower", "CPU active power while doing crypto work (W)", cpuPower);
+	cmd.AddValue("logLevel", "Log verbosity: none|summary|detail|dump", logLevel);
+	cmd.AddValue("propagationTrace", "Record the key contribution propagation trace", propagationTrace);
+	cmd.AddValue("mobilityTrace", "Replay this mobility trace instead of the Gauss-Markov model", mobilityTrace);
+	cmd.AddValue("propagationTraceCapacity", "Delivery events kept by the trace ring buffer", propagationTraceCapacity);
+	cmd.AddValue("initialMembers", "Nodes 0..k-1 form the initial group, 0 for every node", initialMembers);
+	cmd.AddValue("membershipEvents", "Membership changes <time>:join|leave:<node>, separated by ';'", membershipEvents);
+	cmd.AddValue("rekeyMode", "Rekey after a membership change: incremental|full", rekeyMode);
+	cmd.AddValue("rekeyInterval", "Rerun the agreement of the current group every this many seconds, 0 for a single agreement", rekeyInterval);
+	cmd.AddValue("simuTime", "Simulated time (s)", simuTime);
+	cmd.AddValue("clusterSize", "Nodes per cluster of a hierarchical agreement (power of two), 0 for one flat group", clusterSize);
+	cmd.AddValue("clusterMode", "Cluster formation: spatial|id", clusterMode);
+	cmd.AddValue("overhearing", "Merge unicasts overheard between other nodes into the local state", overhearing);
+	cmd.AddValue("neighborExpiry", "Neighbors not heard for this long leave the neighbor table (s), 0 for never", neighborExpiry);
+	cmd.AddValue("minDelivery", "Lowest expected delivery ratio of a forwarding target", minDelivery);
+	cmd.AddValue("maxTargets", "Forward to at most this many neighbors, 0 for all", maxTargets);
+	cmd.AddValue("rankTargets", "Forward to the neighbors of best expected delivery first", rankTargets);
+	cmd.AddValue("forwarding", "Contributions forwarded to a neighbor: random|rarest", forwarding);
+	cmd.AddValue("forwardingBudget", "Crypto material bytes of a rarest-first message, 0 for no limit", forwardingBudget);
+	cmd.AddValue("oracleRange", "Link range of the oracle lower bounds (m), 0 derives it from the link budget", oracleRange);
+	cmd.AddValue("packetization", "Split messages into MTU-sized units, false sends whole IP-fragmented messages", packetization);
+	cmd.AddValue("groups", "Concurrent groups <nodes>;<nodes>;..., nodes as IDs and ranges like 0-9,12; empty for one group", groups);
+	cmd.AddValue("packing", "With --groups, send the messages of all groups to a neighbor in shared packets", packing);
+	cmd.AddValue("sendPolicy", "Backoff before every send: fixed|jitter|slotted|density", sendPolicy);
+	cmd.AddValue("sendSlot", "Backoff slot of the send policy (ms)", sendSlot);
+	cmd.AddValue("sendSlots", "Slots jitter and slotted backoff spread over", sendSlots);
+	cmd.Parse(argc, argv);
+
+	if (!ParseRegkaLogLevel(logLevel, g_regkaLogLevel)) {
+		std::cerr << "Unknown --logLevel=" << logLevel << " (expected none|summary|detail|dump)" << std::endl;
+		return 1;
+	}
+
+	if (initialMembers == 0) {
+		initialMembers = numNodes;
+	}
+	if (initialMembers < 2 || initialMembers > numNodes) {
+		NS_FATAL_ERROR("--initialMembers=" << initialMembers << " must be within 2.." << numNodes);
+	}
+	if (rekeyInterval < 0) {
+		NS_FATAL_ERROR("--rekeyInterval=" << rekeyInterval << " must not be negative");
+	}
+	if (rekeyMode != "incremental" && rekeyMode != "full") {
+		NS_FATAL_ERROR("Unknown --rekeyMode=" << rekeyMode << " (expected incremental|full)");
+	}
+	groupMembers.assign(numNodes, false);
+	std::fill(groupMembers.begin(), groupMembers.begin() + initialMembers, true);
+	if (!ParseMembershipEvents(membershipEvents, groupMembers, membershipSchedule)) {
+		NS_FATAL_ERROR("Invalid --membershipEvents=" << membershipEvents);
+	}
+	if (!ParseGroups(groups, numNodes, groupSpecs)) {
+		NS_FATAL_ERROR("Invalid --groups=" << groups);
+	}
+	if (!groupSpecs.empty()) {
+		if (clusterSize > 0 || !membershipSchedule.empty() || initialMembers != numNodes || rekeyInterval > 0) {
+			NS_FATAL_ERROR("--groups does not support --clusterSize, --membershipEvents, --initialMembers or --rekeyInterval");
+		}
+		// Nodes outside every group stay silent and are not counted
+		groupMembers.assign(numNodes, false);
+		for (uint32_t g = 0; g < groupSpecs.size(); g++) {
+			for (uint32_t i = 0; i < numNodes; i++) {
+				groupMembers[i] = groupMembers[i] || groupSpecs[g][i];
+			}
+		}
+	}
+	SendPolicy parsedPolicy;
+	if (!SendScheduler::ParsePolicy(sendPolicy, parsedPolicy)) {
+		NS_FATAL_ERROR("Unknown --sendPolicy=" << sendPolicy << " (expected fixed|jitter|slotted|density)");
+	}
+	if (sendSlot < 0 || sendSlots == 0) {
+		NS_FATAL_ERROR("--sendSlot=" << sendSlot << " must not be negative and --sendSlots=" << sendSlots << " must be positive");
+	}
+	if (neighborExpiry < 0) {
+		NS_FATAL_ERROR("--neighborExpiry=" << neighborExpiry << " must not be negative");
+	}
+	if (minDelivery < 0 || minDelivery > 1) {
+		NS_FATAL_ERROR("--minDelivery=" << minDelivery << " must be within 0..1");
+	}
+	if (forwarding != "random" && forwarding != "rarest") {
+		NS_FATAL_ERROR("Unknown --forwarding=" << forwarding << " (expected random|rarest)");
+	}
+	if (clusterSize > 0) {
+		if (clusterSize < 4 || clusterSize >= numNodes || (clusterSize & (clusterSize - 1)) != 0) {
+			NS_FATAL_ERROR("--clusterSize=" << clusterSize << " must be a power of two within 4.." << numNodes - 1);
+		}
+		if (clusterMode != "spatial" && clusterMode != "id") {
+			NS_FATAL_ERROR("Unknown --clusterMode=" << clusterMode << " (expected spatial|id)");
+		}
+		if (!membershipSchedule.empty() || initialMembers != numNodes) {
+			NS_FATAL_ERROR("--clusterSize does not support --membershipEvents or --initialMembers");
+		}
+	}
+
+	input = numNodes;
+	std::ostringstream ss;
+	ss << "numNodes:" << numNodes << ";areaLength:" << areaLength << ";areaWidth:" << areaWidth << ";areaHeight:" << areaHeight;
+	experiment = ss.str();
+	ss.str("");
+	strategy = "Single Round Communication";
+	if (clusterSize > 0) {
+		ss << "Hierarchical " << clusterSize;
+		strategy = ss.str();
 		ss.str("");
-		strategy = "Single Round Communication";
-		
-		// Run simulation
-		startSimulation(linkQuality);
+	}
+	if (!groupSpecs.empty()) {
+		ss << "Groups " << groupSpecs.size();
+		strategy = ss.str();
+		ss.str("");
+		if (!packing) {
+			strategy += "/nopack";
+		}
+	}
+	if (!packetization) {
+		strategy += "/frag";
+	}
+	if (overhearing) {
+		strategy += "/oh";
+	}
+	if (forwarding == "rarest") {
+		strategy += "/rarest";
+	}
+	if (sendPolicy != "fixed") {
+		strategy += "/" + sendPolicy;
+	}
+	if (neighborExpiry > 0 || minDelivery > 0 || maxTargets > 0 || rankTargets) {
+		strategy += "/nbr";
+	}
 
-		std::clog.flush();
-		NS_LOG_INFO("=====================================");
-		NS_LOG_INFO("Experiment ended");
-		NS_LOG_INFO("=====================================");
-		
+	// No log file at all for --logLevel=none; otherwise the REGKA level decides what is printed
+	std::ofstream logFile;
+	std::streambuf* originalBuffer = std::clog.rdbuf();
+	std::string logFileName;
+	if (g_regkaLogLevel > REGKA_LEVEL_NONE) {
+		LogComponentEnable("wifi-adhoc-UAV-experiment", LOG_LEVEL_INFO);
+		LogComponentEnable("wifi-adhoc-app", LOG_LEVEL_INFO);
+
+		const char* logDir = "./Log";
+		struct stat st;
+		if (stat(logDir, &st) != 0) {
+			mkdir(logDir, 0777);
+		}
+
+		std::ostringstream logFileNameStream;
+		logFileNameStream << logDir << "/simulation_nodes" << numNodes 
+			<< "_area" << (int)areaLength << "*" << (int)areaWidth << "*" << (int)areaHeight
+			<< "_linkQuality" << linkQuality
+			<< "_run" << runId << ".txt";
+		logFileName = logFileNameStream.str();
+
+		// Redirect log output to file (fully buffered, flushed when the run ends)
+		logFile.open(logFileName.c_str());
+		if (logFile.is_open()) {
+			chmod(logFileName.c_str(), 0666);
+			std::clog.rdbuf(logFile.rdbuf());
+		} else {
+			NS_LOG_ERROR("Unable to create log file: " << logFileName);
+		}
+	}
+
+	REGKA_LOG_SUMMARY("=====================================");
+	REGKA_LOG_SUMMARY("Experiment started: numNodes=" << numNodes << ", areaLength=" << areaLength << ", areaWidth=" << areaWidth << ", areaHeight=" << areaHeight << ", runId=" << runId);
+	REGKA_LOG_SUMMARY("=====================================");
+
+	// Run simulation
+	startSimulation(linkQuality);
+
+	REGKA_LOG_SUMMARY("=====================================");
+	REGKA_LOG_SUMMARY("Experiment ended");
+	REGKA_LOG_SUMMARY("=====================================");
+
+	if (logFile.is_open()) {
 		// Restore original output
+		std::clog.flush();
 		std::clog.rdbuf(originalBuffer);
 		logFile.close();
-		
 		std::cout << "Log saved to: " << logFileName << std::endl;
-	} else {
-		NS_LOG_ERROR("Unable to create log file: " << logFileName);
 	}
     std::cout << areaLength << "*" << areaWidth << "*" << areaHeight << "_" << numNodes << "_" << linkQuality << "_" << runId << " Success" << std::endl;
     return 0;
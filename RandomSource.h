@@ -0,0 +1,18 @@
+#ifndef RANDOM_SOURCE_H
+#define RANDOM_SOURCE_H
+
+/**
+ * Uniform random numbers for the protocol's forwarding decisions. Keeps
+ * KeyMatrix independent of ns-3: the simulation plugs in a per-node
+ * RandomVariableStream, the standalone tools their own generator.
+ */
+class RandomSource
+{
+public:
+  virtual ~RandomSource() {}
+
+  // Uniform in [0, 1]
+  virtual double GetUniform() = 0;
+};
+
+#endif /* RANDOM_SOURCE_H */
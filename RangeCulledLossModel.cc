@@ -0,0 +1,120 @@
+#include "RangeCulledLossModel.h"
+#include <cmath>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("range-culled-loss");
+
+const double RangeCulledPropagationLossModel::CULLED_RX_POWER_DBM = -1000.0;
+
+TypeId RangeCulledPropagationLossModel::GetTypeId(void) {
+	static TypeId tid =
+			TypeId("RangeCulledPropagationLossModel").SetParent<PropagationLossModel>()
+					.AddConstructor<RangeCulledPropagationLossModel>()
+					.AddAttribute("MaxRange", "Pairs farther apart than this are not evaluated (m).",
+							DoubleValue(1000.0),
+							MakeDoubleAccessor(&RangeCulledPropagationLossModel::m_maxRange),
+							MakeDoubleChecker<double>(0.0))
+					.AddAttribute("MaxSpeed", "Maximum node speed, pads the reach between grid refreshes (m/s).",
+							DoubleValue(50.0),
+							MakeDoubleAccessor(&RangeCulledPropagationLossModel::m_maxSpeed),
+							MakeDoubleChecker<double>(0.0));
+	return tid;
+}
+
+RangeCulledPropagationLossModel::RangeCulledPropagationLossModel() {
+	m_maxRange = 1000.0;
+	m_maxSpeed = 50.0;
+	m_culled = 0;
+	m_evaluated = 0;
+}
+
+RangeCulledPropagationLossModel::~RangeCulledPropagationLossModel() {}
+
+void RangeCulledPropagationLossModel::DoDispose(void) {
+	Simulator::Cancel(m_refreshEvent);
+	m_inner = 0;
+	m_nodes = NodeContainer();
+	PropagationLossModel::DoDispose();
+}
+
+void RangeCulledPropagationLossModel::SetInnerModel(Ptr<PropagationLossModel> inner) {
+	m_inner = inner;
+}
+
+void RangeCulledPropagationLossModel::Track(NodeContainer nodes, Time refreshInterval) {
+	m_nodes = nodes;
+	m_refreshInterval = refreshInterval;
+	m_index.clear();
+	for (uint32_t i = 0; i < m_nodes.GetN(); i++) {
+		m_index[PeekPointer(m_nodes.Get(i)->GetObject<MobilityModel>())] = i;
+	}
+	Refresh();
+}
+
+double RangeCulledPropagationLossModel::MaxRangeFromLinkBudget(double txPowerDbm, double gainsDb,
+		double thresholdDbm, double marginDb, double referenceLossDb, double exponent) {
+	double allowedLossDb = txPowerDbm + gainsDb - (thresholdDbm - marginDb) - referenceLossDb;
+	return std::pow(10.0, allowedLossDb / (10.0 * exponent));
+}
+
+// Rebuild the grid and the in-reach pair table from the current positions
+void RangeCulledPropagationLossModel::Refresh() {
+	uint32_t n = m_nodes.GetN();
+	// A pair may close in by 2 * maxSpeed * interval before the next refresh
+	double reach = m_maxRange + 2 * m_maxSpeed * m_refreshInterval.GetSeconds();
+
+	std::vector<Vector> positions(n);
+	std::vector<int64_t> cellX(n), cellY(n), cellZ(n);
+	std::map<int64_t, std::vector<uint32_t> > cells;
+	for (uint32_t i = 0; i < n; i++) {
+		positions[i] = m_nodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
+		cellX[i] = static_cast<int64_t>(std::floor(positions[i].x / reach));
+		cellY[i] = static_cast<int64_t>(std::floor(positions[i].y / reach));
+		cellZ[i] = static_cast<int64_t>(std::floor(positions[i].z / reach));
+		// 21 bits per axis, offset to keep negative cells distinct
+		int64_t key = ((cellX[i] + (1 << 20)) << 42) | ((cellY[i] + (1 << 20)) << 21) | (cellZ[i] + (1 << 20));
+		cells[key].push_back(i);
+	}
+
+	m_inReach.assign(n * n, false);
+	for (uint32_t i = 0; i < n; i++) {
+		for (int64_t dx = -1; dx <= 1; dx++) {
+			for (int64_t dy = -1; dy <= 1; dy++) {
+				for (int64_t dz = -1; dz <= 1; dz++) {
+					int64_t key = ((cellX[i] + dx + (1 << 20)) << 42) | ((cellY[i] + dy + (1 << 20)) << 21)
+							| (cellZ[i] + dz + (1 << 20));
+					std::map<int64_t, std::vector<uint32_t> >::const_iterator cell = cells.find(key);
+					if (cell == cells.end()) {
+						continue;
+					}
+					for (uint32_t k = 0; k < cell->second.size(); k++) {
+						uint32_t j = cell->second[k];
+						if (CalculateDistance(positions[i], positions[j]) <= reach) {
+							m_inReach[i * n + j] = true;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	m_refreshEvent = Simulator::Schedule(m_refreshInterval, &RangeCulledPropagationLossModel::Refresh, this);
+}
+
+double RangeCulledPropagationLossModel::DoCalcRxPower(double txPowerDbm, Ptr<MobilityModel> a,
+		Ptr<MobilityModel> b) const {
+	std::map<const MobilityModel*, uint32_t>::const_iterator tx = m_index.find(PeekPointer(a));
+	std::map<const MobilityModel*, uint32_t>::const_iterator rx = m_index.find(PeekPointer(b));
+	if (tx != m_index.end() && rx != m_index.end()
+			&& !m_inReach[tx->second * m_nodes.GetN() + rx->second]) {
+		m_culled++;
+		return CULLED_RX_POWER_DBM;
+	}
+	m_evaluated++;
+	return m_inner->CalcRxPower(txPowerDbm, a, b);
+}
+
+int64_t RangeCulledPropagationLossModel::DoAssignStreams(int64_t stream) {
+	return m_inner->AssignStreams(stream);
+}
@@ -0,0 +1,61 @@
+#ifndef RANGE_CULLED_LOSS_MODEL_H
+#define RANGE_CULLED_LOSS_MODEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-module.h"
+#include <map>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Propagation loss model that only evaluates its inner loss chain for node
+ * pairs within a maximum range. Node positions are kept in a 3-D uniform grid
+ * (cell size = reach) that is rebuilt every refresh interval (the Gauss-Markov
+ * TimeStep); each rebuild marks the in-reach pairs by scanning the 27
+ * neighbouring cells only, so it costs O(N x local density). Per transmission
+ * an out-of-range pair costs one table lookup instead of the LogDistance,
+ * Random and Nakagami evaluations, and gets an rx power far below any
+ * detection threshold.
+ */
+class RangeCulledPropagationLossModel: public PropagationLossModel {
+public:
+	static TypeId GetTypeId(void);
+	RangeCulledPropagationLossModel();
+	virtual ~RangeCulledPropagationLossModel();
+
+	void SetInnerModel(Ptr<PropagationLossModel> inner); // Loss chain evaluated for in-range pairs
+	void Track(NodeContainer nodes, Time refreshInterval); // Start the periodic grid refresh
+
+	// Distance at which the mean received power drops below thresholdDbm - marginDb (log-distance path loss)
+	static double MaxRangeFromLinkBudget(double txPowerDbm, double gainsDb, double thresholdDbm,
+			double marginDb, double referenceLossDb, double exponent);
+
+	uint64_t GetCulledCount() const { return m_culled; }
+	uint64_t GetEvaluatedCount() const { return m_evaluated; }
+
+	static const double CULLED_RX_POWER_DBM;
+
+protected:
+	virtual void DoDispose(void);
+
+private:
+	virtual double DoCalcRxPower(double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
+	virtual int64_t DoAssignStreams(int64_t stream);
+	void Refresh();
+
+	Ptr<PropagationLossModel> m_inner;	// Inner loss chain
+	double m_maxRange;				// Maximum range (m)
+	double m_maxSpeed;				// Maximum node speed (m/s), pads the reach between refreshes
+	Time m_refreshInterval;			// Grid refresh interval
+	NodeContainer m_nodes;			// Tracked nodes
+	std::map<const MobilityModel*, uint32_t> m_index;	// Mobility model -> tracked node index
+	std::vector<bool> m_inReach;	// [tx * N + rx], pairs within reach at the last refresh
+	EventId m_refreshEvent;			// Next refresh
+	mutable uint64_t m_culled;		// Pairs culled
+	mutable uint64_t m_evaluated;	// Pairs passed to the inner chain
+};
+
+#endif /* RANGE_CULLED_LOSS_MODEL_H */
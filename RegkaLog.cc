@@ -0,0 +1,20 @@
+#include "RegkaLog.h"
+
+RegkaLogLevel g_regkaLogLevel = REGKA_LEVEL_SUMMARY;
+
+// Map a --logLevel value (none|summary|detail|dump) to its level
+bool ParseRegkaLogLevel(const std::string& name, RegkaLogLevel& level)
+{
+  if (name == "none") {
+    level = REGKA_LEVEL_NONE;
+  } else if (name == "summary") {
+    level = REGKA_LEVEL_SUMMARY;
+  } else if (name == "detail") {
+    level = REGKA_LEVEL_DETAIL;
+  } else if (name == "dump") {
+    level = REGKA_LEVEL_DUMP;
+  } else {
+    return false;
+  }
+  return true;
+}
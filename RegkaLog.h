@@ -0,0 +1,42 @@
+#ifndef REGKA_LOG_H
+#define REGKA_LOG_H
+
+#include "ns3/log.h"
+#include <string>
+
+/**
+ * Verbosity of the simulation log, selected with --logLevel
+ */
+enum RegkaLogLevel
+{
+  REGKA_LEVEL_NONE = 0,      ///< No log file at all
+  REGKA_LEVEL_SUMMARY = 1,   ///< Run start/end and end-of-run statistics (sweep default)
+  REGKA_LEVEL_DETAIL = 2,    ///< Per-packet and per-node events
+  REGKA_LEVEL_DUMP = 3       ///< Per-packet contribution strings and KeyMatrix dumps
+};
+
+/**
+ * Build switch: levels above REGKA_LOG_MAX_LEVEL are compiled out, e.g.
+ * CXXFLAGS="-DREGKA_LOG_MAX_LEVEL=1" removes every per-packet log statement.
+ */
+#ifndef REGKA_LOG_MAX_LEVEL
+#define REGKA_LOG_MAX_LEVEL 3
+#endif
+
+extern RegkaLogLevel g_regkaLogLevel;
+
+bool ParseRegkaLogLevel(const std::string& name, RegkaLogLevel& level);
+
+// The message is only evaluated when the level is compiled in and active
+#define REGKA_LOG(level, msg)                                           \
+  do {                                                                  \
+    if (REGKA_LOG_MAX_LEVEL >= (level) && g_regkaLogLevel >= (level)) { \
+      NS_LOG_INFO(msg);                                                 \
+    }                                                                   \
+  } while (false)
+
+#define REGKA_LOG_SUMMARY(msg) REGKA_LOG(REGKA_LEVEL_SUMMARY, msg)
+#define REGKA_LOG_DETAIL(msg) REGKA_LOG(REGKA_LEVEL_DETAIL, msg)
+#define REGKA_LOG_DUMP(msg) REGKA_LOG(REGKA_LEVEL_DUMP, msg)
+
+#endif /* REGKA_LOG_H */
@@ -0,0 +1,118 @@
+#include "RegkaProfile.h"
+#include <sys/resource.h>
+#include <time.h>
+
+namespace {
+
+// Log-linear buckets: values below 8 ns exactly, then 8 per power of two
+const uint32_t SUB_BUCKETS = 8;
+const uint32_t BUCKETS = 64 * SUB_BUCKETS;
+
+const char* const g_probeNames[REGKA_PROBE_COUNT] = {
+  "Receive",
+  "HandleMessage",
+  "GetSnapshot",
+  "DoSendPacket",
+  "KeyMatrix::Merge",
+  "KeyMatrix::Forwarding",
+  "KeyMatrix::MatrixToString",
+  "KeyGenerationTree::Merge",
+  "KeyGenerationTree::Forwarding",
+  "Simulator::Run"
+};
+
+// Plain data, so it can live in thread-local storage
+struct ProbeState
+{
+  uint64_t calls;
+  uint64_t totalNs;
+  uint32_t buckets[BUCKETS];
+};
+
+__thread ProbeState g_probes[REGKA_PROBE_COUNT];
+
+uint32_t BucketOf(uint64_t ns) {
+  if (ns < SUB_BUCKETS) {
+    return ns;
+  }
+  uint32_t exponent = 63 - __builtin_clzll(ns);
+  uint32_t sub = (ns >> (exponent - 3)) & (SUB_BUCKETS - 1);
+  return (exponent - 2) * SUB_BUCKETS + sub;
+}
+
+uint64_t BucketUpperEdge(uint32_t bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  uint32_t exponent = bucket / SUB_BUCKETS + 2;
+  uint64_t sub = bucket % SUB_BUCKETS;
+  return ((SUB_BUCKETS + sub + 1) << (exponent - 3)) - 1;
+}
+
+}
+
+bool RegkaProfile::IsEnabled() {
+#ifdef REGKA_PROFILE
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint64_t RegkaProfile::Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t RegkaProfile::GetPeakRssKb() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return usage.ru_maxrss;   // KiB on Linux
+}
+
+void RegkaProfile::Record(RegkaProbe probe, uint64_t ns) {
+  ProbeState& state = g_probes[probe];
+  state.calls++;
+  state.totalNs += ns;
+  state.buckets[BucketOf(ns)]++;
+}
+
+std::vector<ProbeResult> RegkaProfile::GetResults() {
+  std::vector<ProbeResult> results;
+  for (uint32_t p = 0; p < REGKA_PROBE_COUNT; p++) {
+    const ProbeState& state = g_probes[p];
+    if (state.calls == 0) {
+      continue;
+    }
+    ProbeResult result;
+    result.name = g_probeNames[p];
+    result.calls = state.calls;
+    result.totalNs = state.totalNs;
+    result.p99Ns = 0;
+    // Smallest bucket with at least 99 % of the calls at or below it
+    uint64_t rank = (state.calls * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < BUCKETS; b++) {
+      seen += state.buckets[b];
+      if (seen >= rank) {
+        result.p99Ns = BucketUpperEdge(b);
+        break;
+      }
+    }
+    results.push_back(result);
+  }
+  return results;
+}
+
+void RegkaProfile::Reset() {
+  for (uint32_t p = 0; p < REGKA_PROBE_COUNT; p++) {
+    g_probes[p].calls = 0;
+    g_probes[p].totalNs = 0;
+    for (uint32_t b = 0; b < BUCKETS; b++) {
+      g_probes[p].buckets[b] = 0;
+    }
+  }
+}
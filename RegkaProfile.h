@@ -0,0 +1,77 @@
+#ifndef REGKA_PROFILE_H
+#define REGKA_PROFILE_H
+
+#include "ResultsSink.h"
+#include <vector>
+#include <stdint.h>
+
+/**
+ * Protocol hot paths timed by REGKA_PROFILE_SCOPE. Times are inclusive, so
+ * HandleMessage contains the KeyMatrix calls it makes.
+ */
+enum RegkaProbe
+{
+  PROBE_RECEIVE = 0,          ///< AppReceiver::Receive, socket read and message parsing
+  PROBE_HANDLE_MESSAGE,       ///< AppReceiver::HandleMessage, merging and forwarding
+  PROBE_BUILD_MESSAGE,        ///< AppReceiver::GetSnapshot when it serialises a new state version
+  PROBE_SEND,                 ///< AppSender::DoSendPacket, packetization and socket sends
+  PROBE_MATRIX_MERGE,         ///< KeyMatrix::MergeMatrix and MergeRows
+  PROBE_MATRIX_FORWARDING,    ///< KeyMatrix::GetForwardingContributions and GetRarestContributions
+  PROBE_MATRIX_TO_STRING,     ///< KeyMatrix::MatrixToString
+  PROBE_TREE_MERGE,           ///< KeyGenerationTree::AddMultipleContributions and MergeTree
+  PROBE_TREE_FORWARDING,      ///< KeyGenerationTree::GetForwardingContributions
+  PROBE_SIMULATOR_RUN,        ///< Simulator::Run, ns-3 included: the rest is the simulator's
+  REGKA_PROBE_COUNT
+};
+
+/**
+ * Calls, total and p99 time of every probe on the calling thread. Each
+ * probe keeps a log-linear histogram (8 buckets per power of two), so the
+ * p99 is the upper edge of its bucket, at most 12.5 % above the true value.
+ */
+class RegkaProfile
+{
+public:
+  // Whether the build has the timers (-DREGKA_PROFILE)
+  static bool IsEnabled();
+
+  static void Record(RegkaProbe probe, uint64_t ns);
+  static uint64_t Now();   // Monotonic clock (ns)
+  // Peak resident set size of the process (KiB), never decreases; always available
+  static uint64_t GetPeakRssKb();
+
+  // Probes called since the last Reset, in probe order
+  static std::vector<ProbeResult> GetResults();
+  static void Reset();
+};
+
+/**
+ * Build switch: -DREGKA_PROFILE compiles the scoped timers in. Without it
+ * REGKA_PROFILE_SCOPE expands to nothing and no clock is ever read.
+ */
+#ifdef REGKA_PROFILE
+
+class RegkaProfileScope
+{
+public:
+  explicit RegkaProfileScope(RegkaProbe probe) : m_probe(probe), m_start(RegkaProfile::Now()) {}
+  ~RegkaProfileScope() { RegkaProfile::Record(m_probe, RegkaProfile::Now() - m_start); }
+
+private:
+  RegkaProfileScope(const RegkaProfileScope&);
+  RegkaProfileScope& operator=(const RegkaProfileScope&);
+
+  RegkaProbe m_probe;
+  uint64_t m_start;
+};
+
+// Times the rest of the enclosing scope; one per scope
+#define REGKA_PROFILE_SCOPE(probe) RegkaProfileScope regkaProfileScope(probe)
+
+#else
+
+#define REGKA_PROFILE_SCOPE(probe) do { } while (false)
+
+#endif
+
+#endif /* REGKA_PROFILE_H */
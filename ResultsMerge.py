@@ -0,0 +1,310 @@
+import glob
+import os
+import struct
+import sys
+from datetime import datetime
+
+# Binary results record layout written by ResultsSink.cc:
+#   record header : u32 magic, u16 version, u16 section count, u32 payload bytes
+#   each section  : u16 tag, u16 reserved, u32 length, <length bytes>
+RECORD_MAGIC = 0x524b4752
+RECORD_HEADER = struct.Struct("<IHHI")
+SECTION_HEADER = struct.Struct("<HHI")
+
+SECTION_SUMMARY = 1
+SECTION_NODES = 2
+SECTION_ENERGY = 5
+SECTION_REKEY = 6
+SECTION_ORACLE = 7
+SECTION_PROFILE = 8
+SECTION_PERF = 9
+SECTION_GROUPS = 10
+SECTION_SEND = 11
+SECTION_VARIANT = 12
+
+# Version 1 stored the strategy in char[32], version 2 as u16 length + bytes between the same fields
+SUMMARY_HEAD_LAYOUT = struct.Struct("<qdddI16s")
+SUMMARY_HEAD_FIELDS = ['timestamp', 'areaLength', 'areaWidth', 'areaHeight', 'numNodes', 'linkQuality']
+SUMMARY_TAIL_LAYOUT = struct.Struct("<IQdIIdddI")
+SUMMARY_TAIL_FIELDS = [
+    'runId', 'rngRun', 'keyAgreementDelay', 'totalSent', 'totalReceived',
+    'overheadRatio', 'successRate', 'avgUniqueContributions', 'successfulNodes'
+]
+NODE_LAYOUT = struct.Struct("<IIII")
+NODE_FIELDS = ['sent', 'received', 'contributions', 'completed']
+ENERGY_NODE_LAYOUT = struct.Struct("<ddd")
+ENERGY_NODE_FIELDS = ['radioEnergy', 'cpuEnergy', 'remainingEnergy']
+REKEY_LAYOUT = struct.Struct("<dIIIIIIdII")
+ORACLE_LAYOUT = struct.Struct("<dII")
+PROBE_LAYOUT = struct.Struct("<32sQQQ")
+PROBE_FIELDS = ['probe', 'calls', 'totalNs', 'p99Ns']
+PERF_LAYOUT = struct.Struct("<ddQQ")
+PERF_FIELDS = ['wallSeconds', 'runSeconds', 'events', 'peakRssKb']
+SEND_LAYOUT = struct.Struct("<IdIII")
+SEND_FIELDS = ['sendPolicy', 'sendSlot', 'sendSlots', 'macRetries', 'macDrops']
+GROUP_LAYOUT = struct.Struct("<IIIdI")
+GROUP_FIELDS = ['group', 'members', 'completed', 'delay', 'units']
+VARIANT_LAYOUT = struct.Struct("<IIIIIddII")
+VARIANT_FIELDS = ['packetization', 'packing', 'overhearing', 'forwarding', 'forwardingBudget',
+                  'neighborExpiry', 'minDelivery', 'maxTargets', 'rankTargets']
+REKEY_FIELDS = ['time', 'kind', 'node', 'sponsor', 'members', 'full', 'recomputed', 'delay', 'sent', 'received']
+
+# Column order of the run-level CSV view (first 13 columns match the old per-run CSV lines)
+RESULT_COLUMNS = [
+    'timestamp', 'areaLength', 'areaWidth', 'areaHeight', 'numNodes', 'linkQuality',
+    'runId', 'keyAgreementDelay', 'totalSent', 'totalReceived', 'overheadRatio', 'successRate',
+    'avgUniqueContributions', 'successfulNodes', 'strategy', 'rngRun',
+    'totalRadioEnergy', 'totalCpuEnergy', 'totalEnergy',
+    'oracleDelay', 'oracleTransmissions', 'delayEfficiency', 'txEfficiency'
+] + PERF_FIELDS + ['eventsPerSecond', 'groupUnits', 'multiplexSaving'] + SEND_FIELDS + VARIANT_FIELDS
+NODE_COLUMNS = ['areaLength', 'areaWidth', 'areaHeight', 'numNodes', 'linkQuality', 'runId', 'nodeId'] + NODE_FIELDS + ENERGY_NODE_FIELDS
+REKEY_COLUMNS = ['areaLength', 'areaWidth', 'areaHeight', 'numNodes', 'linkQuality', 'runId', 'rngRun',
+                 'rekeyDuration', 'event'] + REKEY_FIELDS
+PROFILE_COLUMNS = ['areaLength', 'areaWidth', 'areaHeight', 'numNodes', 'linkQuality', 'runId', 'rngRun',
+                   'strategy'] + PROBE_FIELDS + ['meanNs']
+GROUP_COLUMNS = ['areaLength', 'areaWidth', 'areaHeight', 'numNodes', 'linkQuality', 'runId', 'rngRun',
+                 'strategy'] + GROUP_FIELDS
+REKEY_KINDS = {0: 'leave', 1: 'join', 2: 'periodic'}
+SEND_POLICIES = {0: 'fixed', 1: 'jitter', 2: 'slotted', 3: 'density'}
+FORWARDING_RULES = {0: 'random', 1: 'rarest'}
+
+
+def _decode_string(raw):
+    return raw.split(b'\0', 1)[0].decode('ascii', 'replace')
+
+
+def _decode_summary(payload, version):
+    summary = dict(zip(SUMMARY_HEAD_FIELDS, SUMMARY_HEAD_LAYOUT.unpack_from(payload)))
+    pos = SUMMARY_HEAD_LAYOUT.size
+    if version < 2:
+        summary['strategy'] = _decode_string(payload[pos:pos + 32])
+        pos += 32
+    else:
+        length = struct.unpack_from("<H", payload, pos)[0]
+        summary['strategy'] = payload[pos + 2:pos + 2 + length].decode('ascii', 'replace')
+        pos += 2 + length
+    summary.update(zip(SUMMARY_TAIL_FIELDS, SUMMARY_TAIL_LAYOUT.unpack_from(payload, pos)))
+    summary['linkQuality'] = _decode_string(summary['linkQuality'])
+    summary['timestamp'] = datetime.fromtimestamp(summary['timestamp']).strftime("%Y-%m-%d %H:%M:%S")
+    return summary
+
+
+def _decode_nodes(payload):
+    count = struct.unpack_from("<I", payload)[0]
+    nodes = []
+    for i in range(count):
+        values = NODE_LAYOUT.unpack_from(payload, 4 + i * NODE_LAYOUT.size)
+        nodes.append(dict(zip(NODE_FIELDS, values)))
+    return nodes
+
+
+def _decode_energy(payload):
+    radio, cpu, count = struct.unpack_from("<ddI", payload)
+    nodes = []
+    for i in range(count):
+        values = ENERGY_NODE_LAYOUT.unpack_from(payload, 20 + i * ENERGY_NODE_LAYOUT.size)
+        nodes.append(dict(zip(ENERGY_NODE_FIELDS, values)))
+    return {'totalRadioEnergy': radio, 'totalCpuEnergy': cpu, 'totalEnergy': radio + cpu, 'nodes': nodes}
+
+
+def _decode_rekeys(payload):
+    duration, count = struct.unpack_from("<dI", payload)
+    rekeys = []
+    for i in range(count):
+        rekey = dict(zip(REKEY_FIELDS, REKEY_LAYOUT.unpack_from(payload, 12 + i * REKEY_LAYOUT.size)))
+        rekey['kind'] = REKEY_KINDS.get(rekey['kind'], rekey['kind'])
+        rekeys.append(rekey)
+    return {'duration': duration, 'events': rekeys}
+
+
+def _decode_oracle(payload):
+    delay, transmissions, reachable = ORACLE_LAYOUT.unpack_from(payload)
+    return {'delay': delay, 'transmissions': transmissions, 'reachable': reachable}
+
+
+def _decode_profile(payload):
+    count = struct.unpack_from("<I", payload)[0]
+    probes = []
+    for i in range(count):
+        probe = dict(zip(PROBE_FIELDS, PROBE_LAYOUT.unpack_from(payload, 4 + i * PROBE_LAYOUT.size)))
+        probe['probe'] = _decode_string(probe['probe'])
+        probe['meanNs'] = float(probe['totalNs']) / probe['calls'] if probe['calls'] else 0.0
+        probes.append(probe)
+    return probes
+
+
+def _decode_perf(payload):
+    perf = dict(zip(PERF_FIELDS, PERF_LAYOUT.unpack_from(payload)))
+    perf['eventsPerSecond'] = perf['events'] / perf['runSeconds'] if perf['runSeconds'] > 0 else 0.0
+    return perf
+
+
+def _decode_groups(payload):
+    datagrams, count = struct.unpack_from("<II", payload)
+    groups = [dict(zip(GROUP_FIELDS, GROUP_LAYOUT.unpack_from(payload, 8 + i * GROUP_LAYOUT.size)))
+              for i in range(count)]
+    return {'datagrams': datagrams, 'groups': groups}
+
+
+def _decode_send(payload):
+    send = dict(zip(SEND_FIELDS, SEND_LAYOUT.unpack_from(payload)))
+    send['sendPolicy'] = SEND_POLICIES.get(send['sendPolicy'], send['sendPolicy'])
+    return send
+
+
+def _decode_variant(payload):
+    variant = dict(zip(VARIANT_FIELDS, VARIANT_LAYOUT.unpack_from(payload)))
+    variant['forwarding'] = FORWARDING_RULES.get(variant['forwarding'], variant['forwarding'])
+    return variant
+
+
+SECTION_DECODERS = {
+    SECTION_NODES: ('nodes', _decode_nodes),
+    SECTION_ENERGY: ('energy', _decode_energy),
+    SECTION_REKEY: ('rekeys', _decode_rekeys),
+    SECTION_ORACLE: ('oracle', _decode_oracle),
+    SECTION_PROFILE: ('profile', _decode_profile),
+    SECTION_PERF: ('perf', _decode_perf),
+    SECTION_GROUPS: ('groups', _decode_groups),
+    SECTION_SEND: ('send', _decode_send),
+    SECTION_VARIANT: ('variant', _decode_variant),
+}
+
+
+def read_records(path, offset=0, decoders=None):
+    """Yield (record, end offset) for every complete record of a worker file from offset on.
+
+    decoders maps extra section tags to (record key, decode function)."""
+    section_decoders = dict(SECTION_DECODERS)
+    if decoders:
+        section_decoders.update(decoders)
+    with open(path, "rb") as fin:
+        fin.seek(offset)
+        while True:
+            header = fin.read(RECORD_HEADER.size)
+            if len(header) < RECORD_HEADER.size:
+                return
+            magic, version, section_count, length = RECORD_HEADER.unpack(header)
+            if magic != RECORD_MAGIC:
+                raise ValueError("Bad record magic in %s at offset %d" % (path, offset))
+            body = fin.read(length)
+            if len(body) < length:
+                return  # record still being written
+            offset += RECORD_HEADER.size + length
+            record = {}
+            pos = 0
+            for _ in range(section_count):
+                tag, _reserved, section_length = SECTION_HEADER.unpack_from(body, pos)
+                payload = body[pos + SECTION_HEADER.size:pos + SECTION_HEADER.size + section_length]
+                pos += SECTION_HEADER.size + section_length
+                if tag == SECTION_SUMMARY:
+                    record.update(_decode_summary(payload, version))
+                elif tag in section_decoders:
+                    name, decoder = section_decoders[tag]
+                    record[name] = decoder(payload)
+            # Scalar energy totals are plain columns; per-node energy joins the node rows
+            energy = record.pop('energy', None)
+            if energy is not None:
+                for key in ('totalRadioEnergy', 'totalCpuEnergy', 'totalEnergy'):
+                    record[key] = energy[key]
+                for node, node_energy in zip(record.get('nodes', []), energy['nodes']):
+                    node.update(node_energy)
+            # Efficiency vs oracle: lower bound over achieved, 1 is optimal; empty when either is undefined
+            oracle = record.pop('oracle', None)
+            if oracle is not None and oracle['reachable']:
+                record['oracleDelay'] = oracle['delay']
+                record['oracleTransmissions'] = oracle['transmissions']
+                if record.get('keyAgreementDelay', 0) > 0:
+                    record['delayEfficiency'] = oracle['delay'] / record['keyAgreementDelay']
+                if record.get('totalSent', 0) > 0:
+                    record['txEfficiency'] = float(oracle['transmissions']) / record['totalSent']
+            # Simulator cost, send policy and protocol options are plain columns too
+            record.update(record.pop('perf', {}))
+            record.update(record.pop('send', {}))
+            record.update(record.pop('variant', {}))
+            # Concurrent groups: units needed by all groups, and the share packing saved of them
+            groups = record.pop('groups', None)
+            if groups is not None:
+                record['groups'] = groups['groups']
+                record['groupUnits'] = sum(group['units'] for group in groups['groups'])
+                if record['groupUnits'] > 0:
+                    record['multiplexSaving'] = 1 - float(groups['datagrams']) / record['groupUnits']
+            yield record, offset
+
+
+def _format(value):
+    if isinstance(value, float):
+        return "%.10g" % value
+    return str(value)
+
+
+def merge_results(cache_dir="results_cache", remove=True, prefix="worker"):
+    """Merge all <prefix>_*.bin files into {timestamp}_Result.csv and {timestamp}_Nodes.csv,
+    plus {timestamp}_Rekey.csv when runs had membership changes or periodic rekeys,
+    {timestamp}_Groups.csv when runs had concurrent groups and
+    {timestamp}_Profile.csv when runs came from a -DREGKA_PROFILE build"""
+    input_files = sorted(glob.glob(os.path.join(cache_dir, prefix + "_*.bin")))
+    timestamp = datetime.now().strftime("%Y%m%d%H%M%S")
+    output_file = timestamp + "_Result.csv"
+    nodes_file = timestamp + "_Nodes.csv"
+    rekey_file = timestamp + "_Rekey.csv"
+    profile_file = timestamp + "_Profile.csv"
+    groups_file = timestamp + "_Groups.csv"
+    frekey = None
+    fgroups = None
+    fprofile = None
+
+    count = 0
+    with open(output_file, "w") as fout, open(nodes_file, "w") as fnodes:
+        fout.write(",".join(RESULT_COLUMNS) + "\n")
+        fnodes.write(",".join(NODE_COLUMNS) + "\n")
+        for fname in input_files:
+            for record, _ in read_records(fname):
+                fout.write(",".join(_format(record.get(c, "")) for c in RESULT_COLUMNS) + "\n")
+                for node_id, node in enumerate(record.get('nodes', [])):
+                    row = [record[c] for c in NODE_COLUMNS[:6]] + [node_id] + [node.get(c, "") for c in NODE_COLUMNS[7:]]
+                    fnodes.write(",".join(_format(v) for v in row) + "\n")
+                rekeys = record.get('rekeys', {'events': []})
+                for event, rekey in enumerate(rekeys['events']):
+                    if frekey is None:
+                        frekey = open(rekey_file, "w")
+                        frekey.write(",".join(REKEY_COLUMNS) + "\n")
+                    row = ([record[c] for c in REKEY_COLUMNS[:7]] + [rekeys['duration'], event] +
+                           [rekey[c] for c in REKEY_FIELDS])
+                    frekey.write(",".join(_format(v) for v in row) + "\n")
+                for group in record.get('groups', []):
+                    if fgroups is None:
+                        fgroups = open(groups_file, "w")
+                        fgroups.write(",".join(GROUP_COLUMNS) + "\n")
+                    row = [record[c] for c in GROUP_COLUMNS[:8]] + [group[c] for c in GROUP_FIELDS]
+                    fgroups.write(",".join(_format(v) for v in row) + "\n")
+                for probe in record.get('profile', []):
+                    if fprofile is None:
+                        fprofile = open(profile_file, "w")
+                        fprofile.write(",".join(PROFILE_COLUMNS) + "\n")
+                    row = [record[c] for c in PROFILE_COLUMNS[:8]] + [probe[c] for c in PROFILE_COLUMNS[8:]]
+                    fprofile.write(",".join(_format(v) for v in row) + "\n")
+                count += 1
+    if frekey is not None:
+        frekey.close()
+        print("Rekey events written to %s" % rekey_file)
+    if fgroups is not None:
+        fgroups.close()
+        print("Per-group results written to %s" % groups_file)
+    if fprofile is not None:
+        fprofile.close()
+        print("Hot-path profile written to %s" % profile_file)
+
+    # Clear worker files after merging
+    if remove:
+        for fname in input_files:
+            os.remove(fname)
+
+    print("Merged %d records from %d worker files to %s" % (count, len(input_files), output_file))
+
+    return output_file, nodes_file
+
+
+if __name__ == "__main__":
+    merge_results(sys.argv[1] if len(sys.argv) > 1 else "results_cache",
+                  prefix=sys.argv[2] if len(sys.argv) > 2 else "worker")
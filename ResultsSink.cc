@@ -0,0 +1,297 @@
+#include "ResultsSink.h"
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+RunSummary::RunSummary()
+  : timestamp(0), areaLength(0), areaWidth(0), areaHeight(0), numNodes(0),
+    runId(0), rngRun(0), keyAgreementDelay(0), totalSent(0), totalReceived(0),
+    overheadRatio(0), successRate(0), avgUniqueContributions(0), successfulNodes(0) {
+}
+
+VariantResult::VariantResult()
+  : packetization(1), packing(1), overhearing(0), forwarding(0), forwardingBudget(0),
+    neighborExpiry(0), minDelivery(0), maxTargets(0), rankTargets(0) {
+}
+
+ResultsRecord::ResultsRecord() : m_sectionCount(0), m_sectionStart(0), m_inSection(false) {
+  m_buffer.reserve(256);
+  PutU32(MAGIC);
+  PutU16(VERSION);
+  PutU16(0);   // section count, patched by Finish()
+  PutU32(0);   // payload bytes, patched by Finish()
+}
+
+void ResultsRecord::AddSummary(const RunSummary& summary) {
+  BeginSection(RESULTS_SECTION_SUMMARY);
+  PutU64(static_cast<uint64_t>(summary.timestamp));
+  PutF64(summary.areaLength);
+  PutF64(summary.areaWidth);
+  PutF64(summary.areaHeight);
+  PutU32(summary.numNodes);
+  PutString(summary.linkQuality, 16);
+  PutText(summary.strategy);
+  PutU32(summary.runId);
+  PutU64(summary.rngRun);
+  PutF64(summary.keyAgreementDelay);
+  PutU32(summary.totalSent);
+  PutU32(summary.totalReceived);
+  PutF64(summary.overheadRatio);
+  PutF64(summary.successRate);
+  PutF64(summary.avgUniqueContributions);
+  PutU32(summary.successfulNodes);
+  EndSection();
+}
+
+void ResultsRecord::AddNodes(const std::vector<NodeResult>& nodes) {
+  BeginSection(RESULTS_SECTION_NODES);
+  PutU32(nodes.size());
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    PutU32(nodes[i].sent);
+    PutU32(nodes[i].received);
+    PutU32(nodes[i].contributions);
+    PutU32(nodes[i].completed);
+  }
+  EndSection();
+}
+
+// Totals first (f64 radio, f64 cpu), then u32 count and count x {f64 radio, f64 cpu, f64 remaining}
+void ResultsRecord::AddEnergy(const std::vector<NodeEnergy>& energy) {
+  double radio = 0;
+  double cpu = 0;
+  for (uint32_t i = 0; i < energy.size(); i++) {
+    radio += energy[i].radio;
+    cpu += energy[i].cpu;
+  }
+  BeginSection(RESULTS_SECTION_ENERGY);
+  PutF64(radio);
+  PutF64(cpu);
+  PutU32(energy.size());
+  for (uint32_t i = 0; i < energy.size(); i++) {
+    PutF64(energy[i].radio);
+    PutF64(energy[i].cpu);
+    PutF64(energy[i].remaining);
+  }
+  EndSection();
+}
+
+// u32 count, then count x {f64 time, u32 join, u32 node, u32 sponsor, u32 members, u32 full,
+// u32 recomputed, f64 delay, u32 sent, u32 received}
+// duration: simulated seconds the rekey workload ran, for rekeys per minute
+void ResultsRecord::AddRekeys(const std::vector<RekeyResult>& rekeys, double duration) {
+  BeginSection(RESULTS_SECTION_REKEY);
+  PutF64(duration);
+  PutU32(rekeys.size());
+  for (uint32_t i = 0; i < rekeys.size(); i++) {
+    PutF64(rekeys[i].time);
+    PutU32(rekeys[i].kind);
+    PutU32(rekeys[i].node);
+    PutU32(rekeys[i].sponsor);
+    PutU32(rekeys[i].members);
+    PutU32(rekeys[i].full);
+    PutU32(rekeys[i].recomputed);
+    PutF64(rekeys[i].delay);
+    PutU32(rekeys[i].sent);
+    PutU32(rekeys[i].received);
+  }
+  EndSection();
+}
+
+// f64 delay, u32 transmissions, u32 reachable
+void ResultsRecord::AddOracle(const OracleResult& oracle) {
+  BeginSection(RESULTS_SECTION_ORACLE);
+  PutF64(oracle.delay);
+  PutU32(oracle.transmissions);
+  PutU32(oracle.reachable);
+  EndSection();
+}
+
+// u32 count, then count x {char[32] name, u64 calls, u64 total ns, u64 p99 ns}
+void ResultsRecord::AddProfile(const std::vector<ProbeResult>& probes) {
+  BeginSection(RESULTS_SECTION_PROFILE);
+  PutU32(probes.size());
+  for (uint32_t i = 0; i < probes.size(); i++) {
+    PutString(probes[i].name, 32);
+    PutU64(probes[i].calls);
+    PutU64(probes[i].totalNs);
+    PutU64(probes[i].p99Ns);
+  }
+  EndSection();
+}
+
+// f64 wall s, f64 run s, u64 events, u64 peak RSS KiB
+void ResultsRecord::AddPerf(const PerfResult& perf) {
+  BeginSection(RESULTS_SECTION_PERF);
+  PutF64(perf.wallSeconds);
+  PutF64(perf.runSeconds);
+  PutU64(perf.events);
+  PutU64(perf.peakRssKb);
+  EndSection();
+}
+
+// u32 datagrams, u32 count, then count x {u32 id, u32 members, u32 completed, f64 delay, u32 units}
+// datagrams: packets sent for all groups together, to set against the units of each
+void ResultsRecord::AddGroups(const std::vector<GroupResult>& groups, uint32_t datagrams) {
+  BeginSection(RESULTS_SECTION_GROUPS);
+  PutU32(datagrams);
+  PutU32(groups.size());
+  for (uint32_t i = 0; i < groups.size(); i++) {
+    PutU32(groups[i].id);
+    PutU32(groups[i].members);
+    PutU32(groups[i].completed);
+    PutF64(groups[i].delay);
+    PutU32(groups[i].units);
+  }
+  EndSection();
+}
+
+// u32 policy, f64 slot ms, u32 slots, u32 MAC retries, u32 MAC drops
+void ResultsRecord::AddSend(const SendResult& send) {
+  BeginSection(RESULTS_SECTION_SEND);
+  PutU32(send.policy);
+  PutF64(send.slot);
+  PutU32(send.slots);
+  PutU32(send.macRetries);
+  PutU32(send.macDrops);
+  EndSection();
+}
+
+// u32 packetization, u32 packing, u32 overhearing, u32 forwarding rule, u32 forwarding budget,
+// f64 neighbour expiry s, f64 min delivery, u32 max targets, u32 rank targets
+void ResultsRecord::AddVariant(const VariantResult& variant) {
+  BeginSection(RESULTS_SECTION_VARIANT);
+  PutU32(variant.packetization);
+  PutU32(variant.packing);
+  PutU32(variant.overhearing);
+  PutU32(variant.forwarding);
+  PutU32(variant.forwardingBudget);
+  PutF64(variant.neighborExpiry);
+  PutF64(variant.minDelivery);
+  PutU32(variant.maxTargets);
+  PutU32(variant.rankTargets);
+  EndSection();
+}
+
+void ResultsRecord::BeginSection(uint16_t tag) {
+  if (m_inSection) {
+    EndSection();
+  }
+  m_sectionStart = m_buffer.size();
+  PutU16(tag);
+  PutU16(0);
+  PutU32(0);   // section length, patched by EndSection()
+  m_inSection = true;
+}
+
+void ResultsRecord::EndSection() {
+  if (!m_inSection) {
+    return;
+  }
+  PatchU32(m_sectionStart + 4, m_buffer.size() - m_sectionStart - 8);
+  m_sectionCount++;
+  m_inSection = false;
+}
+
+void ResultsRecord::PutU8(uint8_t value) {
+  PutBytes(&value, 1);
+}
+
+void ResultsRecord::PutU16(uint16_t value) {
+  uint8_t bytes[2] = { static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8) };
+  PutBytes(bytes, 2);
+}
+
+void ResultsRecord::PutU32(uint32_t value) {
+  uint8_t bytes[4];
+  for (uint32_t i = 0; i < 4; i++) {
+    bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+  PutBytes(bytes, 4);
+}
+
+void ResultsRecord::PutU64(uint64_t value) {
+  uint8_t bytes[8];
+  for (uint32_t i = 0; i < 8; i++) {
+    bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+  PutBytes(bytes, 8);
+}
+
+void ResultsRecord::PutF64(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  PutU64(bits);
+}
+
+// Fixed-width, zero-padded string field (truncated if longer than width)
+void ResultsRecord::PutString(const std::string& value, uint32_t width) {
+  std::string field = value.substr(0, width);
+  field.resize(width, '\0');
+  PutBytes(field.data(), width);
+}
+
+// u16 length, then the bytes (truncated past 65535)
+void ResultsRecord::PutText(const std::string& value) {
+  uint16_t length = static_cast<uint16_t>(std::min<size_t>(value.size(), 0xffff));
+  PutU16(length);
+  PutBytes(value.data(), length);
+}
+
+const std::vector<char>& ResultsRecord::Finish() {
+  EndSection();
+  m_buffer[6] = static_cast<char>(m_sectionCount & 0xff);
+  m_buffer[7] = static_cast<char>(m_sectionCount >> 8);
+  PatchU32(8, m_buffer.size() - 12);
+  return m_buffer;
+}
+
+void ResultsRecord::PutBytes(const void* data, uint32_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+void ResultsRecord::PatchU32(uint32_t offset, uint32_t value) {
+  for (uint32_t i = 0; i < 4; i++) {
+    m_buffer[offset + i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+}
+
+
+ResultsSink::ResultsSink(const std::string& directory, uint32_t workerId, const std::string& prefix) {
+  struct stat st;
+  if (stat(directory.c_str(), &st) != 0) {
+    mkdir(directory.c_str(), 0777);
+  }
+  std::ostringstream path;
+  path << directory << "/" << prefix << "_" << workerId << ".bin";
+  m_path = path.str();
+}
+
+// Append one finished record with a single write; O_APPEND keeps concurrent
+// writers (e.g. two runs sharing a worker id) from interleaving records
+bool ResultsSink::Append(ResultsRecord& record) {
+  const std::vector<char>& bytes = record.Finish();
+  int fd = open(m_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0666);
+  if (fd < 0) {
+    return false;
+  }
+  size_t written = 0;
+  while (written < bytes.size()) {
+    ssize_t n = write(fd, &bytes[written], bytes.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      close(fd);
+      return false;
+    }
+    written += n;
+  }
+  close(fd);
+  return true;
+}
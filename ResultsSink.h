@@ -0,0 +1,244 @@
+#ifndef RESULTS_SINK_H
+#define RESULTS_SINK_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+/**
+ * Section tags of a results record. A record always starts with a
+ * RESULTS_SECTION_SUMMARY section; readers skip tags they do not know.
+ */
+enum ResultsSectionTag
+{
+  RESULTS_SECTION_SUMMARY = 1,   ///< Run configuration and scalar metrics
+  RESULTS_SECTION_NODES = 2,     ///< Per-node packet/contribution vectors
+  RESULTS_SECTION_PROPAGATION_PAIRS = 3,   ///< First arrival per (node, contributor), see PropagationTrace
+  RESULTS_SECTION_PROPAGATION_EVENTS = 4,  ///< Delivery events kept by the PropagationTrace ring
+  RESULTS_SECTION_ENERGY = 5,    ///< Per-node radio and crypto CPU energy
+  RESULTS_SECTION_REKEY = 6,     ///< One entry per rekey (membership change or periodic epoch)
+  RESULTS_SECTION_ORACLE = 7,    ///< Lower bounds of the run's topology, see OracleBound
+  RESULTS_SECTION_PROFILE = 8,   ///< Hot-path timers of a -DREGKA_PROFILE build, see RegkaProfile
+  RESULTS_SECTION_PERF = 9,      ///< Simulator cost of the run: wall-clock time, events, peak RSS
+  RESULTS_SECTION_GROUPS = 10,   ///< One entry per concurrent group (--groups)
+  RESULTS_SECTION_SEND = 11,     ///< Send backoff policy and the MAC retries and drops of the run
+  RESULTS_SECTION_VARIANT = 12   ///< Protocol options behind the strategy label suffixes
+};
+
+/**
+ * What started a rekey
+ */
+enum RekeyKind
+{
+  REKEY_LEAVE = 0,
+  REKEY_JOIN = 1,
+  REKEY_PERIODIC = 2    ///< Scheduled re-agreement of an unchanged group (--rekeyInterval)
+};
+
+/**
+ * Scalar metrics computed at the end of startSimulation
+ */
+struct RunSummary
+{
+  RunSummary();
+
+  int64_t timestamp;               ///< Wall-clock end time (Unix seconds)
+  double areaLength;
+  double areaWidth;
+  double areaHeight;
+  uint32_t numNodes;
+  std::string linkQuality;         ///< Stored in 16 bytes
+  std::string strategy;            ///< Length-prefixed, with every variant suffix
+  uint32_t runId;
+  uint64_t rngRun;
+  double keyAgreementDelay;
+  uint32_t totalSent;
+  uint32_t totalReceived;
+  double overheadRatio;
+  double successRate;
+  double avgUniqueContributions;
+  uint32_t successfulNodes;
+};
+
+/**
+ * Per-node counters of one run
+ */
+struct NodeResult
+{
+  uint32_t sent;
+  uint32_t received;
+  uint32_t contributions;
+  uint32_t completed;
+};
+
+/**
+ * Energy spent by one node during a run
+ */
+struct NodeEnergy
+{
+  double radio;       ///< WiFi radio energy (J)
+  double cpu;         ///< Crypto CPU energy (J)
+  double remaining;   ///< Energy left in the node's source (J)
+};
+
+/**
+ * One rekey during the run: a join or leave, or a periodic epoch
+ */
+struct RekeyResult
+{
+  double time;          ///< Simulation time the rekey started (s)
+  uint32_t kind;        ///< RekeyKind
+  uint32_t node;        ///< Joining or leaving node (0 for periodic epochs)
+  uint32_t sponsor;     ///< Node sending the new contribution (the joining node on a join)
+  uint32_t members;     ///< Group size after the change
+  uint32_t full;        ///< 1 full re-agreement, 0 incremental rekey
+  uint32_t recomputed;  ///< Most internal tree nodes a member merged during the rekey (counted)
+  double delay;         ///< Until every member holds the new group key, 0 if never
+  uint32_t sent;        ///< Packets sent during the rekey
+  uint32_t received;    ///< Packets received during the rekey
+};
+
+/**
+ * Best delay and fewest transmissions the run's topology allows any agreement
+ */
+struct OracleResult
+{
+  double delay;             ///< Key agreement delay lower bound (s), 0 if not reachable
+  uint32_t transmissions;   ///< Transmissions lower bound
+  uint32_t reachable;       ///< 1 if every contribution can reach every node within the run
+};
+
+/**
+ * Wall-clock time spent in one instrumented protocol operation
+ */
+struct ProbeResult
+{
+  std::string name;     ///< Stored in 32 bytes
+  uint64_t calls;
+  uint64_t totalNs;
+  uint64_t p99Ns;
+};
+
+/**
+ * What a run cost the simulator, to track simulation throughput across changes
+ */
+struct PerfResult
+{
+  double wallSeconds;   ///< Whole run, set-up and result output included
+  double runSeconds;    ///< Event loop only
+  uint64_t events;      ///< Events executed
+  uint64_t peakRssKb;   ///< Peak resident set size of the process so far
+};
+
+/**
+ * One of several groups agreeing concurrently over the same nodes
+ */
+struct GroupResult
+{
+  uint32_t id;          ///< Index in --groups
+  uint32_t members;
+  uint32_t completed;   ///< Members holding the group's key at the end of the run
+  double delay;         ///< Until the last member held the key (s after the start), 0 if never
+  uint32_t units;       ///< Message units sent for the group, before packing into datagrams
+};
+
+/**
+ * Send backoff of a run (see SendScheduler) and the contention it met
+ */
+struct SendResult
+{
+  uint32_t policy;      ///< SendPolicy
+  double slot;          ///< Backoff slot (ms)
+  uint32_t slots;       ///< Slots of the jitter and slotted windows
+  uint32_t macRetries;  ///< Failed unicast attempts over all nodes
+  uint32_t macDrops;    ///< Unicast units given up after the retry limit
+};
+
+/**
+ * Protocol options a run used, one field per strategy label suffix, so results
+ * can be filtered on them without parsing the label. The send policy is in
+ * the SEND section.
+ */
+struct VariantResult
+{
+  VariantResult();
+
+  uint32_t packetization;     ///< 1 MTU-sized message units, 0 whole fragmented messages (/frag)
+  uint32_t packing;           ///< 1 units of concurrent groups share datagrams, 0 not (/nopack)
+  uint32_t overhearing;       ///< 1 nodes merge unicasts addressed to others (/oh)
+  uint32_t forwarding;        ///< ForwardingRule (/rarest)
+  uint32_t forwardingBudget;  ///< Crypto material bytes of a rarest-first message, 0 for no limit
+  double neighborExpiry;      ///< Neighbour policy (/nbr): table expiry (s), 0 for never
+  double minDelivery;         ///< Lowest expected delivery ratio of a forwarding target
+  uint32_t maxTargets;        ///< Most forwarding targets, 0 for all
+  uint32_t rankTargets;       ///< 1 best expected delivery first, 0 most recent first
+};
+
+/**
+ * One run's results in the fixed binary record layout:
+ *   record header : u32 magic, u16 version, u16 section count, u32 payload bytes
+ *   each section  : u16 tag, u16 reserved, u32 length, <length bytes>
+ * All fields are little-endian and unpadded, strings fixed-width and zero-padded
+ * or u16 length-prefixed (PutText), see ResultsMerge.py for the reader.
+ */
+class ResultsRecord
+{
+public:
+  static const uint32_t MAGIC = 0x524b4752;   // "RGKR"
+  static const uint16_t VERSION = 2;   // 2: SUMMARY strategy length-prefixed instead of char[32]
+
+  ResultsRecord();
+
+  void AddSummary(const RunSummary& summary);
+  void AddNodes(const std::vector<NodeResult>& nodes);
+  void AddEnergy(const std::vector<NodeEnergy>& energy);
+  void AddRekeys(const std::vector<RekeyResult>& rekeys, double duration);
+  void AddOracle(const OracleResult& oracle);
+  void AddProfile(const std::vector<ProbeResult>& probes);
+  void AddPerf(const PerfResult& perf);
+  void AddGroups(const std::vector<GroupResult>& groups, uint32_t datagrams);
+  void AddSend(const SendResult& send);
+  void AddVariant(const VariantResult& variant);
+
+  // Raw section interface, used by the Add* helpers
+  void BeginSection(uint16_t tag);
+  void EndSection();
+  void PutU8(uint8_t value);
+  void PutU16(uint16_t value);
+  void PutU32(uint32_t value);
+  void PutU64(uint64_t value);
+  void PutF64(double value);
+  void PutString(const std::string& value, uint32_t width);
+  void PutText(const std::string& value);
+
+  // Patch the record header and return the encoded bytes
+  const std::vector<char>& Finish();
+
+private:
+  void PutBytes(const void* data, uint32_t size);
+  void PatchU32(uint32_t offset, uint32_t value);
+
+  std::vector<char> m_buffer;   ///< Encoded record, header included
+  uint16_t m_sectionCount;      ///< Sections written so far
+  uint32_t m_sectionStart;      ///< Offset of the open section header
+  bool m_inSection;             ///< Whether a section is open
+};
+
+/**
+ * Append-only results file of one worker (one parallel job slot). Every run
+ * writes its whole record with a single write(2) on an O_APPEND descriptor,
+ * so runs never contend on a shared database and never create per-run files.
+ */
+class ResultsSink
+{
+public:
+  ResultsSink(const std::string& directory, uint32_t workerId, const std::string& prefix = "worker");
+
+  bool Append(ResultsRecord& record);
+  std::string GetPath() const { return m_path; }
+
+private:
+  std::string m_path;   ///< <directory>/<prefix>_<id>.bin
+};
+
+#endif /* RESULTS_SINK_H */
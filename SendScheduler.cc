@@ -0,0 +1,42 @@
+#include "SendScheduler.h"
+
+// Application processing before every send (ms)
+static const double PROCESSING_DELAY = 1.0;
+
+static const char* const POLICY_NAMES[] = {"fixed", "jitter", "slotted", "density"};
+
+SendScheduler::SendScheduler() : m_policy(SEND_POLICY_FIXED), m_slot(0), m_slots(1) {
+}
+
+void SendScheduler::SetPolicy(SendPolicy policy, double slot, uint32_t slots) {
+  m_policy = policy;
+  m_slot = slot;
+  m_slots = slots > 0 ? slots : 1;
+}
+
+double SendScheduler::GetDelay(uint32_t nodeId, uint32_t neighbors, RandomSource& random) const {
+  switch (m_policy) {
+  case SEND_POLICY_JITTER:
+    return PROCESSING_DELAY + random.GetUniform() * m_slots * m_slot;
+  case SEND_POLICY_SLOTTED:
+    return PROCESSING_DELAY + (nodeId % m_slots) * m_slot;
+  case SEND_POLICY_DENSITY:
+    return PROCESSING_DELAY + random.GetUniform() * (neighbors > 0 ? neighbors : m_slots) * m_slot;
+  default:
+    return PROCESSING_DELAY;
+  }
+}
+
+bool SendScheduler::ParsePolicy(const std::string& name, SendPolicy& policy) {
+  for (uint32_t i = 0; i < sizeof(POLICY_NAMES) / sizeof(POLICY_NAMES[0]); i++) {
+    if (name == POLICY_NAMES[i]) {
+      policy = static_cast<SendPolicy>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* SendScheduler::GetPolicyName(SendPolicy policy) {
+  return POLICY_NAMES[policy];
+}
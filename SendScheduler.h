@@ -0,0 +1,50 @@
+#ifndef SEND_SCHEDULER_H
+#define SEND_SCHEDULER_H
+
+#include "RandomSource.h"
+#include <string>
+#include <stdint.h>
+
+/**
+ * How a sender spreads its transmissions over time
+ */
+enum SendPolicy
+{
+  SEND_POLICY_FIXED = 0,     ///< Processing delay only: neighbours triggered by one packet send in lockstep
+  SEND_POLICY_JITTER = 1,    ///< Uniform jitter over slots x slot
+  SEND_POLICY_SLOTTED = 2,   ///< Backoff of (node id mod slots) slots
+  SEND_POLICY_DENSITY = 3    ///< Uniform jitter over one slot per current neighbour
+};
+
+/**
+ * Delay between handing a message to the sender and putting it on the air.
+ * Every message first waits the 1 ms processing delay. The initial
+ * broadcasts start almost together, and every node that heard the same
+ * packet forwards after the same delay. So neighbours without an extra
+ * backoff contend for the channel at once and collide. The policies add
+ * that backoff at the application, in slots of about one unit's airtime.
+ */
+class SendScheduler
+{
+public:
+  SendScheduler();
+
+  // slot: backoff slot (ms); slots: window of jitter and slotted, in slots
+  void SetPolicy(SendPolicy policy, double slot, uint32_t slots);
+  SendPolicy GetPolicy() const { return m_policy; }
+
+  // Delay (ms) of a message handed over now. neighbors is the sender's
+  // neighbour count; density spreads over the slots window until it knows any.
+  double GetDelay(uint32_t nodeId, uint32_t neighbors, RandomSource& random) const;
+
+  // "fixed", "jitter", "slotted" or "density"
+  static bool ParsePolicy(const std::string& name, SendPolicy& policy);
+  static const char* GetPolicyName(SendPolicy policy);
+
+private:
+  SendPolicy m_policy;
+  double m_slot;      ///< ms
+  uint32_t m_slots;
+};
+
+#endif /* SEND_SCHEDULER_H */
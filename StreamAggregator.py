@@ -0,0 +1,380 @@
+import glob
+import math
+import os
+import sys
+import time
+from datetime import datetime
+from ResultsMerge import read_records
+
+# Two-sided 95 % Student t quantiles for 1..30 degrees of freedom; the normal value beyond
+T95 = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+
+
+def t95(df):
+    if df < 1:
+        return float('nan')
+    return T95[df - 1] if df <= len(T95) else 1.96
+
+
+class Welford(object):
+    """Running count, mean, variance, min and max of a stream"""
+
+    __slots__ = ('count', 'mean', 'm2', 'min', 'max')
+
+    def __init__(self):
+        self.count = 0
+        self.mean = 0.0
+        self.m2 = 0.0
+        self.min = None
+        self.max = None
+
+    def add(self, x):
+        self.count += 1
+        delta = x - self.mean
+        self.mean += delta / self.count
+        self.m2 += delta * (x - self.mean)
+        if self.min is None or x < self.min:
+            self.min = x
+        if self.max is None or x > self.max:
+            self.max = x
+
+    def variance(self):
+        return self.m2 / (self.count - 1) if self.count > 1 else 0.0
+
+    def std(self):
+        return math.sqrt(self.variance())
+
+    def ci95(self):
+        """Half-width of the 95 % confidence interval of the mean"""
+        if self.count < 2:
+            return float('inf')
+        return t95(self.count - 1) * self.std() / math.sqrt(self.count)
+
+
+class P2Quantile(object):
+    """P-square streaming quantile estimate (Jain & Chlamtac 1985), five markers"""
+
+    __slots__ = ('p', 'heights', 'positions', 'desired', 'increments')
+
+    def __init__(self, p):
+        self.p = p
+        self.heights = []
+        self.positions = [1, 2, 3, 4, 5]
+        self.desired = [1, 1 + 2 * p, 1 + 4 * p, 3 + 2 * p, 5]
+        self.increments = [0, p / 2, p, (1 + p) / 2, 1]
+
+    def add(self, x):
+        q = self.heights
+        if len(q) < 5:
+            q.append(x)
+            q.sort()
+            return
+        if x < q[0]:
+            q[0] = x
+            k = 0
+        elif x >= q[4]:
+            q[4] = x
+            k = 3
+        else:
+            k = 0
+            while x >= q[k + 1]:
+                k += 1
+        n = self.positions
+        for i in range(k + 1, 5):
+            n[i] += 1
+        for i in range(5):
+            self.desired[i] += self.increments[i]
+        for i in (1, 2, 3):
+            d = self.desired[i] - n[i]
+            if (d >= 1 and n[i + 1] - n[i] > 1) or (d <= -1 and n[i - 1] - n[i] < -1):
+                d = 1 if d > 0 else -1
+                candidate = q[i] + d / float(n[i + 1] - n[i - 1]) * (
+                    (n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / float(n[i + 1] - n[i]) +
+                    (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / float(n[i] - n[i - 1]))
+                if not q[i - 1] < candidate < q[i + 1]:
+                    candidate = q[i] + d * (q[i + d] - q[i]) / float(n[i + d] - n[i])
+                q[i] = candidate
+                n[i] += d
+
+    def value(self):
+        q = self.heights
+        if not q:
+            return None
+        if len(q) < 5:
+            return q[min(len(q) - 1, int(self.p * len(q)))]
+        return q[2]
+
+
+DELAY_QUANTILES = (0.5, 0.9, 0.99)
+
+
+class ConfigStats(object):
+    """Memory-bounded statistics of one (linkQuality, area, numNodes) configuration"""
+
+    def __init__(self):
+        self.runs = 0
+        self.delay = Welford()          # successful runs only, as the Delay Analysis sheet
+        self.delay_quantiles = [P2Quantile(p) for p in DELAY_QUANTILES]
+        self.completed = Welford()      # 100 if keyAgreementDelay > 0 else 0
+        self.success_rate = Welford()   # per-run successRate column
+        self.sent = Welford()
+        self.received = Welford()
+        self.contributions = Welford()
+
+    def add(self, record):
+        self.runs += 1
+        delay = record['keyAgreementDelay']
+        if delay > 0 and record['successRate'] == 100:
+            self.delay.add(delay)
+            for quantile in self.delay_quantiles:
+                quantile.add(delay)
+        self.completed.add(100.0 if delay > 0 else 0.0)
+        self.success_rate.add(record['successRate'])
+        self.sent.add(record['totalSent'])
+        self.received.add(record['totalReceived'])
+        self.contributions.add(record['avgUniqueContributions'])
+
+
+class EnergyStats(object):
+    """Energy statistics of one (linkQuality, strategy, area, numNodes) configuration"""
+
+    def __init__(self):
+        self.radio = Welford()
+        self.cpu = Welford()
+        self.total = Welford()
+
+    def add(self, record):
+        if record.get('totalEnergy') is None:
+            return
+        self.radio.add(record['totalRadioEnergy'])
+        self.cpu.add(record['totalCpuEnergy'])
+        self.total.add(record['totalEnergy'])
+
+
+class RekeyStats(object):
+    """Rekeys of one configuration, rekey kind (join/leave/periodic) and mode (incremental/full)"""
+
+    def __init__(self):
+        self.delay = Welford()          # completed rekeys only
+        self.delay_p90 = P2Quantile(0.9)
+        self.completed = Welford()      # 100 per completed rekey, else 0
+        self.sent = Welford()
+        self.received = Welford()
+        self.recomputed = Welford()
+        self.per_minute = Welford()     # completed rekeys per simulated minute, one value per run
+
+    def add(self, rekey):
+        if rekey['delay'] > 0:
+            self.delay.add(rekey['delay'])
+            self.delay_p90.add(rekey['delay'])
+        self.completed.add(100.0 if rekey['delay'] > 0 else 0.0)
+        self.sent.add(rekey['sent'])
+        self.received.add(rekey['received'])
+        self.recomputed.add(rekey['recomputed'])
+
+
+def _area(key):
+    return "%g*%g*%g" % (key[1], key[2], key[3])
+
+
+def _round(value, digits):
+    if value is None or (isinstance(value, float) and (math.isinf(value) or math.isnan(value))):
+        return None
+    return round(value, digits)
+
+
+def _sql_round_up(value):
+    # CAST(ROUND(AVG(x) + 0.5) AS INTEGER) of the original SQL sheets
+    return int(math.floor(value + 1.0)) if value >= 0 else int(math.ceil(value))
+
+
+class StreamAggregator(object):
+    """Per-configuration online statistics fed record by record.
+
+    State is a few accumulators per configuration, independent of the number
+    of runs. consume_file() remembers how far each results file was read, so
+    calling consume_dir() periodically only decodes the records appended since.
+    """
+
+    def __init__(self):
+        self.configs = {}    # (linkQuality, areaLength, areaWidth, areaHeight, numNodes, strategy) -> ConfigStats
+        self.energy = {}     # (linkQuality, areaLength, areaWidth, areaHeight, numNodes, strategy) -> EnergyStats
+        self.rekeys = {}     # (linkQuality, areaLength, areaWidth, areaHeight, numNodes, strategy, kind, mode) -> RekeyStats
+        self.offsets = {}    # results file -> bytes consumed
+        self.records = 0
+
+    @staticmethod
+    def config_key(record):
+        return (record['linkQuality'], record['areaLength'], record['areaWidth'], record['areaHeight'], record['numNodes'],
+                record['strategy'])
+
+    def add(self, record):
+        key = self.config_key(record)
+        stats = self.configs.get(key)
+        if stats is None:
+            stats = self.configs[key] = ConfigStats()
+        stats.add(record)
+        energy = self.energy.get(key)
+        if energy is None:
+            energy = self.energy[key] = EnergyStats()
+        energy.add(record)
+        self.add_rekeys(key, record.get('rekeys'))
+        self.records += 1
+
+    def add_rekeys(self, key, rekeys):
+        if not rekeys or not rekeys['events']:
+            return
+        completed = {}
+        for rekey in rekeys['events']:
+            rekey_key = key + (rekey['kind'], 'full' if rekey['full'] else 'incremental')
+            stats = self.rekeys.get(rekey_key)
+            if stats is None:
+                stats = self.rekeys[rekey_key] = RekeyStats()
+            stats.add(rekey)
+            completed[rekey_key] = completed.get(rekey_key, 0) + (1 if rekey['delay'] > 0 else 0)
+        if rekeys['duration'] > 0:
+            for rekey_key, count in completed.items():
+                self.rekeys[rekey_key].per_minute.add(count * 60.0 / rekeys['duration'])
+
+    def consume_file(self, path):
+        """Add the complete records appended to path since the last call"""
+        offset = self.offsets.get(path, 0)
+        try:
+            if os.path.getsize(path) < offset:
+                offset = 0    # file was merged away and started over
+        except OSError:
+            return 0
+        count = 0
+        for record, offset in read_records(path, offset):
+            self.add(record)
+            count += 1
+        if count:
+            self.offsets[path] = offset
+        return count
+
+    def consume_dir(self, cache_dir="results_cache", prefix="worker"):
+        count = 0
+        for path in sorted(glob.glob(os.path.join(cache_dir, prefix + "_*.bin"))):
+            count += self.consume_file(path)
+        return count
+
+    def sorted_keys(self):
+        # Numeric order of area and node count, whatever configurations were swept
+        return sorted(self.configs, key=lambda k: (k[0], k[5], k[1] * k[2] * k[3], k[1], k[2], k[3], k[4]))
+
+    def report_sheets(self):
+        """Rows of the report sheets as {sheet name: (columns, rows)}"""
+        delay_rows, packet_rows, success_rows = [], [], []
+        for key in self.sorted_keys():
+            s = self.configs[key]
+            head = [key[0], key[5], _area(key), key[4], s.runs]
+            quantiles = [_round(q.value(), 4) for q in s.delay_quantiles]
+            delay_rows.append(head + [
+                s.delay.count,
+                _round(s.delay.mean, 4) if s.delay.count else None,
+                _round(s.delay.min, 4), _round(s.delay.max, 4),
+                _round(s.delay.std(), 4) if s.delay.count else None,
+                _round(s.delay.ci95(), 4)] + quantiles)
+            packet_rows.append(head + [
+                _sql_round_up(s.sent.mean), _sql_round_up(s.received.mean),
+                _round(s.contributions.mean, 2),
+                _round(s.sent.ci95(), 2), _round(s.received.ci95(), 2)])
+            success_rows.append(head + [
+                int(round(s.completed.mean * s.completed.count / 100.0)),
+                _round(s.completed.mean, 2), _round(s.completed.ci95(), 2),
+                _round(s.success_rate.mean, 2), _round(s.success_rate.ci95(), 2)])
+
+        energy_rows = []
+        for key in self.sorted_keys():
+            e = self.energy[key]
+            if e.total.count == 0:
+                continue
+            energy_rows.append([key[0], key[5], _area(key), key[4], e.total.count,
+                                _round(e.radio.mean, 4), _round(e.cpu.mean, 6), _round(e.total.mean, 4),
+                                _round(e.total.mean / key[4], 4), _round(e.total.max, 4), _round(e.total.ci95(), 4)])
+
+        rekey_rows = []
+        for key in sorted(self.rekeys, key=lambda k: (k[0], k[5], k[6], k[7], k[1] * k[2] * k[3], k[1], k[2], k[3], k[4])):
+            r = self.rekeys[key]
+            rekey_rows.append([key[0], key[5], key[6], key[7], _area(key), key[4], r.completed.count,
+                               _round(r.completed.mean, 2),
+                               _round(r.delay.mean, 4) if r.delay.count else None, _round(r.delay.ci95(), 4),
+                               _round(r.delay_p90.value(), 4),
+                               _round(r.sent.mean, 2), _round(r.received.mean, 2), _round(r.recomputed.mean, 2),
+                               _round(r.per_minute.mean, 2) if r.per_minute.count else None])
+
+        head = ['LinkQuality', 'Strategy', 'AreaSize', 'NodeCount', 'TotalCount']
+        return {
+            'Delay Analysis': (head + ['SuccessCount', 'AvgDelay', 'MinDelay', 'MaxDelay', 'StdDelay', 'DelayCI95'] +
+                               ['DelayP%g' % (100 * p) for p in DELAY_QUANTILES], delay_rows),
+            'Packet Statistics': (head + ['AvgSentPackets', 'AvgReceivedPackets', 'AvgUniqueContributions',
+                                          'SentCI95', 'ReceivedCI95'], packet_rows),
+            'Success Rate Analysis': (head + ['SuccessCount', 'SuccessRate', 'SuccessRateCI95',
+                                              'AvgNodeSuccessRate', 'AvgNodeSuccessRateCI95'], success_rows),
+            'Energy Analysis': (['LinkQuality', 'Strategy', 'AreaSize', 'NodeCount', 'TotalCount', 'AvgRadioEnergyJ',
+                                 'AvgCpuEnergyJ', 'AvgTotalEnergyJ', 'AvgEnergyPerNodeJ', 'MaxTotalEnergyJ',
+                                 'TotalEnergyCI95'], energy_rows),
+            'Rekey Analysis': (['LinkQuality', 'Strategy', 'Kind', 'Mode', 'AreaSize', 'NodeCount', 'RekeyCount',
+                                'CompletedRate', 'AvgRekeyDelay', 'RekeyDelayCI95', 'RekeyDelayP90',
+                                'AvgSentPackets', 'AvgReceivedPackets', 'AvgRecomputedTreeNodes',
+                                'RekeysPerMinute'], rekey_rows),
+        }
+
+    def write_csv_sheets(self, prefix):
+        """One {prefix}_<Sheet_Name>.csv per report sheet (the rekey sheet only when runs had rekeys)"""
+        files = []
+        for name, (columns, rows) in sorted(self.report_sheets().items()):
+            if name == 'Rekey Analysis' and not rows:
+                continue
+            path = "%s_%s.csv" % (prefix, name.replace(' ', '_'))
+            with open(path, "w") as fout:
+                fout.write(",".join(columns) + "\n")
+                for row in rows:
+                    fout.write(",".join("" if v is None else str(v) for v in row) + "\n")
+            files.append(path)
+        return files
+
+    def print_progress(self, out=sys.stdout):
+        out.write("%-6s %-44s %-14s %5s %6s %16s %18s %9s %9s\n" % (
+            "link", "strategy", "area", "nodes", "runs", "success %", "delay s", "p50", "p90"))
+        for key in self.sorted_keys():
+            s = self.configs[key]
+            p50, p90 = s.delay_quantiles[0].value(), s.delay_quantiles[1].value()
+            out.write("%-6s %-44s %-14s %5d %6d %8.2f +-%6.2f %9.4f +-%7.4f %9s %9s\n" % (
+                key[0], key[5], _area(key), key[4], s.runs, s.completed.mean, min(s.completed.ci95(), 999.99),
+                s.delay.mean, min(s.delay.ci95(), 99.9999),
+                "%.4f" % p50 if p50 is not None else "-", "%.4f" % p90 if p90 is not None else "-"))
+        out.flush()
+
+
+def follow(cache_dir="results_cache", interval=30.0, prefix="worker"):
+    """Watch a running sweep: fold in new records every interval seconds and print the convergence table"""
+    aggregator = StreamAggregator()
+    snapshot = datetime.now().strftime("%Y%m%d%H%M%S") + "_Live"
+    try:
+        while True:
+            added = aggregator.consume_dir(cache_dir, prefix)
+            if added:
+                print("\n%s: +%d runs, %d total" % (datetime.now().strftime("%H:%M:%S"), added, aggregator.records))
+                aggregator.print_progress()
+                aggregator.write_csv_sheets(snapshot)
+            time.sleep(interval)
+    except KeyboardInterrupt:
+        pass
+    return aggregator
+
+
+if __name__ == "__main__":
+    # python StreamAggregator.py [results_cache] [interval seconds, 0 = single pass] [file prefix]
+    cache_dir = sys.argv[1] if len(sys.argv) > 1 else "results_cache"
+    interval = float(sys.argv[2]) if len(sys.argv) > 2 else 0
+    prefix = sys.argv[3] if len(sys.argv) > 3 else "worker"
+    if interval > 0:
+        follow(cache_dir, interval, prefix)
+    else:
+        aggregator = StreamAggregator()
+        aggregator.consume_dir(cache_dir, prefix)
+        aggregator.print_progress()
+        print("\n".join(aggregator.write_csv_sheets(datetime.now().strftime("%Y%m%d%H%M%S"))))
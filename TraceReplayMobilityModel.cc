@@ -0,0 +1,40 @@
+#include "TraceReplayMobilityModel.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("trace-replay-mobility");
+
+TypeId TraceReplayMobilityModel::GetTypeId(void) {
+	static TypeId tid =
+			TypeId("TraceReplayMobilityModel").SetParent<MobilityModel>()
+					.AddConstructor<TraceReplayMobilityModel>();
+	return tid;
+}
+
+TraceReplayMobilityModel::TraceReplayMobilityModel() {
+	m_trace = 0;
+	m_node = 0;
+}
+
+TraceReplayMobilityModel::~TraceReplayMobilityModel() {}
+
+void TraceReplayMobilityModel::SetTrace(const MobilityTraceFile* trace, uint32_t node) {
+	m_trace = trace;
+	m_node = node;
+	NotifyCourseChange();
+}
+
+Vector TraceReplayMobilityModel::DoGetPosition(void) const {
+	TracePoint p = m_trace->GetPosition(m_node, Simulator::Now().GetSeconds());
+	return Vector(p.x, p.y, p.z);
+}
+
+// The trace is authoritative; explicit positions are ignored
+void TraceReplayMobilityModel::DoSetPosition(const Vector&) {
+	NS_LOG_WARN("Ignoring SetPosition on a trace-replay mobility model");
+}
+
+Vector TraceReplayMobilityModel::DoGetVelocity(void) const {
+	TracePoint v = m_trace->GetVelocity(m_node, Simulator::Now().GetSeconds());
+	return Vector(v.x, v.y, v.z);
+}
@@ -0,0 +1,33 @@
+#ifndef TRACE_REPLAY_MOBILITY_MODEL_H
+#define TRACE_REPLAY_MOBILITY_MODEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "MobilityTrace.h"
+
+using namespace ns3;
+
+/**
+ * Mobility model replaying one node of a precomputed mobility trace. The
+ * trace is shared, memory-mapped and read-only, so a run only pays for the
+ * interpolation of the frames it actually queries; no mobility events are
+ * scheduled.
+ */
+class TraceReplayMobilityModel: public MobilityModel {
+public:
+	static TypeId GetTypeId(void);
+	TraceReplayMobilityModel();
+	virtual ~TraceReplayMobilityModel();
+
+	void SetTrace(const MobilityTraceFile* trace, uint32_t node); // Trace must outlive the model
+
+private:
+	virtual Vector DoGetPosition(void) const;
+	virtual void DoSetPosition(const Vector& position);
+	virtual Vector DoGetVelocity(void) const;
+
+	const MobilityTraceFile* m_trace;	// Shared trace
+	uint32_t m_node;					// Node index inside the trace
+};
+
+#endif /* TRACE_REPLAY_MOBILITY_MODEL_H */
@@ -38,18 +38,34 @@ NODE_RANGE[3,1]="55"
 LINK_QUALITIES=("LOS")
 
 
-# Number of experiments for each configuration
+# Number of experiments for each configuration (the upper bound when ADAPTIVE=1)
 NUM_EXPERIMENTS=200
 
-# Configure logging and compilation options
-export NS_LOG='wifi-adhoc-UAV-experiment=info|prefix_time|prefix_func:wifi-adhoc-app=info|prefix_time|prefix_func';
-export CXXFLAGS="-g -std=c++03 -fpermissive"
-export LDFLAGS="-lsqlite3"
+# Sequential stopping: after MIN_EXPERIMENTS runs a configuration stops once the 95 % CI
+# half-width of the success rate is below SUCCESS_CI points and that of the mean delay below
+# DELAY_CI of the mean; freed job slots go to the configurations that are still noisy
+ADAPTIVE=1
+MIN_EXPERIMENTS=30
+SUCCESS_CI=2.0
+DELAY_CI=0.05
+JOBS=120
+
+# Common random numbers: RngRun is the run index instead of a random seed, so run k of a
+# configuration draws the same channel, mobility and forwarding streams in every protocol
+# variant and results can be compared in pairs on rngRun
+CRN=1
+
+# Log verbosity of every run (none|summary|detail|dump); per-packet levels are compiled out below
+LOG_LEVEL="summary"
+
+# Configure compilation options
+export CXXFLAGS="-g -std=c++03 -fpermissive -DREGKA_LOG_MAX_LEVEL=1"
 
 echo "Large-scale experiment started..."
 
-# Generate command file
+# Generate command file (configuration file in adaptive mode)
 CMD_FILE="commands_${TIMESTAMP}.txt"
+CONFIG_FILE="configs_${TIMESTAMP}.txt"
 echo "Generating all experiment commands..."
 
 for area_idx in {0..3}
@@ -73,10 +89,19 @@ do
         for nodeCount in $(seq $node_min $node_max)
         do
             echo "Node count: $nodeCount"
+
+            if [ "$ADAPTIVE" = "1" ]; then
+                echo "$areaLength $areaWidth $areaHeight $nodeCount $linkQuality" >> $CONFIG_FILE
+                continue
+            fi
             
             for ((run=1; run<=NUM_EXPERIMENTS; run++))
             do
-                seed=$((RANDOM % 1000000))
+                if [ "$CRN" = "1" ]; then
+                    seed=$run
+                else
+                    seed=$((RANDOM % 1000000))
+                fi
                 # Write in multiple lines for readability
                 echo "../../waf --run 'REGKA-Ours \
                 --numNodes=$nodeCount \
@@ -85,6 +110,7 @@ do
                 --areaHeight=$areaHeight \
                 --linkQuality=$linkQuality \
                 --run=$run \
+                --logLevel=$LOG_LEVEL \
                 --RngRun=$seed'" >> $CMD_FILE
             done
         done
@@ -92,7 +118,11 @@ do
 done
 
 
-parallel --delay 0.2 -j 120 < $CMD_FILE > run.log 2>&1
+if [ "$ADAPTIVE" = "1" ]; then
+    python AdaptiveSweep.py $CONFIG_FILE $JOBS $MIN_EXPERIMENTS $NUM_EXPERIMENTS $SUCCESS_CI $DELAY_CI $LOG_LEVEL $CRN
+else
+    parallel --delay 0.2 -j $JOBS < $CMD_FILE > run.log 2>&1
+fi
 
 # Merge results
 python Analyze.py
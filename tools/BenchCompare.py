@@ -0,0 +1,41 @@
+"""Compare two ProtocolBench result files and flag regressions.
+
+    python tools/BenchCompare.py baseline.csv current.csv [threshold]
+
+Prints ns/op, allocs/op and bytes/op ratios (current / baseline) for every
+(benchmark, n, fill) present in both files. Exits with status 1 if any ns/op
+ratio exceeds 1 + threshold (default 0.10) or allocations/op grew.
+"""
+import csv
+import sys
+
+
+def read_bench(path):
+    with open(path) as fin:
+        return dict(((row['benchmark'], int(row['n']), float(row['fill'])), row) for row in csv.DictReader(fin))
+
+
+def compare(baseline_path, current_path, threshold=0.10):
+    baseline = read_bench(baseline_path)
+    current = read_bench(current_path)
+    regressions = 0
+    print("%-45s %6s %5s %12s %12s %8s %10s" % ("benchmark", "n", "fill", "base ns/op", "ns/op", "ratio", "allocs"))
+    for key in sorted(set(baseline) & set(current)):
+        base, cur = baseline[key], current[key]
+        base_ns, cur_ns = float(base['ns_per_op']), float(cur['ns_per_op'])
+        ratio = cur_ns / base_ns if base_ns > 0 else float('inf')
+        allocs = "%s->%s" % (base['allocs_per_op'], cur['allocs_per_op'])
+        flag = ""
+        if ratio > 1 + threshold or float(cur['allocs_per_op']) > float(base['allocs_per_op']):
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-45s %6d %5g %12.1f %12.1f %8.3f %10s%s" % (key[0], key[1], key[2], base_ns, cur_ns, ratio, allocs, flag))
+    print("%d regressions" % regressions)
+    return regressions
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        print(__doc__)
+        sys.exit(2)
+    sys.exit(1 if compare(sys.argv[1], sys.argv[2], float(sys.argv[3]) if len(sys.argv) > 3 else 0.10) else 0)
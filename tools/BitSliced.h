@@ -0,0 +1,161 @@
+#ifndef TOOLS_BIT_SLICED_H
+#define TOOLS_BIT_SLICED_H
+
+#include "Rng.h"
+#include <stdint.h>
+#include <vector>
+
+/**
+ * W x 64 independent boolean lanes (one replication per bit). The loops
+ * over w[] have a constant trip count, so with -O3 -march=native the
+ * compiler turns W = 2/4/8 into one SSE2/AVX2/AVX-512 instruction per
+ * operation.
+ */
+template <unsigned W>
+struct LaneWord
+{
+  static const unsigned LANES = 64 * W;
+  uint64_t w[W];
+
+  static LaneWord Zero() {
+    LaneWord r;
+    for (unsigned i = 0; i < W; i++) r.w[i] = 0;
+    return r;
+  }
+  static LaneWord Ones() {
+    LaneWord r;
+    for (unsigned i = 0; i < W; i++) r.w[i] = ~static_cast<uint64_t>(0);
+    return r;
+  }
+  static LaneWord Random(Rng& rng) {
+    LaneWord r;
+    for (unsigned i = 0; i < W; i++) r.w[i] = rng.Next();
+    return r;
+  }
+
+  bool Any() const {
+    uint64_t any = 0;
+    for (unsigned i = 0; i < W; i++) any |= w[i];
+    return any != 0;
+  }
+  bool Get(unsigned lane) const { return (w[lane / 64] >> (lane % 64)) & 1; }
+  void Set(unsigned lane) { w[lane / 64] |= static_cast<uint64_t>(1) << (lane % 64); }
+
+  LaneWord operator&(const LaneWord& o) const { LaneWord r; for (unsigned i = 0; i < W; i++) r.w[i] = w[i] & o.w[i]; return r; }
+  LaneWord operator|(const LaneWord& o) const { LaneWord r; for (unsigned i = 0; i < W; i++) r.w[i] = w[i] | o.w[i]; return r; }
+  LaneWord operator^(const LaneWord& o) const { LaneWord r; for (unsigned i = 0; i < W; i++) r.w[i] = w[i] ^ o.w[i]; return r; }
+  LaneWord operator~() const { LaneWord r; for (unsigned i = 0; i < W; i++) r.w[i] = ~w[i]; return r; }
+  LaneWord& operator&=(const LaneWord& o) { for (unsigned i = 0; i < W; i++) w[i] &= o.w[i]; return *this; }
+  LaneWord& operator|=(const LaneWord& o) { for (unsigned i = 0; i < W; i++) w[i] |= o.w[i]; return *this; }
+};
+
+/**
+ * Unsigned integer per lane stored as bit planes, plane t holding bit t of
+ * every lane. Arithmetic is ripple-carry over the planes.
+ */
+template <unsigned W>
+class SlicedInt
+{
+public:
+  typedef LaneWord<W> Word;
+
+  explicit SlicedInt(unsigned bits = 0) : m_planes(bits, Word::Zero()) {}
+
+  unsigned GetBits() const { return m_planes.size(); }
+  const Word& Plane(unsigned t) const { return m_planes[t]; }
+
+  void Clear() {
+    for (unsigned t = 0; t < m_planes.size(); t++) m_planes[t] = Word::Zero();
+  }
+
+  // Same constant in every lane
+  static SlicedInt Constant(uint64_t value, unsigned bits) {
+    SlicedInt r(bits);
+    for (unsigned t = 0; t < bits; t++) {
+      if ((value >> t) & 1) r.m_planes[t] = Word::Ones();
+    }
+    return r;
+  }
+
+  // Uniform in [0, 2^bits) independently per lane
+  static SlicedInt Random(Rng& rng, unsigned bits) {
+    SlicedInt r(bits);
+    for (unsigned t = 0; t < bits; t++) r.m_planes[t] = Word::Random(rng);
+    return r;
+  }
+
+  // Add 1 in the lanes of mask; the carry out of the top plane is dropped
+  void Increment(Word carry) {
+    for (unsigned t = 0; t < m_planes.size() && carry.Any(); t++) {
+      Word sum = m_planes[t] ^ carry;
+      carry = m_planes[t] & carry;
+      m_planes[t] = sum;
+    }
+  }
+
+  // Product, bits = GetBits() + other.GetBits()
+  SlicedInt Multiply(const SlicedInt& other) const {
+    unsigned bits = GetBits() + other.GetBits();
+    SlicedInt product(bits);
+    for (unsigned s = 0; s < other.GetBits(); s++) {
+      const Word& select = other.m_planes[s];
+      if (!select.Any()) continue;
+      Word carry = Word::Zero();
+      for (unsigned t = s; t < bits; t++) {
+        Word addend = t - s < GetBits() ? m_planes[t - s] & select : Word::Zero();
+        Word partial = product.m_planes[t] ^ addend;
+        Word sum = partial ^ carry;
+        carry = (product.m_planes[t] & addend) | (carry & partial);
+        product.m_planes[t] = sum;
+      }
+    }
+    return product;
+  }
+
+  // Value shifted left by shift bits
+  SlicedInt Shift(unsigned shift) const {
+    SlicedInt r(GetBits() + shift);
+    for (unsigned t = 0; t < GetBits(); t++) r.m_planes[t + shift] = m_planes[t];
+    return r;
+  }
+
+  // Lanes where this < other; widths may differ
+  Word Less(const SlicedInt& other) const {
+    unsigned bits = GetBits() > other.GetBits() ? GetBits() : other.GetBits();
+    Word less = Word::Zero();
+    Word equal = Word::Ones();
+    for (unsigned t = bits; t-- > 0;) {
+      Word a = t < GetBits() ? m_planes[t] : Word::Zero();
+      Word b = t < other.GetBits() ? other.m_planes[t] : Word::Zero();
+      less |= equal & ~a & b;
+      equal &= ~(a ^ b);
+    }
+    return less;
+  }
+
+  uint64_t Get(unsigned lane) const {
+    uint64_t value = 0;
+    for (unsigned t = 0; t < m_planes.size() && t < 64; t++) {
+      value |= static_cast<uint64_t>(m_planes[t].Get(lane)) << t;
+    }
+    return value;
+  }
+
+  void Set(unsigned lane, uint64_t value) {
+    for (unsigned t = 0; t < m_planes.size() && t < 64; t++) {
+      if ((value >> t) & 1) m_planes[t].Set(lane);
+    }
+  }
+
+private:
+  std::vector<Word> m_planes;   ///< Bit planes, least significant first
+};
+
+// Bits needed to hold values up to max
+inline unsigned BitsFor(uint64_t max) {
+  unsigned bits = 1;
+  while (bits < 64 && (max >> bits) != 0) bits++;
+  return bits;
+}
+
+#endif /* TOOLS_BIT_SLICED_H */
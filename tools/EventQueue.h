@@ -0,0 +1,64 @@
+#ifndef TOOLS_EVENT_QUEUE_H
+#define TOOLS_EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+/**
+ * Event of the fast simulator; what node/peer/message mean depends on type
+ */
+struct FastEvent
+{
+  double time;       ///< Simulation time (s)
+  uint64_t seq;      ///< Insertion order, breaks ties like ns-3's FIFO order for equal times
+  uint32_t type;
+  uint32_t node;
+  uint32_t peer;
+  uint32_t message;
+};
+
+/**
+ * Binary min-heap of events ordered by (time, seq), kept in one vector
+ */
+class FastEventQueue
+{
+public:
+  FastEventQueue() : m_nextSeq(0) {}
+
+  void Clear() {
+    m_heap.clear();
+    m_nextSeq = 0;
+  }
+
+  void Schedule(double time, uint32_t type, uint32_t node, uint32_t peer = 0, uint32_t message = 0) {
+    FastEvent event = { time, m_nextSeq++, type, node, peer, message };
+    m_heap.push_back(event);
+    std::push_heap(m_heap.begin(), m_heap.end(), Later());
+  }
+
+  bool IsEmpty() const { return m_heap.empty(); }
+  const FastEvent& Peek() const { return m_heap.front(); }
+
+  FastEvent Pop() {
+    std::pop_heap(m_heap.begin(), m_heap.end(), Later());
+    FastEvent event = m_heap.back();
+    m_heap.pop_back();
+    return event;
+  }
+
+  uint64_t GetScheduledCount() const { return m_nextSeq; }
+
+private:
+  struct Later
+  {
+    bool operator()(const FastEvent& a, const FastEvent& b) const {
+      return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+    }
+  };
+
+  std::vector<FastEvent> m_heap;   ///< Heap ordered by Later
+  uint64_t m_nextSeq;              ///< Sequence number of the next event
+};
+
+#endif /* TOOLS_EVENT_QUEUE_H */
@@ -0,0 +1,427 @@
+#include "FastSim.h"
+#include "../CryptoEnergyModel.h"
+#include "../MessagePacketizer.h"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// 802.11g ERP-OFDM timing
+const double PREAMBLE_TIME = 20e-6;
+const double SYMBOL_TIME = 4e-6;
+const double SLOT_TIME = 9e-6;
+const double SIFS_TIME = 10e-6;
+const double DIFS_TIME = SIFS_TIME + 2 * SLOT_TIME;
+const double MEAN_BACKOFF_TIME = 7.5 * SLOT_TIME;   // CWmin 15
+const double ACK_TIME = 28e-6;                       // 14-byte ACK at 24 Mbit/s
+const double SPEED_OF_LIGHT = 299792458.0;
+
+// Header bytes per fragment: IPv4, LLC/SNAP, MAC header + FCS; UDP only in the first fragment
+const uint32_t IP_HEADER = 20;
+const uint32_t UDP_HEADER = 8;
+const uint32_t WIFI_OVERHEAD = 8 + 28;
+const uint32_t IP_MTU_PAYLOAD = 1480;
+
+// Message header "<epoch> <group> <sender> " of AppReceiver::GetSnapshot, epoch and group 0
+uint32_t HeaderSize(uint32_t sender) {
+  std::ostringstream header;
+  header << "0 0 " << sender << " ";
+  return header.str().size();
+}
+
+}
+
+FastSimConfig::FastSimConfig()
+  : numNodes(5), simuTime(60), dataRate(12e6), maxRetries(6), maxQueueDelay(0.5), packetization(true),
+    overhearing(false), forwarding(FORWARDING_RANDOM), forwardingBudget(0) {
+}
+
+FastProtocolSim::FastProtocolSim(const FastSimConfig& config)
+  : m_config(config), m_trace(0), m_numSamples(0), m_rng(0),
+    m_completedNodes(0), m_stopTime(0), m_completionTime(0), m_queueDrops(0) {
+}
+
+FastProtocolSim::~FastProtocolSim() {
+  ClearMessages();
+}
+
+void FastProtocolSim::SetMobilityTrace(const MobilityTraceFile* trace) {
+  m_trace = trace;
+}
+
+uint32_t FastProtocolSim::NewMessage(uint32_t sender, const std::string& contributions,
+                                     const MessageSnapshot* snapshot, uint32_t firstRow, uint32_t rowCount) {
+  uint32_t index;
+  if (!m_freeMessages.empty()) {
+    index = m_freeMessages.back();
+    m_freeMessages.pop_back();
+  } else {
+    index = m_messages.size();
+    m_messages.push_back(Message());
+  }
+  Message& message = m_messages[index];
+  message.sender = sender;
+  message.contributions = contributions;
+  message.snapshot = snapshot;
+  snapshot->Ref();
+  message.firstRow = firstRow;
+  message.rowCount = rowCount;
+  message.refs = 0;
+  return index;
+}
+
+void FastProtocolSim::ReleaseMessage(uint32_t message) {
+  if (m_messages[message].refs == 0) {
+    m_messages[message].snapshot->Unref();
+    m_messages[message].snapshot = 0;
+    m_freeMessages.push_back(message);
+  }
+}
+
+// Drops the messages still pending when a run stops
+void FastProtocolSim::ClearMessages() {
+  for (uint32_t i = 0; i < m_messages.size(); i++) {
+    if (m_messages[i].snapshot != 0) {
+      m_messages[i].snapshot->Unref();
+    }
+  }
+  m_messages.clear();
+  m_freeMessages.clear();
+}
+
+TracePoint FastProtocolSim::GetPosition(uint32_t node, double time) const {
+  if (m_trace != 0) {
+    return m_trace->GetPosition(node, time);
+  }
+  double position = time / m_config.mobility.timeStep;
+  uint32_t frame = position <= 0 ? 0 : static_cast<uint32_t>(position);
+  if (frame >= m_numSamples - 1) {
+    return m_frames[static_cast<size_t>(m_numSamples - 1) * m_config.numNodes + node];
+  }
+  double fraction = position - frame;
+  const TracePoint& a = m_frames[static_cast<size_t>(frame) * m_config.numNodes + node];
+  const TracePoint& b = m_frames[static_cast<size_t>(frame + 1) * m_config.numNodes + node];
+  TracePoint point = { a.x + (b.x - a.x) * fraction, a.y + (b.y - a.y) * fraction, a.z + (b.z - a.z) * fraction };
+  return point;
+}
+
+double FastProtocolSim::GetDistance(uint32_t a, uint32_t b, double time) const {
+  TracePoint pa = GetPosition(a, time);
+  TracePoint pb = GetPosition(b, time);
+  double dx = pa.x - pb.x;
+  double dy = pa.y - pb.y;
+  double dz = pa.z - pb.z;
+  return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+// Preamble + 16 service bits, payload and 6 tail bits in OFDM symbols
+double FastProtocolSim::GetFrameAirtime(uint32_t bytes) const {
+  double bitsPerSymbol = m_config.dataRate * SYMBOL_TIME;
+  return PREAMBLE_TIME + SYMBOL_TIME * std::ceil((16 + 8.0 * bytes + 6) / bitsPerSymbol);
+}
+
+// Per-second connectivity from the agreement start at 1 s, a link wherever reception is at least 50 %
+OracleResult FastProtocolSim::ComputeOracle() const {
+  uint32_t n = m_config.numNodes;
+  ConnectivityGraph graph;
+  graph.Initialize(n, 1.0);
+  std::vector<TracePoint> positions(n);
+  for (double time = 1; time < m_config.simuTime; time += 1.0) {
+    for (uint32_t i = 0; i < n; i++) {
+      positions[i] = GetPosition(i, time);
+    }
+    graph.AddSnapshot(positions, m_config.link.GetRange50());
+  }
+  return OracleBound::Compute(graph, OracleBound::GetSetupDelay(n), OracleBound::GetHopTime(n, m_config.dataRate));
+}
+
+FastRunResult FastProtocolSim::Run(uint64_t seed) {
+  uint32_t n = m_config.numNodes;
+  m_rng = Rng(seed);
+
+  if (m_trace == 0) {
+    GaussMarkovWalk walk(m_config.mobility, n, seed ^ 0x6d6f62696c697479ULL);
+    m_numSamples = static_cast<uint32_t>(std::ceil(m_config.simuTime / m_config.mobility.timeStep)) + 1;
+    m_frames.clear();
+    m_frames.reserve(static_cast<size_t>(m_numSamples) * n);
+    for (uint32_t k = 0; k < m_numSamples; k++) {
+      if (k > 0) {
+        walk.Step();
+      }
+      m_frames.insert(m_frames.end(), walk.GetPositions().begin(), walk.GetPositions().end());
+    }
+  }
+
+  m_queue.Clear();
+  ClearMessages();
+  m_nodes.assign(n, Node());
+  m_completedNodes = 0;
+  m_stopTime = m_config.simuTime;
+  m_completionTime = 0;
+  m_queueDrops = 0;
+
+  // AppSender::StartApplication: first broadcast after the crypto set-up delay (whole ms, as MilliSeconds()
+  // truncates) and the 1 ms of SendPacket
+  double initDelay = ((n - 1) * CryptoEnergyModel::GetOperationTime(CRYPTO_OP_CONTRIBUTION)
+                      + (n - 2) * CryptoEnergyModel::GetOperationTime(CRYPTO_OP_AGGREGATION)) * 1000;
+  for (uint32_t i = 0; i < n; i++) {
+    Node& node = m_nodes[i];
+    node.matrix.InitializeMatrix(n, i);
+    node.decisions = DecisionSource(seed ^ (0x64656369ULL << 32) ^ i);
+    node.matrix.SetRandomSource(&node.decisions);
+    node.receiverTree = KeyGenerationTree(n, i);
+    node.sent = 0;
+    node.received = 0;
+    node.overheard = 0;
+    node.completed = false;
+    node.busyUntil = 0;
+
+    std::string contributions(n, '0');
+    contributions[i] = '1';
+    uint32_t message = NewMessage(i, contributions, new MessageSnapshot(std::string(), node.matrix), 0, n);
+    double start = 1 + 0.00001 * i;
+    m_queue.Schedule(start + std::floor(initDelay) / 1000 + 0.001, EVENT_TRANSMIT, i, BROADCAST, message);
+  }
+
+  uint64_t events = 0;
+  while (!m_queue.IsEmpty() && m_queue.Peek().time < m_stopTime) {
+    FastEvent event = m_queue.Pop();
+    events++;
+    if (event.type == EVENT_TRANSMIT) {
+      Transmit(event);
+    } else {
+      Receive(event, event.type == EVENT_RECEIVE);
+    }
+  }
+
+  // Same statistics as startSimulation
+  FastRunResult result;
+  result.events = events;
+  result.queueDrops = m_queueDrops;
+  result.overheard = 0;
+  result.nodes.resize(n);
+  uint32_t totalSent = 0;
+  uint32_t totalReceived = 0;
+  uint32_t totalContributions = 0;
+  uint32_t successfulNodes = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t contributions = 0;
+    for (uint32_t j = 0; j < n; j++) {
+      if (m_nodes[i].matrix.HasKeyContribution(i, j)) {
+        contributions++;
+      }
+    }
+    result.nodes[i].sent = m_nodes[i].sent;
+    result.nodes[i].received = m_nodes[i].received;
+    result.nodes[i].contributions = contributions;
+    result.nodes[i].completed = contributions == n ? 1 : 0;
+    successfulNodes += result.nodes[i].completed;
+    totalSent += m_nodes[i].sent;
+    totalReceived += m_nodes[i].received;
+    result.overheard += m_nodes[i].overheard;
+    totalContributions += contributions;
+  }
+
+  result.oracle = ComputeOracle();
+
+  RunSummary& summary = result.summary;
+  summary.areaLength = m_config.mobility.areaLength;
+  summary.areaWidth = m_config.mobility.areaWidth;
+  summary.areaHeight = m_config.mobility.areaHeight;
+  summary.numNodes = n;
+  summary.linkQuality = "PRR";
+  summary.strategy = m_config.packetization ? "Single Round Communication" : "Single Round Communication/frag";
+  if (m_config.overhearing) {
+    summary.strategy += "/oh";
+  }
+  if (m_config.forwarding == FORWARDING_RAREST_FIRST) {
+    summary.strategy += "/rarest";
+  }
+  result.variant.packetization = m_config.packetization ? 1 : 0;
+  result.variant.overhearing = m_config.overhearing ? 1 : 0;
+  result.variant.forwarding = m_config.forwarding;
+  result.variant.forwardingBudget = m_config.forwardingBudget;
+  summary.rngRun = seed;
+  summary.keyAgreementDelay = m_completionTime;
+  summary.totalSent = totalSent;
+  summary.totalReceived = totalReceived;
+  summary.overheadRatio = totalSent > 0 ? static_cast<double>(totalReceived) / totalSent : 0;
+  summary.successRate = static_cast<double>(successfulNodes) / n * 100;
+  summary.avgUniqueContributions = static_cast<double>(totalContributions) / n;
+  summary.successfulNodes = successfulNodes;
+  return result;
+}
+
+// AppSender::DoSendPacket followed by the MAC: the units of the message, and the fragments of
+// each unit, are sent back to back once the node's radio is free
+void FastProtocolSim::Transmit(const FastEvent& event) {
+  Node& node = m_nodes[event.node];
+  uint32_t n = m_config.numNodes;
+  // Unit messages may reallocate m_messages; the snapshot stays referenced by event.message until released
+  std::string contributions = m_messages[event.message].contributions;
+  const MessageSnapshot* snapshot = m_messages[event.message].snapshot;
+  uint32_t header = HeaderSize(event.node);
+  std::vector<MessageUnit> units = MessagePacketizer::Split(contributions, n, header,
+                                                            m_config.packetization ? IP_MTU_PAYLOAD - UDP_HEADER : 0);
+
+  double start = std::max(event.time, node.busyUntil);
+  if (start - event.time > m_config.maxQueueDelay) {
+    m_queueDrops++;
+    ReleaseMessage(event.message);
+    return;
+  }
+  double end = start;
+  for (uint32_t u = 0; u < units.size(); u++) {
+    const MessageUnit& unit = units[u];
+    node.sent++;
+    uint32_t udpBytes = MessagePacketizer::GetUnitBytes(unit, n, header) + UDP_HEADER;
+    uint32_t fragments = (udpBytes + IP_MTU_PAYLOAD - 1) / IP_MTU_PAYLOAD;
+    double fragmentTime = DIFS_TIME + MEAN_BACKOFF_TIME
+        + GetFrameAirtime(std::min(udpBytes, IP_MTU_PAYLOAD) + IP_HEADER + WIFI_OVERHEAD);
+    double unitStart = end;
+    uint32_t unitMessage = BROADCAST;
+
+    if (event.peer == BROADCAST) {
+      // One attempt per fragment; a receiver needs all of them
+      end = unitStart + fragments * fragmentTime;
+      for (uint32_t j = 0; j < n; j++) {
+        if (j == event.node) {
+          continue;
+        }
+        double prr = m_config.link.GetPrr(GetDistance(event.node, j, unitStart));
+        bool delivered = true;
+        for (uint32_t f = 0; f < fragments && delivered; f++) {
+          delivered = m_rng.Uniform() < prr;
+        }
+        if (delivered) {
+          if (unitMessage == BROADCAST) {
+            unitMessage = NewMessage(event.node, unit.contributions, snapshot, unit.firstRow, unit.rowCount);
+          }
+          m_messages[unitMessage].refs++;
+          m_queue.Schedule(end + GetDistance(event.node, j, end) / SPEED_OF_LIGHT, EVENT_RECEIVE, j, event.node,
+                           unitMessage);
+        }
+      }
+    } else {
+      // Acknowledged unicast, every fragment retried until it gets through or the retry limit is hit
+      double prr = m_config.link.GetPrr(GetDistance(event.node, event.peer, unitStart));
+      if (m_config.overhearing) {
+        // Others overhear the first attempt of every fragment; whole messages are not reassembled
+        for (uint32_t j = 0; j < n && fragments == 1; j++) {
+          if (j == event.node || j == event.peer || m_rng.Uniform() >= m_config.link.GetPrr(GetDistance(event.node, j, unitStart))) {
+            continue;
+          }
+          if (unitMessage == BROADCAST) {
+            unitMessage = NewMessage(event.node, unit.contributions, snapshot, unit.firstRow, unit.rowCount);
+          }
+          m_messages[unitMessage].refs++;
+          double heard = unitStart + fragmentTime;
+          m_queue.Schedule(heard + GetDistance(event.node, j, heard) / SPEED_OF_LIGHT, EVENT_OVERHEAR, j, event.node,
+                           unitMessage);
+        }
+      }
+      bool delivered = true;
+      for (uint32_t f = 0; f < fragments && delivered; f++) {
+        bool acked = false;
+        for (uint32_t attempt = 0; attempt <= m_config.maxRetries && !acked; attempt++) {
+          end += fragmentTime + SIFS_TIME + ACK_TIME;
+          acked = m_rng.Uniform() < prr;
+        }
+        delivered = acked;
+      }
+      if (delivered) {
+        if (unitMessage == BROADCAST) {
+          unitMessage = NewMessage(event.node, unit.contributions, snapshot, unit.firstRow, unit.rowCount);
+        }
+        m_messages[unitMessage].refs++;
+        m_queue.Schedule(end + GetDistance(event.node, event.peer, end) / SPEED_OF_LIGHT, EVENT_RECEIVE, event.peer,
+                         event.node, unitMessage);
+      }
+    }
+  }
+  node.busyUntil = end;
+  ReleaseMessage(event.message);
+}
+
+// AppReceiver::Receive, or AppReceiver::Overhear when not addressed
+void FastProtocolSim::Receive(const FastEvent& event, bool addressed) {
+  uint32_t n = m_config.numNodes;
+  Node& node = m_nodes[event.node];
+  if (addressed) {
+    node.received++;
+  } else {
+    node.overheard++;
+  }
+  UpdateNeighborList(node, event.peer);
+
+  Message& message = m_messages[event.message];
+  node.receiverTree.AddMultipleContributions(message.contributions);
+  bool hasContributions = false;
+  for (uint32_t i = 0; i < n; i++) {
+    if (message.contributions[i] == '1') {
+      hasContributions = true;
+      if (!node.matrix.HasKeyContribution(event.node, i)) {
+        node.matrix.ReceiveKeyContribution(i);
+      }
+    }
+  }
+  node.matrix.MergeRows(message.firstRow, message.snapshot->GetMatrix().data() + message.firstRow * n, message.rowCount);
+  message.refs--;
+  ReleaseMessage(event.message);
+
+  if (!node.completed && (node.receiverTree.HasCompleteKey() || node.matrix.SelfIsFull1())) {
+    node.completed = true;
+    m_completedNodes++;
+    if (m_completedNodes == n) {
+      // CheckCompletionAndStop polls every 10 ms until 2 s, then every 100 ms
+      double check = 0.001;
+      while (check <= event.time) {
+        check += check < 2.0 ? 0.01 : 0.1;
+      }
+      if (check < m_config.simuTime) {
+        m_completionTime = check - 1;
+        m_stopTime = check;
+      }
+    }
+  }
+
+  // Row-only units and overheard units do not trigger forwarding
+  if (!addressed || !hasContributions) {
+    return;
+  }
+  std::string none(n, '0');
+  MessageSnapshot* snapshot = 0;   // One serialisation shared by every neighbour's message
+  uint32_t maxContributions = 0;
+  if (m_config.forwarding == FORWARDING_RAREST_FIRST) {
+    maxContributions = MessagePacketizer::GetContributionBudget(m_config.forwardingBudget);
+  }
+  for (uint32_t k = 0; k < node.neighbors.size(); k++) {
+    uint32_t neighbor = node.neighbors[k];
+    std::string forwarding = m_config.forwarding == FORWARDING_RAREST_FIRST
+        ? node.matrix.GetRarestContributions(neighbor, node.neighbors, maxContributions)
+        : node.matrix.GetForwardingContributions(neighbor);
+    if (forwarding != none) {
+      if (snapshot == 0) {
+        snapshot = new MessageSnapshot(std::string(), node.matrix);
+      }
+      uint32_t forward = NewMessage(event.node, forwarding, snapshot, 0, n);
+      m_queue.Schedule(event.time + 0.001, EVENT_TRANSMIT, event.node, neighbor, forward);
+    }
+  }
+}
+
+// AppReceiver::UpdateNeighborList: move to the back, keep the latest N/2
+void FastProtocolSim::UpdateNeighborList(Node& node, uint32_t neighbor) {
+  std::vector<uint32_t>::iterator it = std::find(node.neighbors.begin(), node.neighbors.end(), neighbor);
+  if (it != node.neighbors.end()) {
+    node.neighbors.erase(it);
+    node.neighbors.push_back(neighbor);
+  } else {
+    node.neighbors.push_back(neighbor);
+    if (node.neighbors.size() > m_config.numNodes / 2) {
+      node.neighbors.erase(node.neighbors.begin());
+    }
+  }
+}
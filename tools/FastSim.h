@@ -0,0 +1,150 @@
+#ifndef TOOLS_FAST_SIM_H
+#define TOOLS_FAST_SIM_H
+
+#include "../KeyMatrix.h"
+#include "../KeyGenerationTree.h"
+#include "../MessageSnapshot.h"
+#include "../MobilityTrace.h"
+#include "../OracleBound.h"
+#include "../ResultsSink.h"
+#include "EventQueue.h"
+#include "GaussMarkov.h"
+#include "PrrLinkModel.h"
+#include "Rng.h"
+#include <vector>
+#include <string>
+
+/**
+ * Scenario of one fast simulation run, defaults as in REGKA.cc
+ */
+struct FastSimConfig
+{
+  FastSimConfig();
+
+  uint32_t numNodes;
+  double simuTime;        ///< s
+  double dataRate;        ///< bit/s (ErpOfdmRate12Mbps)
+  uint32_t maxRetries;    ///< Unicast retransmissions per fragment (MaxSsrc - 1)
+  double maxQueueDelay;   ///< Packets waiting longer for the radio are dropped (WifiMacQueue MaxDelay, s)
+  bool packetization;     ///< MTU-sized message units as in REGKA, false for whole IP-fragmented messages
+  bool overhearing;       ///< Other nodes in range merge unicasts too (first attempt of each unit)
+  ForwardingRule forwarding;
+  uint32_t forwardingBudget;   ///< Crypto material bytes of a rarest-first message, 0 for no limit
+  PrrLinkModel link;
+  GaussMarkovParams mobility;   ///< Area and walk parameters
+};
+
+/**
+ * Results of one fast run in the layout startSimulation writes
+ */
+struct FastRunResult
+{
+  RunSummary summary;
+  std::vector<NodeResult> nodes;
+  uint64_t events;   ///< Events processed
+  uint32_t queueDrops;   ///< Packets dropped after waiting maxQueueDelay
+  uint32_t overheard;    ///< Unicasts merged by nodes they were not addressed to
+  OracleResult oracle;   ///< Bounds of the run's topology, links within range50
+  VariantResult variant; ///< Options behind the strategy suffixes
+};
+
+/**
+ * Discrete-event model of the REGKA protocol without ns-3. Every node runs
+ * the unchanged KeyMatrix/KeyGenerationTree logic of AppSender/AppReceiver
+ * (first broadcast after the crypto set-up delay, forwarding to the latest
+ * N/2 neighbours 1 ms after each reception, messages split into the units of
+ * MessagePacketizer). The radio is reduced to per-node transmit
+ * serialisation, 802.11g frame airtime of the IP fragments and independent
+ * per-fragment reception drawn from a PrrLinkModel;
+ * unicast fragments are retried up to maxRetries times and packets that
+ * would wait longer than maxQueueDelay for the radio are dropped. Collisions,
+ * carrier sense between nodes and the ARP exchange are not modelled, the
+ * fitted link curve absorbs them.
+ */
+class FastProtocolSim
+{
+public:
+  explicit FastProtocolSim(const FastSimConfig& config);
+  ~FastProtocolSim();
+
+  // Replay this trace instead of generating a Gauss-Markov walk per run; must outlive the simulator
+  void SetMobilityTrace(const MobilityTraceFile* trace);
+
+  FastRunResult Run(uint64_t seed);
+
+private:
+  enum EventType
+  {
+    EVENT_TRANSMIT,   ///< AppSender::DoSendPacket of node to peer (or broadcast)
+    EVENT_RECEIVE,    ///< AppReceiver::Receive of message at node
+    EVENT_OVERHEAR    ///< AppReceiver::Overhear of a unicast to another node
+  };
+
+  // Forwarding decisions of one node's KeyMatrix, an independent stream per node as in REGKA
+  class DecisionSource : public RandomSource
+  {
+  public:
+    DecisionSource() : m_rng(0) {}
+    explicit DecisionSource(uint64_t seed) : m_rng(seed) {}
+    virtual double GetUniform() { return m_rng.Uniform(); }
+
+  private:
+    Rng m_rng;
+  };
+
+  struct Node
+  {
+    KeyMatrix matrix;                  ///< Receiver KeyMatrix
+    DecisionSource decisions;          ///< Randomness of matrix
+    KeyGenerationTree receiverTree;    ///< Receiver key generation tree
+    std::vector<uint32_t> neighbors;   ///< Latest N/2 senders heard, oldest first
+    uint32_t sent;
+    uint32_t received;
+    uint32_t overheard;
+    bool completed;
+    double busyUntil;                  ///< End of the node's last transmission
+  };
+
+  struct Message
+  {
+    uint32_t sender;
+    std::string contributions;   ///< Forwarding string
+    const MessageSnapshot* snapshot;   ///< Sender KeyMatrix, shared by every message of its version (one reference each)
+    uint32_t firstRow;           ///< Rows firstRow.. firstRow + rowCount of the snapshot are carried
+    uint32_t rowCount;
+    uint32_t refs;               ///< Pending receptions
+  };
+
+  static const uint32_t BROADCAST = 0xffffffff;
+
+  uint32_t NewMessage(uint32_t sender, const std::string& contributions, const MessageSnapshot* snapshot,
+                      uint32_t firstRow, uint32_t rowCount);
+  void ReleaseMessage(uint32_t message);
+  void ClearMessages();
+
+  void Transmit(const FastEvent& event);
+  void Receive(const FastEvent& event, bool addressed);
+  void UpdateNeighborList(Node& node, uint32_t neighbor);
+
+  TracePoint GetPosition(uint32_t node, double time) const;
+  double GetDistance(uint32_t a, uint32_t b, double time) const;
+  double GetFrameAirtime(uint32_t bytes) const;
+  OracleResult ComputeOracle() const;
+
+  FastSimConfig m_config;
+  const MobilityTraceFile* m_trace;     ///< Replayed trace, 0 for a generated walk
+  std::vector<TracePoint> m_frames;     ///< Generated walk, numSamples x numNodes
+  uint32_t m_numSamples;
+
+  FastEventQueue m_queue;
+  Rng m_rng;                             ///< Link draws
+  std::vector<Node> m_nodes;
+  std::vector<Message> m_messages;
+  std::vector<uint32_t> m_freeMessages;
+  uint32_t m_completedNodes;
+  double m_stopTime;
+  double m_completionTime;
+  uint32_t m_queueDrops;
+};
+
+#endif /* TOOLS_FAST_SIM_H */
@@ -0,0 +1,369 @@
+// Fast protocol simulator: explore a parameter space without ns-3, confirm the interesting points with REGKA
+//
+//   FastSim --numNodes=20 --areaLength=500 --areaWidth=500 --areaHeight=100 --runs=200
+//           [--range50=600] [--prrWidth=60] [--mobilityTrace=<file>] [--packetization=1] [--overhearing=0]
+//           [--forwarding=random|rarest] [--forwardingBudget=0]
+//           [--resultsDir=./results_cache] [--worker=0]
+//   FastSim --calibrate=<timestamp>_Result.csv [--calibrationRuns=20]
+//
+// Sweep mode appends one record per run to <resultsDir>/fastsim_<worker>.bin (merge with
+// "python ResultsMerge.py results_cache fastsim"). Calibration mode fits range50/prrWidth to the
+// per-configuration means of an ns-3 results CSV and prints the fitted options.
+
+#include "FastSim.h"
+#include "../RegkaProfile.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/time.h>
+
+static bool ParseOption(const char* arg, const char* name, std::string& value) {
+  size_t length = std::strlen(name);
+  if (std::strncmp(arg, "--", 2) != 0 || std::strncmp(arg + 2, name, length) != 0 || arg[2 + length] != '=') {
+    return false;
+  }
+  value = arg + 3 + length;
+  return true;
+}
+
+static double WallClock() {
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * Mean metrics of a set of runs of one configuration
+ */
+struct ConfigMetrics
+{
+  ConfigMetrics() : runs(0), delay(0), successRate(0), receivedPerSent(0) {}
+
+  void Add(double runDelay, double runSuccessRate, double sent, double received) {
+    runs++;
+    delay += runDelay;
+    successRate += runSuccessRate;
+    receivedPerSent += sent > 0 ? received / sent : 0;
+  }
+
+  void Finish() {
+    if (runs > 0) {
+      delay /= runs;
+      successRate /= runs;
+      receivedPerSent /= runs;
+    }
+  }
+
+  uint32_t runs;
+  double delay;             ///< Mean keyAgreementDelay (s)
+  double successRate;       ///< Mean successRate (%)
+  double receivedPerSent;   ///< Mean totalReceived / totalSent
+};
+
+struct ConfigKey
+{
+  double areaLength, areaWidth, areaHeight;
+  uint32_t numNodes;
+
+  bool operator<(const ConfigKey& other) const {
+    if (numNodes != other.numNodes) return numNodes < other.numNodes;
+    if (areaLength != other.areaLength) return areaLength < other.areaLength;
+    if (areaWidth != other.areaWidth) return areaWidth < other.areaWidth;
+    return areaHeight < other.areaHeight;
+  }
+};
+
+// Per-configuration means of a {timestamp}_Result.csv written by ResultsMerge.py
+static bool ReadNs3Results(const std::string& path, std::map<ConfigKey, ConfigMetrics>& configs) {
+  std::ifstream in(path.c_str());
+  std::string line;
+  if (!in || !std::getline(in, line)) {
+    return false;
+  }
+  std::map<std::string, size_t> columns;
+  std::istringstream header(line);
+  std::string name;
+  for (size_t i = 0; std::getline(header, name, ','); i++) {
+    columns[name] = i;
+  }
+  const char* required[] = { "areaLength", "areaWidth", "areaHeight", "numNodes", "keyAgreementDelay",
+                             "successRate", "totalSent", "totalReceived" };
+  size_t lastColumn = 0;
+  for (size_t i = 0; i < sizeof(required) / sizeof(required[0]); i++) {
+    if (columns.find(required[i]) == columns.end()) {
+      std::fprintf(stderr, "%s: missing column %s\n", path.c_str(), required[i]);
+      return false;
+    }
+    lastColumn = std::max(lastColumn, columns[required[i]]);
+  }
+
+  while (std::getline(in, line)) {
+    std::vector<std::string> fields;
+    std::istringstream row(line);
+    std::string field;
+    while (std::getline(row, field, ',')) {
+      fields.push_back(field);
+    }
+    if (fields.size() <= lastColumn) {
+      continue;
+    }
+    ConfigKey key;
+    key.areaLength = std::atof(fields[columns["areaLength"]].c_str());
+    key.areaWidth = std::atof(fields[columns["areaWidth"]].c_str());
+    key.areaHeight = std::atof(fields[columns["areaHeight"]].c_str());
+    key.numNodes = std::atoi(fields[columns["numNodes"]].c_str());
+    configs[key].Add(std::atof(fields[columns["keyAgreementDelay"]].c_str()),
+                     std::atof(fields[columns["successRate"]].c_str()),
+                     std::atof(fields[columns["totalSent"]].c_str()),
+                     std::atof(fields[columns["totalReceived"]].c_str()));
+  }
+  for (std::map<ConfigKey, ConfigMetrics>::iterator it = configs.begin(); it != configs.end(); ++it) {
+    it->second.Finish();
+  }
+  return !configs.empty();
+}
+
+static ConfigMetrics RunConfig(const FastSimConfig& base, const ConfigKey& key, uint32_t runs, uint64_t seed) {
+  FastSimConfig config = base;
+  config.numNodes = key.numNodes;
+  config.mobility.areaLength = key.areaLength;
+  config.mobility.areaWidth = key.areaWidth;
+  config.mobility.areaHeight = key.areaHeight;
+  FastProtocolSim sim(config);
+  ConfigMetrics metrics;
+  for (uint32_t r = 0; r < runs; r++) {
+    FastRunResult result = sim.Run(seed + r);
+    metrics.Add(result.summary.keyAgreementDelay, result.summary.successRate,
+                result.summary.totalSent, result.summary.totalReceived);
+  }
+  metrics.Finish();
+  return metrics;
+}
+
+// Relative squared error of the fast model against the ns-3 means, summed over configurations
+static double CalibrationError(const std::map<ConfigKey, ConfigMetrics>& targets, const FastSimConfig& base,
+                               uint32_t runs) {
+  double error = 0;
+  for (std::map<ConfigKey, ConfigMetrics>::const_iterator it = targets.begin(); it != targets.end(); ++it) {
+    ConfigMetrics fast = RunConfig(base, it->first, runs, 1);
+    const ConfigMetrics& ns3 = it->second;
+    double delay = (fast.delay - ns3.delay) / std::max(ns3.delay, 0.01);
+    double success = (fast.successRate - ns3.successRate) / 100;
+    double ratio = (fast.receivedPerSent - ns3.receivedPerSent) / std::max(ns3.receivedPerSent, 1.0);
+    error += delay * delay + success * success + ratio * ratio;
+  }
+  return error;
+}
+
+// Grid search over range50, then over the transition width at the best range
+static int Calibrate(const std::string& path, const FastSimConfig& base, uint32_t runs) {
+  std::map<ConfigKey, ConfigMetrics> targets;
+  if (!ReadNs3Results(path, targets)) {
+    std::fprintf(stderr, "No ns-3 results read from %s\n", path.c_str());
+    return 1;
+  }
+  std::printf("Calibrating against %u configurations of %s, %u fast runs each\n",
+              static_cast<uint32_t>(targets.size()), path.c_str(), runs);
+
+  FastSimConfig config = base;
+  double bestRange = base.link.GetRange50();
+  double bestWidth = base.link.GetWidth();
+  double bestError = -1;
+  for (double range = 50; range <= 3000; range += 50) {
+    config.link = PrrLinkModel(range, bestWidth);
+    double error = CalibrationError(targets, config, runs);
+    if (bestError < 0 || error < bestError) {
+      bestError = error;
+      bestRange = range;
+    }
+  }
+  const double widthFractions[] = { 0.02, 0.05, 0.1, 0.2, 0.3, 0.5 };
+  for (size_t i = 0; i < sizeof(widthFractions) / sizeof(widthFractions[0]); i++) {
+    double width = widthFractions[i] * bestRange;
+    config.link = PrrLinkModel(bestRange, width);
+    double error = CalibrationError(targets, config, runs);
+    if (error < bestError) {
+      bestError = error;
+      bestWidth = width;
+    }
+  }
+
+  config.link = PrrLinkModel(bestRange, bestWidth);
+  std::printf("%-20s %14s %14s %14s %14s %14s %14s\n", "config", "ns3 delay", "fast delay",
+              "ns3 success", "fast success", "ns3 rx/tx", "fast rx/tx");
+  for (std::map<ConfigKey, ConfigMetrics>::const_iterator it = targets.begin(); it != targets.end(); ++it) {
+    ConfigMetrics fast = RunConfig(config, it->first, runs, 1);
+    std::ostringstream label;
+    label << it->first.areaLength << "x" << it->first.areaWidth << "x" << it->first.areaHeight << "/" << it->first.numNodes;
+    std::printf("%-20s %14.4f %14.4f %14.2f %14.2f %14.3f %14.3f\n", label.str().c_str(), it->second.delay, fast.delay,
+                it->second.successRate, fast.successRate, it->second.receivedPerSent, fast.receivedPerSent);
+  }
+  std::printf("Fitted link model (error %.4g): --range50=%g --prrWidth=%g\n", bestError, bestRange, bestWidth);
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  FastSimConfig config;
+  double range50 = config.link.GetRange50();
+  double prrWidth = config.link.GetWidth();
+  uint32_t runs = 1;
+  uint64_t seed = 1;
+  uint32_t calibrationRuns = 20;
+  uint32_t workerId = 0;
+  std::string resultsDir("./results_cache");
+  std::string mobilityTrace;
+  std::string calibrate;
+
+  const char* jobSlot = std::getenv("PARALLEL_JOBSLOT");
+  if (jobSlot != 0) {
+    workerId = std::atoi(jobSlot);
+  }
+
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (ParseOption(argv[i], "numNodes", value)) {
+      config.numNodes = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "areaLength", value)) {
+      config.mobility.areaLength = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "areaWidth", value)) {
+      config.mobility.areaWidth = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "areaHeight", value)) {
+      config.mobility.areaHeight = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "range50", value)) {
+      range50 = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "prrWidth", value)) {
+      prrWidth = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "maxRetries", value)) {
+      config.maxRetries = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "packetization", value)) {
+      config.packetization = std::atoi(value.c_str()) != 0;
+    } else if (ParseOption(argv[i], "overhearing", value)) {
+      config.overhearing = std::atoi(value.c_str()) != 0;
+    } else if (ParseOption(argv[i], "forwarding", value) && (value == "random" || value == "rarest")) {
+      config.forwarding = value == "rarest" ? FORWARDING_RAREST_FIRST : FORWARDING_RANDOM;
+    } else if (ParseOption(argv[i], "forwardingBudget", value)) {
+      config.forwardingBudget = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "simuTime", value)) {
+      config.simuTime = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "runs", value)) {
+      runs = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "seed", value)) {
+      seed = std::strtoull(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "mobilityTrace", value)) {
+      mobilityTrace = value;
+    } else if (ParseOption(argv[i], "resultsDir", value)) {
+      resultsDir = value;
+    } else if (ParseOption(argv[i], "worker", value)) {
+      workerId = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "calibrate", value)) {
+      calibrate = value;
+    } else if (ParseOption(argv[i], "calibrationRuns", value)) {
+      calibrationRuns = std::strtoul(value.c_str(), 0, 10);
+    } else {
+      std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  config.link = PrrLinkModel(range50, prrWidth);
+  if (config.numNodes < 2) {
+    std::fprintf(stderr, "--numNodes must be at least 2\n");
+    return 1;
+  }
+
+  if (!calibrate.empty()) {
+    return Calibrate(calibrate, config, calibrationRuns);
+  }
+
+  MobilityTraceFile trace;
+  FastProtocolSim sim(config);
+  if (!mobilityTrace.empty()) {
+    if (!trace.Open(mobilityTrace) || trace.GetNodeCount() != config.numNodes) {
+      std::fprintf(stderr, "Cannot replay %s for %u nodes\n", mobilityTrace.c_str(), config.numNodes);
+      return 1;
+    }
+    sim.SetMobilityTrace(&trace);
+  }
+
+  ResultsSink sink(resultsDir, workerId, "fastsim");
+  ConfigMetrics metrics;
+  uint64_t events = 0;
+  uint64_t sent = 0;
+  uint64_t overheard = 0;
+  uint32_t reachable = 0;
+  double oracleDelay = 0;
+  uint64_t oracleTransmissions = 0;
+  std::map<std::string, ProbeResult> profile;
+  double start = WallClock();
+  for (uint32_t r = 0; r < runs; r++) {
+    RegkaProfile::Reset();
+    double runStart = WallClock();
+    FastRunResult result = sim.Run(seed + r);
+    // No set-up outside the event loop here, so both times are the whole run
+    PerfResult perf;
+    perf.wallSeconds = WallClock() - runStart;
+    perf.runSeconds = perf.wallSeconds;
+    perf.events = result.events;
+    perf.peakRssKb = RegkaProfile::GetPeakRssKb();
+    std::vector<ProbeResult> probes = RegkaProfile::GetResults();
+    result.summary.timestamp = std::time(0);
+    result.summary.runId = r + 1;
+    ResultsRecord record;
+    record.AddSummary(result.summary);
+    record.AddNodes(result.nodes);
+    record.AddOracle(result.oracle);
+    record.AddVariant(result.variant);
+    if (RegkaProfile::IsEnabled()) {
+      record.AddProfile(probes);
+    }
+    record.AddPerf(perf);
+    for (uint32_t i = 0; i < probes.size(); i++) {
+      ProbeResult& total = profile[probes[i].name];
+      total.calls += probes[i].calls;
+      total.totalNs += probes[i].totalNs;
+      total.p99Ns = std::max(total.p99Ns, probes[i].p99Ns);
+    }
+    if (!sink.Append(record)) {
+      std::fprintf(stderr, "Unable to write results to %s\n", sink.GetPath().c_str());
+      return 1;
+    }
+    metrics.Add(result.summary.keyAgreementDelay, result.summary.successRate,
+                result.summary.totalSent, result.summary.totalReceived);
+    events += result.events;
+    sent += result.summary.totalSent;
+    overheard += result.overheard;
+    if (result.oracle.reachable) {
+      reachable++;
+      oracleDelay += result.oracle.delay;
+      oracleTransmissions += result.oracle.transmissions;
+    }
+  }
+  double elapsed = WallClock() - start;
+  metrics.Finish();
+
+  std::printf("%gx%gx%g/%u: %u runs, mean delay %.4f s, success %.2f %%, tx/run %.1f, overheard/run %.1f, rx/tx %.3f"
+              " (%.1f runs/s, %llu events, %.3g events/s, peak RSS %llu KiB)\n",
+              config.mobility.areaLength, config.mobility.areaWidth, config.mobility.areaHeight, config.numNodes,
+              runs, metrics.delay, metrics.successRate, runs > 0 ? static_cast<double>(sent) / runs : 0.0,
+              runs > 0 ? static_cast<double>(overheard) / runs : 0.0, metrics.receivedPerSent,
+              elapsed > 0 ? runs / elapsed : 0.0, static_cast<unsigned long long>(events),
+              elapsed > 0 ? events / elapsed : 0.0, static_cast<unsigned long long>(RegkaProfile::GetPeakRssKb()));
+  if (reachable > 0) {
+    std::printf("  oracle over %u connected runs: delay >= %.4f s, tx/run >= %.1f\n", reachable,
+                oracleDelay / reachable, static_cast<double>(oracleTransmissions) / reachable);
+  }
+  // Protocol hot paths over all runs, only in -DREGKA_PROFILE builds
+  for (std::map<std::string, ProbeResult>::const_iterator it = profile.begin(); it != profile.end(); ++it) {
+    const ProbeResult& total = it->second;
+    std::printf("  %-30s %10llu calls %10.1f ms  mean %7.0f ns  worst run p99 %7llu ns\n", it->first.c_str(),
+                static_cast<unsigned long long>(total.calls), total.totalNs / 1e6,
+                static_cast<double>(total.totalNs) / total.calls, static_cast<unsigned long long>(total.p99Ns));
+  }
+  return 0;
+}
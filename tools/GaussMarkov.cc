@@ -0,0 +1,82 @@
+#include "GaussMarkov.h"
+#include <cmath>
+
+GaussMarkovParams::GaussMarkovParams()
+  : areaLength(500), areaWidth(500), areaHeight(100), alpha(0.85), timeStep(1),
+    minMeanVelocity(10), maxMeanVelocity(50), meanPitch(0.05),
+    velocityVariance(0), velocityBound(0), directionVariance(0.2), directionBound(0.4),
+    pitchVariance(0.02), pitchBound(0.04) {
+}
+
+GaussMarkovWalk::GaussMarkovWalk(const GaussMarkovParams& params, uint32_t numNodes, uint64_t seed)
+  : m_params(params), m_rng(seed), m_states(numNodes), m_positions(numNodes) {
+  for (uint32_t i = 0; i < numNodes; i++) {
+    // RandomBoxPositionAllocator
+    m_positions[i].x = m_rng.Uniform(0, params.areaLength);
+    m_positions[i].y = m_rng.Uniform(0, params.areaWidth);
+    m_positions[i].z = m_rng.Uniform(0, params.areaHeight);
+
+    State& s = m_states[i];
+    s.meanVelocity = m_rng.Uniform(params.minMeanVelocity, params.maxMeanVelocity);
+    s.meanDirection = m_rng.Uniform(0, 6.283185307);
+    s.meanPitch = params.meanPitch;
+    s.velocity = s.meanVelocity;
+    s.direction = s.meanDirection;
+    s.pitch = s.meanPitch;
+    UpdateSpeed(s);
+  }
+}
+
+void GaussMarkovWalk::UpdateSpeed(State& s) {
+  s.speed.x = s.velocity * std::cos(s.direction) * std::cos(s.pitch);
+  s.speed.y = s.velocity * std::sin(s.direction) * std::cos(s.pitch);
+  s.speed.z = s.velocity * std::sin(s.pitch);
+}
+
+void GaussMarkovWalk::Step() {
+  double dt = m_params.timeStep;
+  double oneMinusAlpha = 1 - m_params.alpha;
+  double sqrtAlpha = std::sqrt(1 - m_params.alpha * m_params.alpha);
+
+  for (uint32_t i = 0; i < m_states.size(); i++) {
+    State& s = m_states[i];
+    TracePoint& p = m_positions[i];
+
+    // Reflect off the bounds if this step would leave the box
+    TracePoint next = { p.x + s.speed.x * dt, p.y + s.speed.y * dt, p.z + s.speed.z * dt };
+    bool reflected = false;
+    if (next.x > m_params.areaLength || next.x < 0) {
+      s.speed.x = -s.speed.x;
+      s.meanDirection = M_PI - s.meanDirection;
+      reflected = true;
+    }
+    if (next.y > m_params.areaWidth || next.y < 0) {
+      s.speed.y = -s.speed.y;
+      s.meanDirection = -s.meanDirection;
+      reflected = true;
+    }
+    if (next.z > m_params.areaHeight || next.z < 0) {
+      s.speed.z = -s.speed.z;
+      s.meanPitch = -s.meanPitch;
+      reflected = true;
+    }
+    if (reflected) {
+      s.direction = s.meanDirection;
+      s.pitch = s.meanPitch;
+    }
+
+    // Move, clamped to the box
+    p.x = std::min(std::max(p.x + s.speed.x * dt, 0.0), m_params.areaLength);
+    p.y = std::min(std::max(p.y + s.speed.y * dt, 0.0), m_params.areaWidth);
+    p.z = std::min(std::max(p.z + s.speed.z * dt, 0.0), m_params.areaHeight);
+
+    // Gauss-Markov update for the next step
+    s.velocity = m_params.alpha * s.velocity + oneMinusAlpha * s.meanVelocity
+        + sqrtAlpha * m_rng.Normal(0, m_params.velocityVariance, m_params.velocityBound);
+    s.direction = m_params.alpha * s.direction + oneMinusAlpha * s.meanDirection
+        + sqrtAlpha * m_rng.Normal(0, m_params.directionVariance, m_params.directionBound);
+    s.pitch = m_params.alpha * s.pitch + oneMinusAlpha * s.meanPitch
+        + sqrtAlpha * m_rng.Normal(0, m_params.pitchVariance, m_params.pitchBound);
+    UpdateSpeed(s);
+  }
+}
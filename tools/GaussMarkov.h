@@ -0,0 +1,60 @@
+#ifndef TOOLS_GAUSS_MARKOV_H
+#define TOOLS_GAUSS_MARKOV_H
+
+#include "../MobilityTrace.h"
+#include "Rng.h"
+#include <vector>
+
+/**
+ * Gauss-Markov mobility parameters, defaults as installed by startSimulation
+ */
+struct GaussMarkovParams
+{
+  GaussMarkovParams();
+
+  double areaLength;
+  double areaWidth;
+  double areaHeight;
+  double alpha;
+  double timeStep;           ///< s
+  double minMeanVelocity;    ///< MeanVelocity ~ U[min, max] (m/s)
+  double maxMeanVelocity;
+  double meanPitch;          ///< MeanPitch (rad)
+  double velocityVariance;   ///< NormalVelocity variance and bound
+  double velocityBound;
+  double directionVariance;  ///< NormalDirection variance and bound
+  double directionBound;
+  double pitchVariance;      ///< NormalPitch variance and bound
+  double pitchBound;
+};
+
+/**
+ * Gauss-Markov walk of a node set inside a box, stepping like ns-3's
+ * GaussMarkovMobilityModel: new velocity/direction/pitch every time step,
+ * reflection of the mean direction at the bounds, positions clamped to the box.
+ */
+class GaussMarkovWalk
+{
+public:
+  GaussMarkovWalk(const GaussMarkovParams& params, uint32_t numNodes, uint64_t seed);
+
+  void Step();   // Advance all nodes by one time step
+  const std::vector<TracePoint>& GetPositions() const { return m_positions; }
+
+private:
+  struct State
+  {
+    double velocity, direction, pitch;
+    double meanVelocity, meanDirection, meanPitch;
+    TracePoint speed;   ///< Current linear velocity vector
+  };
+
+  void UpdateSpeed(State& s);
+
+  GaussMarkovParams m_params;
+  Rng m_rng;
+  std::vector<State> m_states;
+  std::vector<TracePoint> m_positions;
+};
+
+#endif /* TOOLS_GAUSS_MARKOV_H */
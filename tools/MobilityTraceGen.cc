@@ -0,0 +1,88 @@
+// Generate a Gauss-Markov mobility trace for REGKA --mobilityTrace=<file>
+//
+//   MobilityTraceGen --numNodes=20 --areaLength=500 --areaWidth=500 --areaHeight=100
+//                    --seed=1 --duration=60 --timeStep=1 --out=traces/n20_500x500x100_s1.rgkm
+
+#include "../MobilityTrace.h"
+#include "GaussMarkov.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+
+static bool ParseOption(const char* arg, const char* name, std::string& value) {
+  size_t length = std::strlen(name);
+  if (std::strncmp(arg, "--", 2) != 0 || std::strncmp(arg + 2, name, length) != 0 || arg[2 + length] != '=') {
+    return false;
+  }
+  value = arg + 3 + length;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  GaussMarkovParams params;
+  uint32_t numNodes = 20;
+  uint64_t seed = 1;
+  double duration = 60;
+  std::string out;
+
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (ParseOption(argv[i], "numNodes", value)) {
+      numNodes = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "areaLength", value)) {
+      params.areaLength = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "areaWidth", value)) {
+      params.areaWidth = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "areaHeight", value)) {
+      params.areaHeight = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "seed", value)) {
+      seed = std::strtoull(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "duration", value)) {
+      duration = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "timeStep", value)) {
+      params.timeStep = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "out", value)) {
+      out = value;
+    } else {
+      std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (out.empty() || numNodes == 0 || params.timeStep <= 0 || duration < 0) {
+    std::fprintf(stderr, "Usage: %s --out=<file> [--numNodes=N] [--areaLength=m] [--areaWidth=m] [--areaHeight=m]"
+                 " [--seed=S] [--duration=s] [--timeStep=s]\n", argv[0]);
+    return 1;
+  }
+
+  uint32_t numSamples = static_cast<uint32_t>(std::ceil(duration / params.timeStep)) + 1;
+  GaussMarkovWalk walk(params, numNodes, seed);
+  std::vector<TracePoint> frames;
+  frames.reserve(static_cast<size_t>(numSamples) * numNodes);
+  for (uint32_t k = 0; k < numSamples; k++) {
+    if (k > 0) {
+      walk.Step();
+    }
+    frames.insert(frames.end(), walk.GetPositions().begin(), walk.GetPositions().end());
+  }
+
+  MobilityTraceHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, "RGKM", 4);
+  header.version = MobilityTraceFile::VERSION;
+  header.numNodes = numNodes;
+  header.numSamples = numSamples;
+  header.timeStep = params.timeStep;
+  header.areaLength = params.areaLength;
+  header.areaWidth = params.areaWidth;
+  header.areaHeight = params.areaHeight;
+  header.seed = seed;
+
+  if (!MobilityTraceFile::Write(out, header, frames)) {
+    std::fprintf(stderr, "Cannot write %s\n", out.c_str());
+    return 1;
+  }
+  std::printf("%s: %u nodes, %u samples every %g s\n", out.c_str(), numNodes, numSamples, params.timeStep);
+  return 0;
+}
@@ -0,0 +1,299 @@
+#ifndef TOOLS_MONTE_CARLO_H
+#define TOOLS_MONTE_CARLO_H
+
+#include "BitSliced.h"
+#include "PrrLinkModel.h"
+#include "Rng.h"
+#include "../ResultsSink.h"
+#include "../CryptoEnergyModel.h"
+#include <cmath>
+#include <vector>
+
+/**
+ * Configuration of the round-based Monte Carlo model
+ */
+struct MonteCarloConfig
+{
+  MonteCarloConfig()
+    : numNodes(5), areaLength(500), areaWidth(500), areaHeight(100), maxRetries(6),
+      maxRounds(200), roundTime(0.003), probabilityBits(16) {}
+
+  uint32_t numNodes;
+  double areaLength;
+  double areaWidth;
+  double areaHeight;
+  PrrLinkModel link;          ///< Same curve as FastSim, so calibrated parameters carry over
+  uint32_t maxRetries;        ///< Unicast retransmissions
+  uint32_t maxRounds;         ///< Forwarding rounds before a replication is given up
+  double roundTime;           ///< Duration of one forwarding round (s)
+  uint32_t probabilityBits;   ///< Resolution of the sliced uniform draws
+};
+
+/**
+ * Round-based abstraction of the REGKA gossip evaluated bit-sliced: lane r
+ * of every LaneWord belongs to replication r, so each logical operation of
+ * the protocol advances W x 64 replications at once.
+ *
+ * Per replication the nodes are placed uniformly in the box and stay put
+ * (agreement takes well under a second). Round 0 is the initial broadcast;
+ * in every later round each node that received something in the previous
+ * round runs KeyMatrix::GetForwardingContributions for each node it has
+ * heard from and unicasts the non-empty results. All sends of a round are
+ * computed from the state at the start of the round. A frame between u and
+ * v gets through with the PrrLinkModel probability of their distance, a
+ * unicast with 1 + maxRetries attempts. The CR and FD tests compare
+ * bit-sliced counts with sliced uniform draws (diff * 2^k > union * R, and
+ * count <= R for R uniform on [0, N)), which reproduces
+ * cr > RandomVariable() and fd < RandomVariable() exactly up to the 2^-k
+ * resolution of R. A replication stops as soon as all its nodes hold every
+ * contribution, like CheckCompletionAndStop.
+ */
+template <unsigned W>
+class BitSlicedMonteCarlo
+{
+public:
+  typedef LaneWord<W> Word;
+  typedef SlicedInt<W> Sliced;
+
+  explicit BitSlicedMonteCarlo(const MonteCarloConfig& config)
+    : m_config(config), m_n(config.numNodes), m_k(config.probabilityBits) {}
+
+  static unsigned GetLaneCount() { return Word::LANES; }
+
+  // Run W x 64 replications and append their summaries
+  void Run(Rng& rng, std::vector<RunSummary>& summaries);
+
+private:
+  Word& View(uint32_t v, uint32_t i, uint32_t c) { return m_view[(static_cast<size_t>(v) * m_n + i) * m_n + c]; }
+  const Word& Prev(uint32_t v, uint32_t i, uint32_t c) const { return m_prev[(static_cast<size_t>(v) * m_n + i) * m_n + c]; }
+
+  void PlaceNodes(Rng& rng);
+  Word Delivered(Rng& rng, uint32_t from, uint32_t to, bool unicast) const;
+  void Deliver(uint32_t from, uint32_t to, const Word& delivered, const std::vector<Word>& forwarding);
+  Word UniformBelowN(Rng& rng, const Sliced& count) const;
+
+  MonteCarloConfig m_config;
+  uint32_t m_n;
+  uint32_t m_k;
+  std::vector<Word> m_view;        ///< [v][i][c]: node v believes node i holds contribution c
+  std::vector<Word> m_prev;        ///< m_view at the start of the round
+  std::vector<Word> m_neighbors;   ///< [v][u]: v has heard from u
+  std::vector<Word> m_heard;       ///< [v]: v received something this round
+  std::vector<Sliced> m_broadcastThreshold;   ///< [v][u]: single-attempt success iff R < threshold
+  std::vector<Sliced> m_unicastThreshold;     ///< [v][u]: success within 1 + maxRetries attempts
+  Sliced m_sent;
+  Sliced m_received;
+};
+
+template <unsigned W>
+void BitSlicedMonteCarlo<W>::PlaceNodes(Rng& rng) {
+  std::vector<double> x(m_n), y(m_n), z(m_n);
+  m_broadcastThreshold.assign(static_cast<size_t>(m_n) * m_n, Sliced(m_k + 1));
+  m_unicastThreshold.assign(static_cast<size_t>(m_n) * m_n, Sliced(m_k + 1));
+  double scale = std::ldexp(1.0, m_k);
+  for (unsigned lane = 0; lane < Word::LANES; lane++) {
+    for (uint32_t v = 0; v < m_n; v++) {
+      x[v] = rng.Uniform(0, m_config.areaLength);
+      y[v] = rng.Uniform(0, m_config.areaWidth);
+      z[v] = rng.Uniform(0, m_config.areaHeight);
+    }
+    for (uint32_t v = 0; v < m_n; v++) {
+      for (uint32_t u = v + 1; u < m_n; u++) {
+        double d = std::sqrt((x[v] - x[u]) * (x[v] - x[u]) + (y[v] - y[u]) * (y[v] - y[u]) + (z[v] - z[u]) * (z[v] - z[u]));
+        double prr = m_config.link.GetPrr(d);
+        double unicast = 1 - std::pow(1 - prr, static_cast<double>(m_config.maxRetries + 1));
+        uint64_t broadcastThreshold = static_cast<uint64_t>(prr * scale + 0.5);
+        uint64_t unicastThreshold = static_cast<uint64_t>(unicast * scale + 0.5);
+        m_broadcastThreshold[v * m_n + u].Set(lane, broadcastThreshold);
+        m_broadcastThreshold[u * m_n + v].Set(lane, broadcastThreshold);
+        m_unicastThreshold[v * m_n + u].Set(lane, unicastThreshold);
+        m_unicastThreshold[u * m_n + v].Set(lane, unicastThreshold);
+      }
+    }
+  }
+}
+
+template <unsigned W>
+typename BitSlicedMonteCarlo<W>::Word BitSlicedMonteCarlo<W>::Delivered(Rng& rng, uint32_t from, uint32_t to,
+                                                                        bool unicast) const {
+  const Sliced& threshold = unicast ? m_unicastThreshold[from * m_n + to] : m_broadcastThreshold[from * m_n + to];
+  return Sliced::Random(rng, m_k).Less(threshold);
+}
+
+// Uniform integer on [0, N) per lane by rejection of [0, 2^bits)
+template <unsigned W>
+typename BitSlicedMonteCarlo<W>::Word BitSlicedMonteCarlo<W>::UniformBelowN(Rng& rng, const Sliced& count) const {
+  unsigned bits = BitsFor(m_n - 1);
+  Sliced n = Sliced::Constant(m_n, bits + 1);
+  Word pending = Word::Ones();
+  Word result = Word::Zero();
+  while (pending.Any()) {
+    Sliced r = Sliced::Random(rng, bits);
+    Word accepted = pending & r.Less(n);
+    // fd < U  <=>  count < N * U  <=>  count <= floor(N * U)
+    result |= accepted & ~r.Less(count);
+    pending &= ~accepted;
+  }
+  return result;
+}
+
+// AppReceiver::Receive of a packet from 'from' in the lanes of delivered
+template <unsigned W>
+void BitSlicedMonteCarlo<W>::Deliver(uint32_t from, uint32_t to, const Word& delivered,
+                                     const std::vector<Word>& forwarding) {
+  m_received.Increment(delivered);
+  for (uint32_t c = 0; c < m_n; c++) {
+    View(to, to, c) |= forwarding[c] & delivered;
+  }
+  for (uint32_t i = 0; i < m_n; i++) {
+    for (uint32_t c = 0; c < m_n; c++) {
+      View(to, i, c) |= Prev(from, i, c) & delivered;
+    }
+  }
+  m_neighbors[to * m_n + from] |= delivered;
+  m_heard[to] |= delivered;
+}
+
+template <unsigned W>
+void BitSlicedMonteCarlo<W>::Run(Rng& rng, std::vector<RunSummary>& summaries) {
+  const unsigned lanes = Word::LANES;
+  unsigned countBits = BitsFor(m_n);
+  unsigned counterBits = 32;
+
+  PlaceNodes(rng);
+  m_view.assign(static_cast<size_t>(m_n) * m_n * m_n, Word::Zero());
+  for (uint32_t v = 0; v < m_n; v++) {
+    for (uint32_t i = 0; i < m_n; i++) {
+      View(v, i, i) = Word::Ones();
+    }
+  }
+  m_neighbors.assign(static_cast<size_t>(m_n) * m_n, Word::Zero());
+  m_heard.assign(m_n, Word::Zero());
+  m_sent = Sliced(counterBits);
+  m_received = Sliced(counterBits);
+
+  std::vector<int> completionRound(lanes, -1);
+  Word alive = Word::Ones();
+  std::vector<Word> forwarding(m_n);
+
+  for (uint32_t round = 0; round <= m_config.maxRounds && alive.Any(); round++) {
+    m_prev = m_view;
+    std::vector<Word> active(m_heard);
+    for (uint32_t v = 0; v < m_n; v++) {
+      m_heard[v] = Word::Zero();
+    }
+
+    if (round == 0) {
+      // Initial broadcast of every node's own contribution
+      for (uint32_t v = 0; v < m_n; v++) {
+        m_sent.Increment(alive);
+        for (uint32_t c = 0; c < m_n; c++) {
+          forwarding[c] = c == v ? Word::Ones() : Word::Zero();
+        }
+        for (uint32_t u = 0; u < m_n; u++) {
+          if (u != v) {
+            Deliver(v, u, alive & Delivered(rng, v, u, false), forwarding);
+          }
+        }
+      }
+    } else {
+      for (uint32_t v = 0; v < m_n; v++) {
+        Word sender = active[v] & alive;
+        if (!sender.Any()) {
+          continue;
+        }
+        // SelfIsFull1 and the per-contribution counts behind CalculateFD
+        Word full = Word::Ones();
+        std::vector<Sliced> holders(m_n, Sliced(countBits));
+        for (uint32_t c = 0; c < m_n; c++) {
+          full &= Prev(v, v, c);
+          for (uint32_t i = 0; i < m_n; i++) {
+            holders[c].Increment(Prev(v, i, c));
+          }
+        }
+
+        for (uint32_t u = 0; u < m_n; u++) {
+          Word pair = sender & m_neighbors[v * m_n + u];
+          if (u == v || !pair.Any()) {
+            continue;
+          }
+          // CalculateCR: diff / union > U  <=>  diff * 2^k > union * R
+          Sliced diff(countBits);
+          Sliced unionCount(countBits);
+          for (uint32_t c = 0; c < m_n; c++) {
+            diff.Increment(Prev(v, v, c) & ~Prev(v, u, c));
+            unionCount.Increment(Prev(v, v, c) | Prev(v, u, c));
+          }
+          Word crPass = unionCount.Multiply(Sliced::Random(rng, m_k)).Less(diff.Shift(m_k));
+
+          Word any = Word::Zero();
+          for (uint32_t c = 0; c < m_n; c++) {
+            Word candidate = crPass & Prev(v, v, c) & ~Prev(v, u, c);
+            if (candidate.Any()) {
+              candidate &= UniformBelowN(rng, holders[c]);
+            }
+            forwarding[c] = full | candidate;
+            any |= forwarding[c];
+          }
+          Word send = pair & any;
+          if (!send.Any()) {
+            continue;
+          }
+          m_sent.Increment(send);
+          Deliver(v, u, send & Delivered(rng, v, u, true), forwarding);
+        }
+      }
+    }
+
+    // CheckCompletionAndStop, per replication
+    Word complete = alive;
+    for (uint32_t v = 0; v < m_n; v++) {
+      for (uint32_t c = 0; c < m_n; c++) {
+        complete &= View(v, v, c);
+      }
+    }
+    if (complete.Any()) {
+      for (unsigned lane = 0; lane < lanes; lane++) {
+        if (complete.Get(lane)) {
+          completionRound[lane] = round;
+        }
+      }
+      alive &= ~complete;
+    }
+  }
+
+  // Same columns as startSimulation
+  double initDelay = std::floor(((m_n - 1) * CryptoEnergyModel::GetOperationTime(CRYPTO_OP_CONTRIBUTION)
+                                 + (m_n - 2) * CryptoEnergyModel::GetOperationTime(CRYPTO_OP_AGGREGATION)) * 1000) / 1000;
+  for (unsigned lane = 0; lane < lanes; lane++) {
+    RunSummary summary;
+    summary.areaLength = m_config.areaLength;
+    summary.areaWidth = m_config.areaWidth;
+    summary.areaHeight = m_config.areaHeight;
+    summary.numNodes = m_n;
+    summary.linkQuality = "PRR";
+    summary.strategy = "Single Round Communication";
+    uint32_t successful = 0;
+    uint32_t contributions = 0;
+    for (uint32_t v = 0; v < m_n; v++) {
+      uint32_t held = 0;
+      for (uint32_t c = 0; c < m_n; c++) {
+        held += View(v, v, c).Get(lane);
+      }
+      contributions += held;
+      successful += held == m_n;
+    }
+    summary.totalSent = m_sent.Get(lane);
+    summary.totalReceived = m_received.Get(lane);
+    summary.overheadRatio = summary.totalSent > 0 ? static_cast<double>(summary.totalReceived) / summary.totalSent : 0;
+    summary.successfulNodes = successful;
+    summary.successRate = static_cast<double>(successful) / m_n * 100;
+    summary.avgUniqueContributions = static_cast<double>(contributions) / m_n;
+    // Delay from the 1 s sender start: crypto set-up, the first send and the forwarding rounds
+    summary.keyAgreementDelay = completionRound[lane] < 0 ? 0
+        : initDelay + 0.001 + completionRound[lane] * m_config.roundTime;
+    summaries.push_back(summary);
+  }
+}
+
+#endif /* TOOLS_MONTE_CARLO_H */
@@ -0,0 +1,156 @@
+// Bit-sliced Monte Carlo pre-screen of a configuration, W x 64 replications per pass
+//
+//   MonteCarlo --numNodes=20 --areaLength=500 --areaWidth=500 --areaHeight=100 --replications=4096
+//              [--lanes=64|128|256|512] [--range50=600] [--prrWidth=60] [--roundTime=0.003] [--seed=1]
+//
+// Every replication appends a summary record to <resultsDir>/montecarlo_<worker>.bin
+// ("python ResultsMerge.py results_cache montecarlo" gives the usual Result.csv columns).
+
+#include "MonteCarlo.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <sys/time.h>
+
+static bool ParseOption(const char* arg, const char* name, std::string& value) {
+  size_t length = std::strlen(name);
+  if (std::strncmp(arg, "--", 2) != 0 || std::strncmp(arg + 2, name, length) != 0 || arg[2 + length] != '=') {
+    return false;
+  }
+  value = arg + 3 + length;
+  return true;
+}
+
+static double WallClock() {
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+template <unsigned W>
+static void RunReplications(const MonteCarloConfig& config, uint32_t replications, uint64_t seed,
+                            std::vector<RunSummary>& summaries) {
+  BitSlicedMonteCarlo<W> engine(config);
+  Rng rng(seed);
+  while (summaries.size() < replications) {
+    engine.Run(rng, summaries);
+  }
+}
+
+// Mean and 95 % confidence half-width (normal approximation)
+static void MeanCi(const std::vector<double>& values, double& mean, double& halfWidth) {
+  double sum = 0;
+  double squares = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    sum += values[i];
+    squares += values[i] * values[i];
+  }
+  size_t n = values.size();
+  mean = n > 0 ? sum / n : 0;
+  double variance = n > 1 ? (squares - n * mean * mean) / (n - 1) : 0;
+  halfWidth = n > 1 ? 1.96 * std::sqrt(std::max(variance, 0.0) / n) : 0;
+}
+
+int main(int argc, char* argv[]) {
+  MonteCarloConfig config;
+  double range50 = config.link.GetRange50();
+  double prrWidth = config.link.GetWidth();
+  uint32_t replications = 4096;
+  uint32_t lanes = 64;
+  uint64_t seed = 1;
+  uint32_t workerId = 0;
+  std::string resultsDir("./results_cache");
+
+  const char* jobSlot = std::getenv("PARALLEL_JOBSLOT");
+  if (jobSlot != 0) {
+    workerId = std::atoi(jobSlot);
+  }
+
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (ParseOption(argv[i], "numNodes", value)) {
+      config.numNodes = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "areaLength", value)) {
+      config.areaLength = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "areaWidth", value)) {
+      config.areaWidth = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "areaHeight", value)) {
+      config.areaHeight = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "range50", value)) {
+      range50 = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "prrWidth", value)) {
+      prrWidth = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "maxRetries", value)) {
+      config.maxRetries = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "maxRounds", value)) {
+      config.maxRounds = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "roundTime", value)) {
+      config.roundTime = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "replications", value)) {
+      replications = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "lanes", value)) {
+      lanes = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "seed", value)) {
+      seed = std::strtoull(value.c_str(), 0, 10);
+    } else if (ParseOption(argv[i], "resultsDir", value)) {
+      resultsDir = value;
+    } else if (ParseOption(argv[i], "worker", value)) {
+      workerId = std::strtoul(value.c_str(), 0, 10);
+    } else {
+      std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  config.link = PrrLinkModel(range50, prrWidth);
+  if (config.numNodes < 2) {
+    std::fprintf(stderr, "--numNodes must be at least 2\n");
+    return 1;
+  }
+
+  std::vector<RunSummary> summaries;
+  summaries.reserve(replications + 512);
+  double start = WallClock();
+  switch (lanes) {
+  case 64: RunReplications<1>(config, replications, seed, summaries); break;
+  case 128: RunReplications<2>(config, replications, seed, summaries); break;
+  case 256: RunReplications<4>(config, replications, seed, summaries); break;
+  case 512: RunReplications<8>(config, replications, seed, summaries); break;
+  default:
+    std::fprintf(stderr, "--lanes must be 64, 128, 256 or 512\n");
+    return 1;
+  }
+  double elapsed = WallClock() - start;
+
+  ResultsSink sink(resultsDir, workerId, "montecarlo");
+  std::vector<double> success, delay, ratio;
+  int64_t now = std::time(0);
+  for (size_t r = 0; r < summaries.size(); r++) {
+    summaries[r].timestamp = now;
+    summaries[r].runId = r + 1;
+    summaries[r].rngRun = seed;
+    ResultsRecord record;
+    record.AddSummary(summaries[r]);
+    if (!sink.Append(record)) {
+      std::fprintf(stderr, "Unable to write results to %s\n", sink.GetPath().c_str());
+      return 1;
+    }
+    success.push_back(summaries[r].successRate);
+    delay.push_back(summaries[r].keyAgreementDelay);
+    ratio.push_back(summaries[r].overheadRatio);
+  }
+
+  double mean, halfWidth;
+  std::printf("%gx%gx%g/%u: %u replications (%u lanes) in %.3f s, %.0f replications/s\n",
+              config.areaLength, config.areaWidth, config.areaHeight, config.numNodes,
+              static_cast<uint32_t>(summaries.size()), lanes, elapsed, elapsed > 0 ? summaries.size() / elapsed : 0.0);
+  MeanCi(success, mean, halfWidth);
+  std::printf("  successRate        %10.4f +- %.4f %%\n", mean, halfWidth);
+  MeanCi(delay, mean, halfWidth);
+  std::printf("  keyAgreementDelay  %10.4f +- %.4f s\n", mean, halfWidth);
+  MeanCi(ratio, mean, halfWidth);
+  std::printf("  overheadRatio      %10.4f +- %.4f\n", mean, halfWidth);
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Oracle lower bounds of agreement delay and transmissions for a replayed mobility trace
+//
+//   Oracle --mobilityTrace=<file> --range=<m> [--start=1] [--duration=59] [--step=1] [--dataRate=12e6]
+//
+// The connectivity graph links the nodes within range of each other, one snapshot per step from start
+// (the agreement start of REGKA). REGKA and FastSim record the same bounds for every run in their
+// results, see "Oracle lower bounds" in the README.
+
+#include "../MobilityTrace.h"
+#include "../OracleBound.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static bool ParseOption(const char* arg, const char* name, std::string& value) {
+  size_t length = std::strlen(name);
+  if (std::strncmp(arg, "--", 2) != 0 || std::strncmp(arg + 2, name, length) != 0 || arg[2 + length] != '=') {
+    return false;
+  }
+  value = arg + 3 + length;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  std::string mobilityTrace;
+  double range = 0;
+  double start = 1;
+  double duration = -1;
+  double step = 1;
+  double dataRate = 12e6;
+
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (ParseOption(argv[i], "mobilityTrace", value)) {
+      mobilityTrace = value;
+    } else if (ParseOption(argv[i], "range", value)) {
+      range = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "start", value)) {
+      start = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "duration", value)) {
+      duration = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "step", value)) {
+      step = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "dataRate", value)) {
+      dataRate = std::atof(value.c_str());
+    } else {
+      std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (mobilityTrace.empty() || range <= 0 || step <= 0 || dataRate <= 0) {
+    std::fprintf(stderr, "Usage: %s --mobilityTrace=<file> --range=m [--start=s] [--duration=s] [--step=s]"
+                 " [--dataRate=bit/s]\n", argv[0]);
+    return 1;
+  }
+
+  MobilityTraceFile trace;
+  if (!trace.Open(mobilityTrace)) {
+    std::fprintf(stderr, "Cannot open %s\n", mobilityTrace.c_str());
+    return 1;
+  }
+  uint32_t n = trace.GetNodeCount();
+  if (duration < 0) {
+    duration = trace.GetDuration() - start;
+  }
+
+  ConnectivityGraph graph;
+  graph.Initialize(n, step);
+  std::vector<TracePoint> positions(n);
+  for (double time = 0; time < duration; time += step) {
+    for (uint32_t i = 0; i < n; i++) {
+      positions[i] = trace.GetPosition(i, start + time);
+    }
+    graph.AddSnapshot(positions, range);
+  }
+
+  OracleResult oracle = OracleBound::Compute(graph, OracleBound::GetSetupDelay(n), OracleBound::GetHopTime(n, dataRate));
+  std::printf("%s: %u nodes, %u snapshots, max degree %u\n", mobilityTrace.c_str(), n, graph.GetSnapshotCount(),
+              graph.GetMaxDegree());
+  if (!oracle.reachable) {
+    std::printf("  some contribution cannot reach every node within %g s\n", duration);
+    return 0;
+  }
+  std::printf("  delay >= %.6f s, transmissions >= %u\n", oracle.delay, oracle.transmissions);
+  return 0;
+}
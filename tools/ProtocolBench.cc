@@ -0,0 +1,417 @@
+// Microbenchmarks of the protocol core (KeyMatrix, KeyGenerationTree), built without ns-3
+//
+//   ProtocolBench [--sizes=5,10,20,50,100,256,512,1024,2048] [--fills=0.1,0.5,0.9,1]
+//                 [--filter=<substring>] [--minTime=0.2] [--out=bench.csv]
+//
+// One CSV row per (benchmark, N, fill): iterations, ns/op, allocations/op and bytes/op. Allocations are
+// counted by the replacement operator new of this program, bytes are the requested sizes.
+// Compare two result files with tools/BenchCompare.py.
+
+#include "../KeyMatrix.h"
+#include "../KeyGenerationTree.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+#include <vector>
+#include <sstream>
+
+// ---------- Allocation counting -------------
+#if __cplusplus >= 201103L
+#define BENCH_THROW_BAD_ALLOC
+#define BENCH_NOTHROW noexcept
+#else
+#define BENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define BENCH_NOTHROW throw()
+#endif
+
+static bool g_countAllocations = false;
+static uint64_t g_allocations = 0;
+static uint64_t g_allocatedBytes = 0;
+
+void* operator new(size_t size) BENCH_THROW_BAD_ALLOC {
+  if (g_countAllocations) {
+    g_allocations++;
+    g_allocatedBytes += size;
+  }
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == 0) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) BENCH_THROW_BAD_ALLOC {
+  return operator new(size);
+}
+
+void operator delete(void* p) BENCH_NOTHROW {
+  std::free(p);
+}
+
+void operator delete[](void* p) BENCH_NOTHROW {
+  std::free(p);
+}
+
+// C++14 sized deallocation, otherwise served by the library's own deletes
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, size_t) BENCH_NOTHROW {
+  std::free(p);
+}
+
+void operator delete[](void* p, size_t) BENCH_NOTHROW {
+  std::free(p);
+}
+#endif
+// ------------- End -----------------
+
+static double Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Keeps results alive so the compiler cannot drop the measured calls
+static volatile size_t g_sink;
+
+static bool ParseOption(const char* arg, const char* name, std::string& value) {
+  size_t length = std::strlen(name);
+  if (std::strncmp(arg, "--", 2) != 0 || std::strncmp(arg + 2, name, length) != 0 || arg[2 + length] != '=') {
+    return false;
+  }
+  value = arg + 3 + length;
+  return true;
+}
+
+template <typename T>
+static std::vector<T> ParseList(const std::string& value) {
+  std::vector<T> list;
+  std::istringstream in(value);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    std::istringstream field(item);
+    T parsed;
+    if (field >> parsed) {
+      list.push_back(parsed);
+    }
+  }
+  return list;
+}
+
+// '1' with probability fill, own position always set
+static std::string RandomBits(uint32_t length, double fill, uint32_t own) {
+  std::string bits(length, '0');
+  for (uint32_t i = 0; i < length; i++) {
+    if (i == own || static_cast<double>(std::rand()) / RAND_MAX < fill) {
+      bits[i] = '1';
+    }
+  }
+  return bits;
+}
+
+// KeyMatrix of node 0 with the diagonal set and the other entries set with probability fill
+static KeyMatrix RandomMatrix(uint32_t n, double fill) {
+  std::string bits;
+  bits.reserve(static_cast<size_t>(n) * n);
+  for (uint32_t i = 0; i < n; i++) {
+    bits += RandomBits(n, fill, i);
+  }
+  KeyMatrix base(n, 0);
+  return base.StringToMatrix(bits);
+}
+
+static KeyGenerationTree RandomTree(uint32_t n, double fill, uint32_t nodeId) {
+  KeyGenerationTree tree(n, nodeId);
+  tree.AddMultipleContributions(RandomBits(n, fill, nodeId));
+  return tree;
+}
+
+/**
+ * One benchmark case. Prepare() builds the inputs of 'count' operations
+ * outside the timed region (mutating operations need fresh state per
+ * operation), Run() performs them.
+ */
+class BenchCase
+{
+public:
+  virtual ~BenchCase() {}
+  virtual const char* GetName() const = 0;
+  virtual size_t GetStateBytes(uint32_t n) const = 0;
+  virtual void Setup(uint32_t n, double fill) = 0;
+  virtual void Prepare(uint32_t count) { (void) count; }
+  virtual void Run(uint32_t count) = 0;
+  virtual void Release() {}
+};
+
+class MergeMatrixCase : public BenchCase
+{
+public:
+  const char* GetName() const { return "KeyMatrix::MergeMatrix"; }
+  size_t GetStateBytes(uint32_t n) const { return static_cast<size_t>(n) * n / 8; }
+  void Setup(uint32_t n, double fill) {
+    m_local = RandomMatrix(n, fill);
+    m_received = RandomMatrix(n, fill);
+  }
+  // Idempotent after the first merge, but the loops do the same work every time
+  void Run(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+      m_local.MergeMatrix(m_received);
+    }
+    g_sink = m_local.HasKeyContribution(0, 0);
+  }
+  void Release() {
+    m_local = KeyMatrix();
+    m_received = KeyMatrix();
+  }
+
+private:
+  KeyMatrix m_local;
+  KeyMatrix m_received;
+};
+
+class ForwardingCase : public BenchCase
+{
+public:
+  const char* GetName() const { return "KeyMatrix::GetForwardingContributions"; }
+  size_t GetStateBytes(uint32_t n) const { return static_cast<size_t>(n) * n / 8; }
+  void Setup(uint32_t n, double fill) {
+    m_n = n;
+    m_matrix = RandomMatrix(n, fill);
+  }
+  void Run(uint32_t count) {
+    size_t ones = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      std::string forwarding = m_matrix.GetForwardingContributions(1 + i % (m_n - 1));
+      ones += forwarding[0];
+    }
+    g_sink = ones;
+  }
+  void Release() { m_matrix = KeyMatrix(); }
+
+private:
+  uint32_t m_n;
+  KeyMatrix m_matrix;
+};
+
+class MatrixToStringCase : public BenchCase
+{
+public:
+  const char* GetName() const { return "KeyMatrix::MatrixToString"; }
+  size_t GetStateBytes(uint32_t n) const { return static_cast<size_t>(n) * n; }
+  void Setup(uint32_t n, double fill) { m_matrix = RandomMatrix(n, fill); }
+  void Run(uint32_t count) {
+    size_t length = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      length += m_matrix.MatrixToString().size();
+    }
+    g_sink = length;
+  }
+  void Release() { m_matrix = KeyMatrix(); }
+
+private:
+  KeyMatrix m_matrix;
+};
+
+class StringToMatrixCase : public BenchCase
+{
+public:
+  const char* GetName() const { return "KeyMatrix::StringToMatrix"; }
+  size_t GetStateBytes(uint32_t n) const { return static_cast<size_t>(n) * n; }
+  void Setup(uint32_t n, double fill) {
+    m_matrix = RandomMatrix(n, fill);
+    m_string = m_matrix.MatrixToString();
+  }
+  void Run(uint32_t count) {
+    size_t set = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      KeyMatrix parsed = m_matrix.StringToMatrix(m_string);
+      set += parsed.HasKeyContribution(0, 0);
+    }
+    g_sink = set;
+  }
+  void Release() {
+    m_matrix = KeyMatrix();
+    m_string.clear();
+  }
+
+private:
+  KeyMatrix m_matrix;
+  std::string m_string;
+};
+
+// Fresh trees per operation so every call finds new contributions and runs BubbleUpMerge
+class AddContributionsCase : public BenchCase
+{
+public:
+  const char* GetName() const { return "KeyGenerationTree::AddMultipleContributions"; }
+  size_t GetStateBytes(uint32_t n) const { return 2 * static_cast<size_t>(n) / 8; }
+  void Setup(uint32_t n, double fill) {
+    m_prototype = KeyGenerationTree(n, 0);
+    m_contributions = RandomBits(n, fill, 0);
+  }
+  void Prepare(uint32_t count) { m_trees.assign(count, m_prototype); }
+  void Run(uint32_t count) {
+    size_t complete = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      m_trees[i].AddMultipleContributions(m_contributions);
+      complete += m_trees[i].HasCompleteKey();
+    }
+    g_sink = complete;
+  }
+  void Release() {
+    m_trees.clear();
+    m_prototype = KeyGenerationTree();
+  }
+
+private:
+  KeyGenerationTree m_prototype;
+  std::string m_contributions;
+  std::vector<KeyGenerationTree> m_trees;
+};
+
+class MergeTreeCase : public BenchCase
+{
+public:
+  const char* GetName() const { return "KeyGenerationTree::MergeTree"; }
+  size_t GetStateBytes(uint32_t n) const { return 2 * static_cast<size_t>(n) / 8; }
+  void Setup(uint32_t n, double fill) {
+    m_prototype = RandomTree(n, fill, 0);
+    m_other = RandomTree(n, fill, 1);
+  }
+  void Prepare(uint32_t count) { m_trees.assign(count, m_prototype); }
+  void Run(uint32_t count) {
+    size_t complete = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      m_trees[i].MergeTree(m_other);
+      complete += m_trees[i].HasCompleteKey();
+    }
+    g_sink = complete;
+  }
+  void Release() {
+    m_trees.clear();
+    m_prototype = KeyGenerationTree();
+    m_other = KeyGenerationTree();
+  }
+
+private:
+  KeyGenerationTree m_prototype;
+  KeyGenerationTree m_other;
+  std::vector<KeyGenerationTree> m_trees;
+};
+
+/**
+ * Result of one (case, N, fill) measurement
+ */
+struct BenchResult
+{
+  uint64_t iterations;
+  double nsPerOp;
+  double allocsPerOp;
+  double bytesPerOp;
+};
+
+// Doubles the batch until a batch takes minTime; batches of mutating cases are capped by memory
+static BenchResult Measure(BenchCase& bench, uint32_t n, double fill, double minTime) {
+  const size_t batchMemory = 64 << 20;
+  uint32_t maxBatch = static_cast<uint32_t>(std::max<size_t>(1, batchMemory / std::max<size_t>(1, bench.GetStateBytes(n))));
+  std::srand(12345);
+  bench.Setup(n, fill);
+
+  BenchResult result = { 0, 0, 0, 0 };
+  double elapsed = 0;
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+  uint32_t batch = 1;
+  while (elapsed < minTime) {
+    bench.Prepare(batch);
+    g_allocations = 0;
+    g_allocatedBytes = 0;
+    g_countAllocations = true;
+    double start = Now();
+    bench.Run(batch);
+    double took = Now() - start;
+    g_countAllocations = false;
+
+    // Small batches only warm up; the final figures come from the runs of at least 10 % of minTime
+    if (took >= minTime / 10) {
+      elapsed += took;
+      result.iterations += batch;
+      allocations += g_allocations;
+      bytes += g_allocatedBytes;
+    }
+    if (took < minTime / 2 && batch < maxBatch) {
+      batch = std::min(maxBatch, batch * 2);
+    }
+  }
+  bench.Release();
+
+  result.nsPerOp = elapsed * 1e9 / result.iterations;
+  result.allocsPerOp = static_cast<double>(allocations) / result.iterations;
+  result.bytesPerOp = static_cast<double>(bytes) / result.iterations;
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<uint32_t> sizes = ParseList<uint32_t>("5,10,20,50,100,256,512,1024,2048");
+  std::vector<double> fills = ParseList<double>("0.1,0.5,0.9,1");
+  std::string filter;
+  std::string out;
+  double minTime = 0.2;
+
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (ParseOption(argv[i], "sizes", value)) {
+      sizes = ParseList<uint32_t>(value);
+    } else if (ParseOption(argv[i], "fills", value)) {
+      fills = ParseList<double>(value);
+    } else if (ParseOption(argv[i], "filter", value)) {
+      filter = value;
+    } else if (ParseOption(argv[i], "minTime", value)) {
+      minTime = std::atof(value.c_str());
+    } else if (ParseOption(argv[i], "out", value)) {
+      out = value;
+    } else {
+      std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  FILE* output = out.empty() ? stdout : std::fopen(out.c_str(), "w");
+  if (output == 0) {
+    std::fprintf(stderr, "Cannot write %s\n", out.c_str());
+    return 1;
+  }
+
+  MergeMatrixCase mergeMatrix;
+  ForwardingCase forwarding;
+  MatrixToStringCase matrixToString;
+  StringToMatrixCase stringToMatrix;
+  AddContributionsCase addContributions;
+  MergeTreeCase mergeTree;
+  BenchCase* cases[] = { &mergeMatrix, &forwarding, &matrixToString, &stringToMatrix, &addContributions, &mergeTree };
+
+  std::fprintf(output, "benchmark,n,fill,iterations,ns_per_op,allocs_per_op,bytes_per_op\n");
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    if (!filter.empty() && std::string(cases[c]->GetName()).find(filter) == std::string::npos) {
+      continue;
+    }
+    for (size_t s = 0; s < sizes.size(); s++) {
+      if (sizes[s] < 2) {
+        continue;
+      }
+      for (size_t f = 0; f < fills.size(); f++) {
+        BenchResult result = Measure(*cases[c], sizes[s], fills[f], minTime);
+        std::fprintf(output, "%s,%u,%g,%llu,%.1f,%.2f,%.1f\n", cases[c]->GetName(), sizes[s], fills[f],
+                     static_cast<unsigned long long>(result.iterations), result.nsPerOp, result.allocsPerOp,
+                     result.bytesPerOp);
+        std::fflush(output);
+      }
+    }
+  }
+  if (output != stdout) {
+    std::fclose(output);
+  }
+  return 0;
+}
@@ -0,0 +1,12 @@
+#include "PrrLinkModel.h"
+#include <cmath>
+
+PrrLinkModel::PrrLinkModel(double range50, double width) : m_range50(range50), m_width(width) {
+}
+
+double PrrLinkModel::GetPrr(double distance) const {
+  if (m_width <= 0) {
+    return distance <= m_range50 ? 1.0 : 0.0;
+  }
+  return 1.0 / (1.0 + std::exp((distance - m_range50) / m_width));
+}
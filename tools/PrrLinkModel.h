@@ -0,0 +1,30 @@
+#ifndef TOOLS_PRR_LINK_MODEL_H
+#define TOOLS_PRR_LINK_MODEL_H
+
+#include <stdint.h>
+
+/**
+ * Distance-based packet reception ratio of one frame (one IP fragment):
+ *   PRR(d) = 1 / (1 + exp((d - range50) / width))
+ * range50 is the distance with 50 % reception, width the slope of the
+ * transition region. The fast simulator draws every frame independently
+ * from this curve; the curve stands in for the LogDistance/Random/Nakagami
+ * chain, the CCA threshold and collisions, so its parameters are fitted to
+ * ns-3 runs (FastSim --calibrate).
+ */
+class PrrLinkModel
+{
+public:
+  PrrLinkModel(double range50 = 600, double width = 60);
+
+  double GetPrr(double distance) const;
+
+  double GetRange50() const { return m_range50; }
+  double GetWidth() const { return m_width; }
+
+private:
+  double m_range50;   ///< Distance of 50 % reception (m)
+  double m_width;     ///< Transition width (m)
+};
+
+#endif /* TOOLS_PRR_LINK_MODEL_H */
@@ -0,0 +1,78 @@
+#ifndef TOOLS_RNG_H
+#define TOOLS_RNG_H
+
+#include <stdint.h>
+#include <cmath>
+
+/**
+ * Small deterministic generator (splitmix64 seeding, xorshift64*) for the
+ * standalone tools; one instance per independent stream.
+ */
+class Rng
+{
+public:
+  explicit Rng(uint64_t seed) : m_haveSpare(false), m_spare(0) {
+    // splitmix64 so that neighbouring seeds give unrelated streams
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    m_state = (z ^ (z >> 31)) | 1;
+  }
+
+  uint64_t Next() {
+    m_state ^= m_state >> 12;
+    m_state ^= m_state << 25;
+    m_state ^= m_state >> 27;
+    return m_state * 0x2545f4914f6cdd1dULL;
+  }
+
+  // Uniform in [0, 1)
+  double Uniform() {
+    return (Next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  double Uniform(double min, double max) {
+    return min + (max - min) * Uniform();
+  }
+
+  // Uniform integer in [0, n)
+  uint32_t Below(uint32_t n) {
+    return static_cast<uint32_t>(Uniform() * n);
+  }
+
+  // Normal draw redrawn while outside [mean - bound, mean + bound], like ns-3's bounded NormalRandomVariable
+  double Normal(double mean, double variance, double bound) {
+    if (variance <= 0) {
+      return mean;
+    }
+    double value;
+    do {
+      value = mean + std::sqrt(variance) * StandardNormal();
+    } while (bound > 0 && std::fabs(value - mean) > bound);
+    return value;
+  }
+
+private:
+  double StandardNormal() {
+    if (m_haveSpare) {
+      m_haveSpare = false;
+      return m_spare;
+    }
+    double u, v, s;
+    do {
+      u = 2 * Uniform() - 1;
+      v = 2 * Uniform() - 1;
+      s = u * u + v * v;
+    } while (s >= 1 || s == 0);
+    double factor = std::sqrt(-2 * std::log(s) / s);
+    m_spare = v * factor;
+    m_haveSpare = true;
+    return u * factor;
+  }
+
+  uint64_t m_state;   ///< xorshift64* state
+  bool m_haveSpare;   ///< Second Box-Muller value pending
+  double m_spare;     ///< Pending Box-Muller value
+};
+
+#endif /* TOOLS_RNG_H */